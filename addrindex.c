@@ -0,0 +1,122 @@
+#include "addrindex.h"
+#include <stdlib.h>
+
+#define ADDRINDEX_INITIAL_CAPACITY 64
+
+static uint64_t addr_key(const struct sockaddr_in *addr) {
+    return ((uint64_t)addr->sin_addr.s_addr << 16) | addr->sin_port;
+}
+
+/* Mélange final de murmur3 : répartit bien des clés très proches */
+static size_t addr_hash(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return (size_t)k;
+}
+
+static int addrindex_alloc(AddrIndex *ix, size_t capacity) {
+    ix->keys = malloc(capacity * sizeof(uint64_t));
+    ix->slots = malloc(capacity * sizeof(int));
+    if (!ix->keys || !ix->slots) {
+        free(ix->keys);
+        free(ix->slots);
+        return 0;
+    }
+    for (size_t i = 0; i < capacity; i++) ix->slots[i] = -1;
+    ix->capacity = capacity;
+    ix->count = 0;
+    return 1;
+}
+
+AddrIndex *addrindex_create(void) {
+    AddrIndex *ix = malloc(sizeof(AddrIndex));
+    if (!ix) return NULL;
+    if (!addrindex_alloc(ix, ADDRINDEX_INITIAL_CAPACITY)) {
+        free(ix);
+        return NULL;
+    }
+    return ix;
+}
+
+void addrindex_free(AddrIndex *ix) {
+    if (!ix) return;
+    free(ix->keys);
+    free(ix->slots);
+    free(ix);
+}
+
+/* Insère sans vérifier la capacité */
+static void addrindex_place(AddrIndex *ix, uint64_t key, int slot) {
+    size_t mask = ix->capacity - 1;
+    size_t i = addr_hash(key) & mask;
+    while (ix->slots[i] != -1) {
+        if (ix->keys[i] == key) {
+            ix->slots[i] = slot;
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    ix->keys[i] = key;
+    ix->slots[i] = slot;
+    ix->count++;
+}
+
+/* Double la capacité et réinsère toutes les clés */
+static int addrindex_grow(AddrIndex *ix) {
+    AddrIndex old = *ix;
+    if (!addrindex_alloc(ix, old.capacity * 2)) {
+        *ix = old;
+        return 0;
+    }
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (old.slots[i] != -1) addrindex_place(ix, old.keys[i], old.slots[i]);
+    }
+    free(old.keys);
+    free(old.slots);
+    return 1;
+}
+
+int addrindex_put(AddrIndex *ix, const struct sockaddr_in *addr, int slot) {
+    if (!ix || !addr || slot < 0) return 0;
+    // Facteur de charge maximal 0.5 : les sondages restent très courts
+    if ((ix->count + 1) * 2 > ix->capacity && !addrindex_grow(ix)) return 0;
+    addrindex_place(ix, addr_key(addr), slot);
+    return 1;
+}
+
+int addrindex_get(const AddrIndex *ix, const struct sockaddr_in *addr) {
+    if (!ix || !addr) return -1;
+    uint64_t key = addr_key(addr);
+    size_t mask = ix->capacity - 1;
+    for (size_t i = addr_hash(key) & mask; ix->slots[i] != -1; i = (i + 1) & mask) {
+        if (ix->keys[i] == key) return ix->slots[i];
+    }
+    return -1;
+}
+
+int addrindex_remove(AddrIndex *ix, const struct sockaddr_in *addr) {
+    if (!ix || !addr) return 0;
+    uint64_t key = addr_key(addr);
+    size_t mask = ix->capacity - 1;
+    size_t i = addr_hash(key) & mask;
+    while (ix->slots[i] != -1 && ix->keys[i] != key) i = (i + 1) & mask;
+    if (ix->slots[i] == -1) return 0;
+
+    // Décalage arrière : on remonte les éléments suivants de la grappe
+    // qui peuvent occuper le trou, sans laisser de pierre tombale
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; ix->slots[j] != -1; j = (j + 1) & mask) {
+        size_t home = addr_hash(ix->keys[j]) & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            ix->keys[hole] = ix->keys[j];
+            ix->slots[hole] = ix->slots[j];
+            hole = j;
+        }
+    }
+    ix->slots[hole] = -1;
+    ix->count--;
+    return 1;
+}
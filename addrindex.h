@@ -0,0 +1,34 @@
+#ifndef ADDRINDEX_H
+#define ADDRINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+
+/**
+ * Index (adresse IPv4, port) → index de client
+ * Table à adressage ouvert, sondage linéaire, suppression par décalage arrière
+ */
+typedef struct {
+    uint64_t *keys;   /* clé (adresse << 16 | port) de chaque case */
+    int *slots;       /* index de client, -1 si case vide */
+    size_t count;     /* nb de cases occupées */
+    size_t capacity;  /* nb de cases (puissance de 2) */
+} AddrIndex;
+
+/* Crée un index vide */
+AddrIndex *addrindex_create(void);
+
+/* Libère un index */
+void addrindex_free(AddrIndex *ix);
+
+/* Associe addr à slot (remplace l'association existante), 0 si erreur */
+int addrindex_put(AddrIndex *ix, const struct sockaddr_in *addr, int slot);
+
+/* Retourne l'index de client associé à addr, -1 si absent */
+int addrindex_get(const AddrIndex *ix, const struct sockaddr_in *addr);
+
+/* Supprime l'association de addr, renvoie 1 si supprimée, 0 sinon */
+int addrindex_remove(AddrIndex *ix, const struct sockaddr_in *addr);
+
+#endif
@@ -0,0 +1,89 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_MIN_CLASS 8
+
+/* Classe de taille d'une allocation de n octets, -1 si trop grande */
+static int size_class(size_t n) {
+    size_t c = ARENA_MIN_CLASS;
+    for (int i = 0; i < ARENA_CLASSES; i++, c <<= 1) {
+        if (n <= c) return i;
+    }
+    return -1;
+}
+
+/* Ajoute un bloc d'au moins n octets en tête de liste */
+static ArenaBlock *arena_new_block(Arena *a, size_t n) {
+    size_t size = n > ARENA_BLOCK_SIZE ? n : ARENA_BLOCK_SIZE;
+    ArenaBlock *b = malloc(sizeof(ArenaBlock) + size);
+    if (!b) return NULL;
+    b->used = 0;
+    b->size = size;
+    b->next = a->blocks;
+    a->blocks = b;
+    a->reserved += sizeof(ArenaBlock) + size;
+    return b;
+}
+
+Arena *arena_create(void) {
+    return calloc(1, sizeof(Arena));
+}
+
+void arena_free(Arena *a) {
+    if (!a) return;
+    ArenaBlock *b = a->blocks;
+    while (b) {
+        ArenaBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    free(a);
+}
+
+char *arena_strdup(Arena *a, const char *s) {
+    if (!a || !s) return NULL;
+    size_t n = strlen(s) + 1;
+    int cls = size_class(n);
+    char *p = NULL;
+
+    if (cls >= 0 && a->free_lists[cls]) {
+        // Réutilisation d'une chaîne rendue de la même classe
+        p = a->free_lists[cls];
+        memcpy(&a->free_lists[cls], p, sizeof(char *));
+    } else {
+        size_t sz = cls >= 0 ? (size_t)ARENA_MIN_CLASS << cls : n;
+        ArenaBlock *b = a->blocks;
+        if (!b || b->size - b->used < sz) {
+            // Les grandes chaînes ont leur propre bloc, le bloc courant reste en tête
+            if (sz > ARENA_BLOCK_SIZE / 2 && b) {
+                ArenaBlock *big = malloc(sizeof(ArenaBlock) + sz);
+                if (!big) return NULL;
+                big->used = big->size = sz;
+                big->next = b->next;
+                b->next = big;
+                a->reserved += sizeof(ArenaBlock) + sz;
+                a->used += sz;
+                memcpy(big->data, s, n);
+                return big->data;
+            }
+            b = arena_new_block(a, sz);
+            if (!b) return NULL;
+        }
+        p = b->data + b->used;
+        b->used += sz;
+    }
+    a->used += cls >= 0 ? (size_t)ARENA_MIN_CLASS << cls : n;
+    memcpy(p, s, n);
+    return p;
+}
+
+void arena_release(Arena *a, char *s) {
+    if (!a || !s) return;
+    int cls = size_class(strlen(s) + 1);
+    // Les grandes chaînes restent dans leur bloc jusqu'à arena_free
+    if (cls < 0) return;
+    a->used -= (size_t)ARENA_MIN_CLASS << cls;
+    memcpy(s, &a->free_lists[cls], sizeof(char *));
+    a->free_lists[cls] = s;
+}
@@ -0,0 +1,41 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE 65536  /* Taille d'un bloc d'allocation */
+#define ARENA_CLASSES 7         /* Classes de taille : 8, 16, ..., 512 octets */
+
+/* Bloc de mémoire dans lequel les chaînes sont allouées à la suite */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+} ArenaBlock;
+
+/**
+ * Arène de chaînes : allocation par simple incrément dans des blocs,
+ * listes libres par classe de taille pour réutiliser les chaînes rendues,
+ * libération de toute l'arène en une fois
+ */
+typedef struct {
+    ArenaBlock *blocks;                 /* blocs alloués (le premier est le courant) */
+    char *free_lists[ARENA_CLASSES];    /* chaînes rendues, par classe de taille */
+    size_t reserved;                    /* octets demandés au système */
+    size_t used;                        /* octets occupés par des chaînes vivantes */
+} Arena;
+
+/* Crée une arène vide */
+Arena *arena_create(void);
+
+/* Libère l'arène et toutes les chaînes qu'elle contient */
+void arena_free(Arena *a);
+
+/* Copie s dans l'arène, NULL si erreur */
+char *arena_strdup(Arena *a, const char *s);
+
+/* Rend une chaîne allouée par arena_strdup (réutilisée par sa classe de taille) */
+void arena_release(Arena *a, char *s);
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * Benchmark du démarrage du serveur avec beaucoup de comptes : génère
+ * users.txt et rooms.txt (N comptes, N/1000 salles de 100 membres) dans un
+ * dossier temporaire, démarre ./server une première fois (chargement des
+ * fichiers texte ; l'arrêt écrit l'instantané binaire) puis une seconde
+ * (chargement de l'instantané), et relève le temps de chargement affiché
+ * par le serveur. Aucun autre serveur ne doit occuper les ports.
+ * Usage : ./bench/bench_boot [nb_comptes]   (depuis la racine du dépôt)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define ROOM_MEMBERS 100
+
+/* Démarre le serveur dans dir, recopie sa ligne de chargement dans load, puis l'arrête */
+static int boot(const char *server, const char *dir, char *load, size_t cap) {
+    int fds[2];
+    if (pipe(fds) < 0) return 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        if (chdir(dir) < 0) _exit(1);
+        execl(server, "server", "-l", "-", "-w", "1", (char *)NULL);
+        _exit(1);
+    }
+    close(fds[1]);
+    FILE *out = fdopen(fds[0], "r");
+    char line[512];
+    load[0] = '\0';
+    while (fgets(line, sizeof(line), out)) {
+        if (strncmp(line, "État chargé", strlen("État chargé")) == 0) snprintf(load, cap, "%s", line);
+        if (strncmp(line, "Serveur prêt", strlen("Serveur prêt")) == 0) break;
+    }
+    kill(pid, SIGTERM);
+    while (fgets(line, sizeof(line), out)) {}   // sauvegarde à l'arrêt
+    fclose(out);
+    waitpid(pid, NULL, 0);
+    return load[0] != '\0';
+}
+
+static long file_size(const char *dir, const char *name) {
+    char path[PATH_MAX];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+int main(int argc, char *argv[]) {
+    long users = argc > 1 ? atol(argv[1]) : 1000000;
+    char server[PATH_MAX], dir[] = "/tmp/bench_boot.XXXXXX", path[PATH_MAX];
+    if (!realpath("./server", server)) {
+        fprintf(stderr, "./server introuvable : lancer depuis la racine du dépôt après make\n");
+        return 1;
+    }
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    snprintf(path, sizeof(path), "%s/users.txt", dir);
+    FILE *f = fopen(path, "w");
+    for (long i = 0; i < users; i++) fprintf(f, "%ld:utilisateur%ld:motdepasse%ld\n", i, i, i * 7919 % 100003);
+    fclose(f);
+    snprintf(path, sizeof(path), "%s/rooms.txt", dir);
+    f = fopen(path, "w");
+    long rooms = users / 1000;
+    for (long r = 0; r < rooms; r++) {
+        fprintf(f, "%ld:salle%ld:%d:", r, r, ROOM_MEMBERS);
+        for (int m = 0; m < ROOM_MEMBERS; m++) fprintf(f, "%sutilisateur%ld", m ? "," : "", (r * ROOM_MEMBERS + m) % users);
+        fprintf(f, ":utilisateur%ld\n", r * ROOM_MEMBERS % users);
+    }
+    fclose(f);
+    printf("%ld comptes, %ld salles de %d membres\n", users, rooms, ROOM_MEMBERS);
+
+    char load[512];
+    if (!boot(server, dir, load, sizeof(load))) {
+        fprintf(stderr, "le serveur n'a pas démarré (ports occupés ?)\n");
+        return 1;
+    }
+    printf("texte (users.txt %ld o, rooms.txt %ld o)  : %s",
+           file_size(dir, "users.txt"), file_size(dir, "rooms.txt"), load);
+    if (file_size(dir, "state.snap") < 0 || !boot(server, dir, load, sizeof(load))) {
+        fprintf(stderr, "instantané non écrit ou second démarrage en échec\n");
+        return 1;
+    }
+    printf("instantané binaire (state.snap %ld o) : %s", file_size(dir, "state.snap"), load);
+
+    snprintf(path, sizeof(path), "rm -rf %s", dir);
+    return system(path) == 0 ? 0 : 1;
+}
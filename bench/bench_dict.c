@@ -0,0 +1,117 @@
+/**
+ * Benchmark des recherches dans SimpleDict (table de hachage) comparées à
+ * l'ancienne implémentation par tableau linéaire, pour 1k, 100k et 1M clés,
+ * puis empreinte mémoire de 1M utilisateurs avec et sans arène.
+ * Usage : ./bench/bench_dict
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include "dict.h"
+
+#define LOOKUPS 1000000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Ancienne recherche : parcours linéaire avec strcmp */
+static const char *linear_get(Entry *entries, size_t count, const char *key) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(entries[i].key, key) == 0) return entries[i].value;
+    }
+    return NULL;
+}
+
+static void bench(size_t n) {
+    char **keys = malloc(n * sizeof(char *));
+    Entry *linear = malloc(n * sizeof(Entry));
+    SimpleDict *d = dict_create();
+    char buf[32];
+
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; i++) {
+        snprintf(buf, sizeof(buf), "user%zu", i);
+        keys[i] = strdup(buf);
+        dict_insert(d, keys[i], "password");
+        linear[i].key = keys[i];
+        linear[i].value = "password";
+    }
+    double t_insert = now_sec() - t0;
+
+    // Recherches réussies sur des clés tirées au hasard
+    unsigned seed = 42;
+    size_t found = 0;
+    t0 = now_sec();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        if (dict_get(d, keys[seed % n])) found++;
+    }
+    double ns_hash = (now_sec() - t0) * 1e9 / LOOKUPS;
+
+    // Le parcours linéaire est limité à ~1e8 comparaisons au total
+    size_t lin_lookups = 100000000 / n;
+    if (lin_lookups < 20) lin_lookups = 20;
+    if (lin_lookups > LOOKUPS) lin_lookups = LOOKUPS;
+    t0 = now_sec();
+    for (size_t i = 0; i < lin_lookups; i++) {
+        seed = seed * 1103515245 + 12345;
+        if (linear_get(linear, n, keys[seed % n])) found++;
+    }
+    double ns_linear = (now_sec() - t0) * 1e9 / lin_lookups;
+
+    printf("%8zu clés | insertion %7.1f ns/clé | recherche hachage %7.1f ns | linéaire %12.1f ns | gain x%.0f  (%zu)\n",
+           n, t_insert * 1e9 / n, ns_hash, ns_linear, ns_linear / ns_hash, found);
+
+    dict_free(d);
+    for (size_t i = 0; i < n; i++) free(keys[i]);
+    free(keys);
+    free(linear);
+}
+
+/* Octets actuellement alloués par malloc */
+static size_t heap_in_use(void) {
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+/* Empreinte de n utilisateurs (username → password), puis mise à jour de
+   tous les mots de passe et temps de libération */
+static void footprint(size_t n, int use_arena) {
+    char user[32], pwd[32];
+    size_t before = heap_in_use();
+    SimpleDict *d = use_arena ? dict_create_arena() : dict_create();
+    dict_reserve(d, n);
+    for (size_t i = 0; i < n; i++) {
+        snprintf(user, sizeof(user), "user%zu", i);
+        snprintf(pwd, sizeof(pwd), "pw%zu", i * 7919);
+        dict_insert(d, user, pwd);
+    }
+    size_t loaded = heap_in_use() - before;
+    for (size_t i = 0; i < n; i++) {
+        snprintf(user, sizeof(user), "user%zu", i);
+        snprintf(pwd, sizeof(pwd), "new%zu", i);
+        dict_insert(d, user, pwd);
+    }
+    size_t updated = heap_in_use() - before;
+    double t0 = now_sec();
+    dict_free(d);
+    double t_free = now_sec() - t0;
+    printf("%s | %zu utilisateurs | %6.1f Mo (%5.1f o/entrée) | après mise à jour %6.1f Mo | libération %7.2f ms\n",
+           use_arena ? "arène " : "strdup", n, loaded / 1e6, (double)loaded / n,
+           updated / 1e6, t_free * 1e3);
+}
+
+int main(void) {
+    size_t sizes[] = { 1000, 100000, 1000000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) bench(sizes[i]);
+
+    printf("\nEmpreinte mémoire :\n");
+    footprint(1000000, 0);
+    footprint(1000000, 1);
+    return 0;
+}
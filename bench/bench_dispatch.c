@@ -0,0 +1,63 @@
+/**
+ * Benchmark de la recherche de commande : table de hachage parfait
+ * (cmdhash) comparée à l'ancienne chaîne de strncmp, pour chaque commande
+ * de SERVER_COMMANDS et pour un jeton inconnu.
+ * Usage : ./bench/bench_dispatch
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "cmdhash.h"
+#include "globalVariables.h"
+
+#define OPS 10000000
+
+#define COMMAND_TOKEN(token, name, flags) token,
+static const char *const tokens[] = { SERVER_COMMANDS(COMMAND_TOKEN) };
+#define TOKEN_COUNT ((int)(sizeof(tokens) / sizeof(tokens[0])))
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Ancienne recherche : strncmp sur chaque préfixe, dans l'ordre de la chaîne */
+static int chain_lookup(const char *buffer) {
+    for (int i = 0; i < TOKEN_COUNT; i++) {
+        if (strncmp(buffer, tokens[i], strlen(tokens[i])) == 0) return i;
+    }
+    return -1;
+}
+
+int main(void) {
+    CmdHash h;
+    if (!cmdhash_build(&h, tokens, TOKEN_COUNT)) {
+        fprintf(stderr, "cmdhash_build a échoué\n");
+        return 1;
+    }
+    printf("%d commandes, %u cases, graine %u\n", TOKEN_COUNT, h.mask + 1, h.seed);
+
+    char lines[TOKEN_COUNT + 1][64];
+    for (int i = 0; i < TOKEN_COUNT; i++) snprintf(lines[i], sizeof(lines[i]), "%s salle message", tokens[i]);
+    snprintf(lines[TOKEN_COUNT], sizeof(lines[TOKEN_COUNT]), "@inconnue salle message");
+
+    long sink = 0;
+    for (int c = 0; c <= TOKEN_COUNT; c++) {
+        const char *volatile line = lines[c];
+        double t0 = now_sec();
+        for (int i = 0; i < OPS; i++) {
+            sink += cmdhash_lookup(&h, line, NULL);
+        }
+        double ns_hash = (now_sec() - t0) * 1e9 / OPS;
+
+        t0 = now_sec();
+        for (int i = 0; i < OPS; i++) sink += chain_lookup(line);
+        double ns_chain = (now_sec() - t0) * 1e9 / OPS;
+
+        printf("%-14s hachage %5.1f ns | chaîne strncmp %5.1f ns\n",
+               c < TOKEN_COUNT ? tokens[c] : "(inconnue)", ns_hash, ns_chain);
+    }
+    printf("(%ld)\n", sink);
+    return 0;
+}
@@ -0,0 +1,314 @@
+/**
+ * Benchmark d'une rafale de reconnexions : N comptes (mots de passe en
+ * PBKDF2, kdf.h) se reconnectent tous en même temps pendant que deux
+ * clients déjà connectés échangent des messages privés. Mesure le débit
+ * des connexions et la latence des messages, d'abord avec la vérification
+ * dans le worker UDP (-a 0, l'ancien comportement), puis avec le pool
+ * d'authentification. Aucun autre serveur ne doit occuper les ports.
+ * Usage : ./bench/bench_login [nb_comptes] [iterations_kdf]   (depuis la racine du dépôt)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "kdf.h"
+#include "globalVariables.h"
+
+#define WINDOW 256           // Connexions en vol au plus
+#define RETRY_S 3.0          // Demande sans réponse renvoyée après ce délai
+#define PROBE_MS 5           // Intervalle entre deux messages sondes
+#define BASELINE_PROBES 200  // Sondes mesurées avant la rafale
+#define MAX_PROBES 200000
+
+typedef struct {
+    int fd;
+    double sent;             // Envoi de la dernière demande (0 : pas encore envoyée)
+    int done;
+} Conn;
+
+static struct sockaddr_in server_addr;
+static double probe_sent[MAX_PROBES];
+static double *probe_lat;
+static int probe_count;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Percentile p (0..1) de v, trié en place */
+static double percentile(double *v, int n, double p) {
+    if (n == 0) return 0;
+    qsort(v, n, sizeof(double), cmp_double);
+    int i = (int)(p * (n - 1) + 0.5);
+    return v[i];
+}
+
+static int udp_socket(void) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd >= 0) fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+static void send_text(int fd, const char *text) {
+    sendto(fd, text, strlen(text), 0, (struct sockaddr *)&server_addr, sizeof(server_addr));
+}
+
+/* Attend une réponse contenant expect sur fd (connexion des sondes) */
+static int wait_reply(int fd, const char *expect, double timeout) {
+    char buf[2048];
+    double end = now_sec() + timeout;
+    while (now_sec() < end) {
+        ssize_t n = recv(fd, buf, sizeof(buf) - 1, 0);
+        if (n <= 0) {
+            usleep(1000);
+            continue;
+        }
+        buf[n] = '\0';
+        if (strstr(buf, expect)) return 1;
+    }
+    return 0;
+}
+
+/* Démarre ./server dans dir (sortie dans dir/server.log) et attend qu'il soit prêt */
+static pid_t start_server(const char *server, const char *dir, const char *threads, const char *iterations) {
+    char log[PATH_MAX];
+    snprintf(log, sizeof(log), "%s/server.log", dir);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        if (chdir(dir) < 0) _exit(1);
+        execl(server, "server", "-l", "-", "-w", "1", "-a", threads, "-k", iterations, (char *)NULL);
+        _exit(1);
+    }
+    for (int i = 0; i < 200; i++) {
+        usleep(50000);
+        FILE *f = fopen(log, "r");
+        char line[512];
+        int ready = 0;
+        while (f && !ready && fgets(line, sizeof(line), f)) ready = strstr(line, "Serveur prêt") != NULL;
+        if (f) fclose(f);
+        if (ready) return pid;
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+/* Envoie une sonde de a vers b (message privé numéroté) */
+static void send_probe(int a) {
+    if (probe_count >= MAX_PROBES) return;
+    char msg[64];
+    snprintf(msg, sizeof(msg), "@message &sonde_b lat %d", probe_count);
+    probe_sent[probe_count++] = now_sec();
+    send_text(a, msg);
+}
+
+/* Réception d'une sonde par b : latence enregistrée */
+static void recv_probes(int b, int *received) {
+    char buf[2048];
+    ssize_t n;
+    while ((n = recv(b, buf, sizeof(buf) - 1, 0)) > 0) {
+        buf[n] = '\0';
+        char *p = strstr(buf, "lat ");
+        int seq;
+        if (p && sscanf(p + 4, "%d", &seq) == 1 && seq >= 0 && seq < probe_count) {
+            probe_lat[(*received)++] = (now_sec() - probe_sent[seq]) * 1e3;
+        }
+    }
+}
+
+static void drain(int fd) {
+    char buf[2048];
+    while (recv(fd, buf, sizeof(buf), 0) > 0) {}
+}
+
+static void run(const char *label, const char *server, const char *dir, const char *threads,
+                const char *iterations, int users) {
+    pid_t pid = start_server(server, dir, threads, iterations);
+    if (pid < 0) {
+        fprintf(stderr, "%s : le serveur n'a pas démarré (ports occupés ?)\n", label);
+        exit(1);
+    }
+
+    // Deux clients connectés avant la rafale s'échangent des messages
+    int a = udp_socket(), b = udp_socket();
+    send_text(a, "@login sonde_a pw");
+    send_text(b, "@login sonde_b pw");
+    if (!wait_reply(a, "Bienvenue", 10) || !wait_reply(b, "Bienvenue", 10)) {
+        fprintf(stderr, "%s : connexion des sondes impossible\n", label);
+        exit(1);
+    }
+
+    probe_count = 0;
+    int received = 0;
+    for (int i = 0; i < BASELINE_PROBES; i++) {
+        send_probe(a);
+        struct pollfd pfd = { .fd = b, .events = POLLIN };
+        poll(&pfd, 1, 100);
+        recv_probes(b, &received);
+        drain(a);
+        usleep(PROBE_MS * 1000);
+    }
+    double idle_p50 = percentile(probe_lat, received, 0.5), idle_p99 = percentile(probe_lat, received, 0.99);
+
+    // Rafale : chaque compte se reconnecte depuis sa propre socket
+    Conn *conns = calloc(users, sizeof(Conn));
+    double *login_lat = malloc(users * sizeof(double));
+    int ep = epoll_create1(0);
+    for (int i = 0; i < users; i++) {
+        conns[i].fd = udp_socket();
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = i };
+        epoll_ctl(ep, EPOLL_CTL_ADD, conns[i].fd, &ev);
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = users };
+    epoll_ctl(ep, EPOLL_CTL_ADD, b, &ev);
+
+    probe_count = received = 0;
+    int done = 0, inflight = 0, next = 0, retries = 0, saturated = 0;
+    double start = now_sec(), next_probe = start, next_scan = start + 0.5;
+    char msg[128], buf[2048];
+    while (done < users) {
+        double now = now_sec();
+        while (inflight < WINDOW && next < users) {
+            snprintf(msg, sizeof(msg), "@login u%d pw", next);
+            conns[next].sent = now;
+            send_text(conns[next++].fd, msg);
+            inflight++;
+        }
+        // Demandes perdues (tampon de réception plein) ou refusées : renvoyées
+        if (now >= next_scan) {
+            for (int i = 0; i < next; i++) {
+                if (!conns[i].done && now - conns[i].sent > RETRY_S) {
+                    snprintf(msg, sizeof(msg), "@login u%d pw", i);
+                    conns[i].sent = now;
+                    send_text(conns[i].fd, msg);
+                    retries++;
+                }
+            }
+            next_scan = now + 0.5;
+        }
+        if (now >= next_probe) {
+            send_probe(a);
+            drain(a);
+            next_probe += PROBE_MS / 1e3;
+        }
+
+        struct epoll_event evs[64];
+        int n = epoll_wait(ep, evs, 64, 1);
+        for (int e = 0; e < n; e++) {
+            int i = evs[e].data.u32;
+            if (i == users) {
+                recv_probes(b, &received);
+                continue;
+            }
+            ssize_t len;
+            while ((len = recv(conns[i].fd, buf, sizeof(buf) - 1, 0)) > 0) {
+                buf[len] = '\0';
+                if (conns[i].done) continue;
+                if (strstr(buf, "Bienvenue")) {
+                    conns[i].done = 1;
+                    login_lat[done++] = (now_sec() - conns[i].sent) * 1e3;
+                    inflight--;
+                } else if (strstr(buf, "saturé")) {
+                    conns[i].sent = 0;   // renvoyée au prochain passage
+                    saturated++;
+                }
+            }
+        }
+    }
+    double elapsed = now_sec() - start;
+    usleep(100000);
+    recv_probes(b, &received);
+
+    printf("%s\n", label);
+    printf("  connexions : %d en %.2f s, %.0f/s ; latence p50 %.1f ms, p99 %.1f ms (%d renvoi(s), %d saturé(s))\n",
+           users, elapsed, users / elapsed, percentile(login_lat, users, 0.5), percentile(login_lat, users, 0.99),
+           retries, saturated);
+    printf("  messages   : au repos p50 %.2f ms, p99 %.2f ms ; pendant la rafale p50 %.2f ms, p99 %.2f ms, max %.2f ms (%d/%d reçus)\n",
+           idle_p50, idle_p99, percentile(probe_lat, received, 0.5), percentile(probe_lat, received, 0.99),
+           percentile(probe_lat, received, 1.0), received, probe_count);
+    fflush(stdout);
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    for (int i = 0; i < users; i++) close(conns[i].fd);
+    close(ep);
+    close(a);
+    close(b);
+    free(conns);
+    free(login_lat);
+}
+
+int main(int argc, char *argv[]) {
+    int users = argc > 1 ? atoi(argv[1]) : 10000;
+    const char *iterations = argc > 2 ? argv[2] : "2000";
+    char server[PATH_MAX], dir[] = "/tmp/bench_login.XXXXXX", path[PATH_MAX];
+    if (users <= 0 || atoi(iterations) <= 0) {
+        fprintf(stderr, "Usage: %s [nb_comptes] [iterations_kdf]\n", argv[0]);
+        return 1;
+    }
+    if (!realpath("./server", server)) {
+        fprintf(stderr, "./server introuvable : lancer depuis la racine du dépôt après make\n");
+        return 1;
+    }
+    struct rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    if (rl.rlim_cur < (rlim_t)users + 64) {
+        fprintf(stderr, "limite de descripteurs (%lu) trop basse pour %d comptes\n", (unsigned long)rl.rlim_cur, users);
+        return 1;
+    }
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(serverPort);
+    inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
+    probe_lat = malloc(MAX_PROBES * sizeof(double));
+
+    // Tous les comptes ont le même mot de passe : une seule dérivation ici,
+    // chaque connexion en coûte une au serveur
+    char record[KDF_RECORD_MAX];
+    if (!kdf_hash_password("pw", atoi(iterations), record, sizeof(record))) {
+        fprintf(stderr, "kdf_hash_password a échoué\n");
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/users.txt", dir);
+    FILE *f = fopen(path, "w");
+    for (int i = 0; i < users; i++) fprintf(f, "%d:u%d:%s\n", i, i, record);
+    fprintf(f, "%d:sonde_a:%s\n%d:sonde_b:%s\n", users, record, users + 1, record);
+    fclose(f);
+    printf("%d comptes, PBKDF2-SHA256 à %s itérations\n", users, iterations);
+
+    run("vérification dans le worker (-a 0)", server, dir, "0", iterations, users);
+    // Le premier passage a écrit l'instantané : on repart des mêmes comptes
+    snprintf(path, sizeof(path), "%s/state.snap", dir);
+    unlink(path);
+    run("pool d'authentification (-a -1)", server, dir, "-1", iterations, users);
+
+    free(probe_lat);
+    snprintf(path, sizeof(path), "rm -rf %s", dir);
+    return system(path) == 0 ? 0 : 1;
+}
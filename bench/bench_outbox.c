@@ -0,0 +1,83 @@
+/**
+ * Benchmark du regroupement des messages sortants : une rafale de messages
+ * de salle (taille typique d'un message de chat) envoyée à chaque membre,
+ * un datagramme par message (sendto) ou regroupée par l'outbox.
+ * Les membres sont des sockets UDP locales qui ne lisent pas.
+ * Usage : ./bench/bench_outbox
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "outbox.h"
+
+#define MEMBERS 100
+#define ROUNDS 20
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(int sock, const struct sockaddr_in *members, int burst) {
+    char msg[128];
+    Outbox ob;
+    if (!outbox_init(&ob, sock)) {
+        perror("outbox_init");
+        exit(1);
+    }
+
+    double t0 = now_sec();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int k = 0; k < burst; k++) {
+            int len = snprintf(msg, sizeof(msg), "[salle] utilisateur%d: message numéro %d de la rafale", k % 7, k);
+            for (int m = 0; m < MEMBERS; m++) {
+                sendto(sock, msg, len, 0, (const struct sockaddr *)&members[m], sizeof(members[m]));
+            }
+        }
+    }
+    double direct = (now_sec() - t0) / ROUNDS;
+
+    t0 = now_sec();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int k = 0; k < burst; k++) {
+            int len = snprintf(msg, sizeof(msg), "[salle] utilisateur%d: message numéro %d de la rafale", k % 7, k);
+            for (int m = 0; m < MEMBERS; m++) outbox_add(&ob, &members[m], msg, len, 0);
+        }
+        outbox_flush(&ob);
+    }
+    double grouped = (now_sec() - t0) / ROUNDS;
+
+    printf("rafale de %3d | datagrammes par membre : %3d direct, %5.1f regroupé | envoi %7.0f µs direct, %7.0f µs regroupé\n",
+           burst, burst, (double)ob.datagrams / ROUNDS / MEMBERS, direct * 1e6, grouped * 1e6);
+    outbox_destroy(&ob);
+}
+
+int main(void) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int members_fd[MEMBERS];
+    struct sockaddr_in members[MEMBERS];
+    for (int m = 0; m < MEMBERS; m++) {
+        members_fd[m] = socket(AF_INET, SOCK_DGRAM, 0);
+        memset(&members[m], 0, sizeof(members[m]));
+        members[m].sin_family = AF_INET;
+        members[m].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t lg = sizeof(members[m]);
+        if (bind(members_fd[m], (struct sockaddr *)&members[m], sizeof(members[m])) < 0 ||
+            getsockname(members_fd[m], (struct sockaddr *)&members[m], &lg) < 0) {
+            perror("bind");
+            return 1;
+        }
+    }
+
+    int bursts[] = { 1, 4, 16, 64 };
+    for (size_t i = 0; i < sizeof(bursts) / sizeof(bursts[0]); i++) bench(sock, members, bursts[i]);
+
+    for (int m = 0; m < MEMBERS; m++) close(members_fd[m]);
+    close(sock);
+    return 0;
+}
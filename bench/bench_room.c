@@ -0,0 +1,100 @@
+/**
+ * Benchmark de l'appartenance aux salles (ajout, test, retrait) pour des
+ * salles de 10 à 100k membres, comparée à l'ancien parcours linéaire avec
+ * décalage du tableau au retrait.
+ * Usage : ./bench/bench_room
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "chatroom.h"
+
+#define OPS 1000000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Ancien test d'appartenance : parcours de member_indices */
+static int linear_is_member(const int *members, int count, int client_index) {
+    for (int i = 0; i < count; i++) {
+        if (members[i] == client_index) return 1;
+    }
+    return 0;
+}
+
+/* Ancien retrait : recherche puis décalage de la fin du tableau */
+static int linear_remove(int *members, int *count, int client_index) {
+    for (int i = 0; i < *count; i++) {
+        if (members[i] == client_index) {
+            for (int j = i; j < *count - 1; j++) members[j] = members[j + 1];
+            (*count)--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void bench(int n) {
+    ChatRoom *room = chatroom_create("bench", n);
+    int *linear = malloc(n * sizeof(int));
+    int linear_count = 0;
+    // Cases client dispersées, comme après beaucoup de connexions
+    for (int i = 0; i < n; i++) {
+        chatroom_add_member(room, i * 7, 0);
+        linear[linear_count++] = i * 7;
+    }
+
+    // Tests d'appartenance (moitié membres, moitié non membres)
+    unsigned seed = 42;
+    long hits = 0;
+    double t0 = now_sec();
+    for (int i = 0; i < OPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        hits += chatroom_is_member(room, (int)(seed % (unsigned)n) * 7 + (seed >> 31));
+    }
+    double ns_contains = (now_sec() - t0) * 1e9 / OPS;
+
+    // Retrait puis réinsertion d'un membre tiré au hasard (salle toujours pleine)
+    t0 = now_sec();
+    for (int i = 0; i < OPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        int c = (int)(seed % (unsigned)n) * 7;
+        chatroom_remove_member(room, c);
+        chatroom_add_member(room, c, 0);
+    }
+    double ns_churn = (now_sec() - t0) * 1e9 / OPS;
+
+    // Le parcours linéaire est limité à ~1e8 comparaisons au total
+    int lin_ops = 100000000 / n;
+    if (lin_ops > OPS) lin_ops = OPS;
+    t0 = now_sec();
+    for (int i = 0; i < lin_ops; i++) {
+        seed = seed * 1103515245 + 12345;
+        hits += linear_is_member(linear, linear_count, (int)(seed % (unsigned)n) * 7 + (seed >> 31));
+    }
+    double ns_lin_contains = (now_sec() - t0) * 1e9 / lin_ops;
+
+    t0 = now_sec();
+    for (int i = 0; i < lin_ops; i++) {
+        seed = seed * 1103515245 + 12345;
+        int c = (int)(seed % (unsigned)n) * 7;
+        linear_remove(linear, &linear_count, c);
+        linear[linear_count++] = c;
+    }
+    double ns_lin_churn = (now_sec() - t0) * 1e9 / lin_ops;
+
+    printf("%7d membres | test %6.1f ns (linéaire %10.1f) | retrait+ajout %6.1f ns (linéaire %10.1f)  (%ld)\n",
+           n, ns_contains, ns_lin_contains, ns_churn, ns_lin_churn, hits);
+
+    chatroom_free(room);
+    free(linear);
+}
+
+int main(void) {
+    int sizes[] = { 10, 100, 1000, 10000, 100000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) bench(sizes[i]);
+    return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * Benchmark des transferts parallèles (xferclient.h) : un fichier est
+ * envoyé puis téléchargé par le vrai serveur (./server démarré dans un
+ * dossier temporaire), en morceaux répartis sur 1, 4 puis 16 connexions.
+ * Affiche le débit de chaque sens et vérifie octet par octet que le
+ * fichier publié dans uploads/ et celui reçu dans downloads/ sont
+ * identiques à la source. Sur une seule machine (boucle locale) le gain
+ * dépend surtout du nombre de cœurs ; les flux parallèles servent d'abord
+ * sur un lien où une connexion seule ne remplit pas le tuyau.
+ * Aucun autre serveur ne doit occuper les ports.
+ * Usage : ./bench/bench_streams [taille_Mio] [morceau_Mio] [réacteurs]   (depuis la racine du dépôt)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "xferclient.h"
+
+#define BLOCK (1024 * 1024)
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Démarre ./server dans dir (sortie dans dir/server.log) et attend qu'il soit prêt */
+static pid_t start_server(const char *server, const char *dir, const char *reactors) {
+    char log[PATH_MAX];
+    snprintf(log, sizeof(log), "%s/server.log", dir);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        if (chdir(dir) < 0) _exit(1);
+        execl(server, "server", "-l", "-", "-w", "1", "-x", reactors, (char *)NULL);
+        _exit(1);
+    }
+    for (int i = 0; i < 200; i++) {
+        usleep(50000);
+        FILE *f = fopen(log, "r");
+        char line[512];
+        int ready = 0;
+        while (f && !ready && fgets(line, sizeof(line), f)) ready = strstr(line, "Serveur prêt") != NULL;
+        if (f) fclose(f);
+        if (ready) return pid;
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+/* 1 si a et b ont le même contenu */
+static int same_content(const char *a, const char *b) {
+    FILE *fa = fopen(a, "rb"), *fb = fopen(b, "rb");
+    char *ba = malloc(BLOCK), *bb = malloc(BLOCK);
+    int same = fa && fb && ba && bb;
+    while (same) {
+        size_t na = fread(ba, 1, BLOCK, fa), nb = fread(bb, 1, BLOCK, fb);
+        same = na == nb && memcmp(ba, bb, na) == 0;
+        if (na == 0) break;
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    free(ba);
+    free(bb);
+    return same;
+}
+
+static void run(int streams, uint64_t size, uint64_t part_size) {
+    char name[64], uploaded[PATH_MAX], downloaded[PATH_MAX];
+    snprintf(name, sizeof(name), "flux_%d.bin", streams);
+    snprintf(uploaded, sizeof(uploaded), "uploads/%s", name);
+    snprintf(downloaded, sizeof(downloaded), "downloads/%s", name);
+    double mib = size / (1024.0 * 1024);
+
+    double t = now_sec();
+    int up = xfer_upload_parallel("source.bin", name, size, streams, part_size) == 0;
+    double up_s = now_sec() - t;
+    up = up && same_content("source.bin", uploaded);
+
+    t = now_sec();
+    int down = up && xfer_download_parallel(name, size, streams, part_size) == 0;
+    double down_s = now_sec() - t;
+    down = down && same_content("source.bin", downloaded);
+
+    printf("  %2d flux   upload %7.0f Mio/s%s   download %7.0f Mio/s%s\n", streams, mib / up_s,
+           up ? "" : " (ÉCHEC)", mib / down_s, down ? "" : " (ÉCHEC)");
+    unlink(uploaded);
+    unlink(downloaded);
+}
+
+int main(int argc, char *argv[]) {
+    long mib = argc > 1 ? atol(argv[1]) : 512;
+    long part_mib = argc > 2 ? atol(argv[2]) : 16;
+    const char *reactors = argc > 3 ? argv[3] : "4";
+    char server[PATH_MAX], dir[] = "/tmp/bench_streams.XXXXXX", path[PATH_MAX];
+    if (mib <= 0 || part_mib <= 0 || atoi(reactors) <= 0) {
+        fprintf(stderr, "Usage: %s [taille_Mio] [morceau_Mio] [réacteurs]\n", argv[0]);
+        return 1;
+    }
+    if (!realpath("./server", server)) {
+        fprintf(stderr, "./server introuvable : lancer depuis la racine du dépôt après make\n");
+        return 1;
+    }
+    if (!mkdtemp(dir) || chdir(dir) < 0) {
+        perror("mkdtemp");
+        return 1;
+    }
+    uint64_t size = (uint64_t)mib * 1024 * 1024, part_size = (uint64_t)part_mib * 1024 * 1024;
+
+    // Fichier source : un bloc pseudo-aléatoire répété
+    FILE *f = fopen("source.bin", "wb");
+    char *block = malloc(BLOCK);
+    if (!f || !block) {
+        perror("source.bin");
+        return 1;
+    }
+    srand(42);
+    for (size_t i = 0; i < BLOCK; i++) block[i] = (char)rand();
+    for (uint64_t off = 0; off < size; off += BLOCK) fwrite(block, 1, BLOCK, f);
+    fclose(f);
+    free(block);
+
+    pid_t pid = start_server(server, dir, reactors);
+    if (pid < 0) {
+        fprintf(stderr, "le serveur n'a pas démarré (voir %s/server.log)\n", dir);
+        return 1;
+    }
+    printf("Fichier de %ld Mio, morceaux de %ld Mio, %s réacteurs, connexion TCP locale\n", mib, part_mib, reactors);
+    int streams[] = { 1, 4, 16 };
+    for (size_t i = 0; i < sizeof(streams) / sizeof(streams[0]); i++) run(streams[i], size, part_size);
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    snprintf(path, sizeof(path), "rm -rf %s", dir);
+    return system(path) == 0 ? 0 : 1;
+}
@@ -0,0 +1,293 @@
+/**
+ * Benchmark des chemins de transfert de fichiers sur une connexion TCP
+ * locale : génère un fichier de plusieurs Gio (en cache de pages après
+ * l'écriture), puis mesure le temps CPU du seul thread qui sert le
+ * transfert et le débit obtenu.
+ *
+ *   téléchargement : fread 4 Kio + send + trace (serveur d'origine),
+ *                    read + send par blocs de XFER_CHUNK (repli de xfer.c),
+ *                    sendfile (xfer.c)
+ *   upload         : recv 4 Kio + fwrite (serveur d'origine),
+ *                    recv + write par blocs de XFER_CHUNK (repli de xfer.c),
+ *                    splice socket → tube → fichier (xfer.c)
+ *
+ * L'autre extrémité (lecture ou envoi) tourne dans un thread à part et
+ * n'est pas comptée. Le fichier source et le fichier reçu sont créés dans
+ * le dossier donné (par défaut /tmp) puis supprimés.
+ * Usage : ./bench/bench_xfer [taille_Mio] [dossier]
+ */
+#define _GNU_SOURCE
+#include "xfer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+
+#define OLD_BUFFER_SIZE 4096   // FILE_BUFFER_SIZE du serveur d'origine
+#define SINK_BUFFER (1024 * 1024)
+
+typedef struct {
+    int sock;
+    int file;      // Source de l'envoi (upload), -1 pour un simple puits
+    off_t size;
+    long long bytes;
+} Peer;
+
+static double cpu_seconds(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Connexion TCP locale : *a et *b sont les deux extrémités */
+static int tcp_pair(int *a, int *b) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    int l = socket(AF_INET, SOCK_STREAM, 0);
+    if (l < 0 || bind(l, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(l, 1) < 0 ||
+        getsockname(l, (struct sockaddr *)&addr, &len) < 0) {
+        perror("socket d'écoute");
+        return 0;
+    }
+    *a = socket(AF_INET, SOCK_STREAM, 0);
+    if (*a < 0 || connect(*a, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        return 0;
+    }
+    *b = accept(l, NULL, NULL);
+    close(l);
+    return *b >= 0;
+}
+
+/* Extrémité non mesurée : lit jusqu'à la fin du flux, ou envoie le fichier */
+static void *peer_main(void *arg) {
+    Peer *p = arg;
+    if (p->file < 0) {
+        char *buf = malloc(SINK_BUFFER);
+        ssize_t n;
+        while ((n = recv(p->sock, buf, SINK_BUFFER, 0)) > 0) p->bytes += n;
+        free(buf);
+    } else {
+        off_t off = 0;
+        while (off < p->size) {
+            ssize_t n = sendfile(p->sock, p->file, &off, p->size - off);
+            if (n <= 0) break;
+        }
+        p->bytes = off;
+        shutdown(p->sock, SHUT_WR);
+    }
+    return NULL;
+}
+
+/* ---- Téléchargement : le thread mesuré envoie le fichier ---- */
+
+static long long download_old(int sock, int file, off_t size) {
+    // Comme l'ancien handle_file_download : stdio, petits blocs, une trace par bloc
+    FILE *in = fdopen(dup(file), "rb");
+    FILE *trace = fopen("/dev/null", "w");
+    char buffer[OLD_BUFFER_SIZE];
+    size_t n;
+    long long total = 0;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (send(sock, buffer, n, MSG_NOSIGNAL) < 0) break;
+        total += n;
+        fprintf(trace, "Progression: %lld/%ld octets envoyés\r", total, (long)size);
+    }
+    fclose(trace);
+    fclose(in);
+    return total;
+}
+
+static long long download_copy(int sock, int file, off_t size) {
+    (void)size;
+    char *buf = malloc(XFER_CHUNK);
+    ssize_t n;
+    long long total = 0;
+    while ((n = read(file, buf, XFER_CHUNK)) > 0) {
+        for (ssize_t off = 0; off < n;) {
+            ssize_t k = send(sock, buf + off, n - off, MSG_NOSIGNAL);
+            if (k < 0) {
+                free(buf);
+                return total;
+            }
+            off += k;
+            total += k;
+        }
+    }
+    free(buf);
+    return total;
+}
+
+static long long download_sendfile(int sock, int file, off_t size) {
+    (void)size;
+    ssize_t n;
+    long long total = 0;
+    while ((n = sendfile(sock, file, NULL, XFER_ZEROCOPY_CHUNK)) > 0) total += n;
+    if (n < 0) perror("sendfile");
+    return total;
+}
+
+/* ---- Upload : le thread mesuré reçoit dans le fichier ---- */
+
+static long long upload_old(int sock, int file) {
+    // Comme l'ancien handle_file_upload : recv 4 Kio puis fwrite
+    FILE *out = fdopen(dup(file), "wb");
+    char buffer[OLD_BUFFER_SIZE];
+    ssize_t n;
+    long long total = 0;
+    while ((n = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+        fwrite(buffer, 1, n, out);
+        total += n;
+    }
+    fclose(out);
+    return total;
+}
+
+static long long upload_copy(int sock, int file) {
+    char *buf = malloc(XFER_CHUNK);
+    ssize_t n;
+    long long total = 0;
+    while ((n = recv(sock, buf, XFER_CHUNK, 0)) > 0) {
+        for (ssize_t off = 0; off < n;) {
+            ssize_t k = write(file, buf + off, n - off);
+            if (k < 0) {
+                free(buf);
+                return total;
+            }
+            off += k;
+        }
+        total += n;
+    }
+    free(buf);
+    return total;
+}
+
+static long long upload_splice(int sock, int file) {
+    int fds[2];
+    if (pipe(fds) < 0) return 0;
+    fcntl(fds[1], F_SETPIPE_SZ, XFER_ZEROCOPY_CHUNK);
+    ssize_t n;
+    long long total = 0;
+    while ((n = splice(sock, NULL, fds[1], NULL, XFER_ZEROCOPY_CHUNK, SPLICE_F_MOVE)) > 0) {
+        for (ssize_t left = n; left > 0;) {
+            ssize_t k = splice(fds[0], NULL, file, NULL, left, SPLICE_F_MOVE);
+            if (k <= 0) {
+                perror("splice tube → fichier");
+                n = -1;
+                break;
+            }
+            left -= k;
+        }
+        if (n < 0) break;
+        total += n;
+    }
+    if (n < 0) perror("splice");
+    close(fds[0]);
+    close(fds[1]);
+    return total;
+}
+
+static void report(const char *label, long long bytes, off_t size, double cpu, double wall) {
+    double gib = bytes / (1024.0 * 1024 * 1024);
+    printf("  %-34s %7.3f s CPU/Gio  %7.0f Mio/s%s\n", label, cpu / gib, bytes / (1024.0 * 1024) / wall,
+           bytes == size ? "" : "  (transfert incomplet)");
+}
+
+static void bench_download(const char *label, long long (*fn)(int, int, off_t), const char *src, off_t size) {
+    int a, b;
+    if (!tcp_pair(&a, &b)) exit(1);
+    int file = open(src, O_RDONLY);
+    Peer sink = { .sock = b, .file = -1, .size = size };
+    pthread_t tid;
+    pthread_create(&tid, NULL, peer_main, &sink);
+
+    double cpu = cpu_seconds(), wall = now_seconds();
+    long long sent = fn(a, file, size);
+    cpu = cpu_seconds() - cpu;
+    shutdown(a, SHUT_WR);
+    pthread_join(tid, NULL);
+    wall = now_seconds() - wall;
+    close(file);
+    close(a);
+    close(b);
+    report(label, sent == sink.bytes ? sent : -1, size, cpu, wall);
+}
+
+static void bench_upload(const char *label, long long (*fn)(int, int), const char *src, const char *dst, off_t size) {
+    int a, b;
+    if (!tcp_pair(&a, &b)) exit(1);
+    int in = open(src, O_RDONLY);
+    int out = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    Peer source = { .sock = a, .file = in, .size = size };
+    pthread_t tid;
+    pthread_create(&tid, NULL, peer_main, &source);
+
+    double cpu = cpu_seconds(), wall = now_seconds();
+    long long received = fn(b, out);
+    cpu = cpu_seconds() - cpu;
+    wall = now_seconds() - wall;
+    pthread_join(tid, NULL);
+    close(in);
+    close(out);
+    close(a);
+    close(b);
+    unlink(dst);
+    report(label, received, size, cpu, wall);
+}
+
+int main(int argc, char *argv[]) {
+    long mib = argc > 1 ? atol(argv[1]) : 2048;
+    const char *dir = argc > 2 ? argv[2] : "/tmp";
+    off_t size = (off_t)mib * 1024 * 1024;
+    char src[PATH_MAX], dst[PATH_MAX];
+    snprintf(src, sizeof(src), "%s/bench_xfer.%d.src", dir, (int)getpid());
+    snprintf(dst, sizeof(dst), "%s/bench_xfer.%d.dst", dir, (int)getpid());
+
+    // Fichier source : un bloc pseudo-aléatoire répété
+    int fd = open(src, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    char *block = malloc(SINK_BUFFER);
+    if (fd < 0 || !block) {
+        perror(src);
+        return 1;
+    }
+    srand(42);
+    for (size_t i = 0; i < SINK_BUFFER; i++) block[i] = (char)rand();
+    for (off_t off = 0; off < size; off += SINK_BUFFER) {
+        if (write(fd, block, SINK_BUFFER) != SINK_BUFFER) {
+            perror("écriture du fichier source");
+            unlink(src);
+            return 1;
+        }
+    }
+    fsync(fd);
+    close(fd);
+    free(block);
+
+    printf("Fichier de %ld Mio, connexion TCP locale ; CPU du thread qui sert le transfert\n", mib);
+    printf("Téléchargement (fichier → socket) :\n");
+    bench_download("fread 4 Kio + send + trace", download_old, src, size);
+    bench_download("read + send 64 Kio", download_copy, src, size);
+    bench_download("sendfile", download_sendfile, src, size);
+    printf("Upload (socket → fichier) :\n");
+    bench_upload("recv 4 Kio + fwrite", upload_old, src, dst, size);
+    bench_upload("recv + write 64 Kio", upload_copy, src, dst, size);
+    bench_upload("splice par un tube", upload_splice, src, dst, size);
+    unlink(src);
+    return 0;
+}
@@ -0,0 +1,665 @@
+#define _GNU_SOURCE
+#include "chatlog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LOG_RECORD_MAX 8192          /* charge utile max d'un enregistrement (texte tronqué au-delà) */
+
+static uint64_t wall_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint32_t fnv1a(uint32_t x, const void *data, size_t n) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < n; i++) {
+        x ^= p[i];
+        x *= 16777619u;
+    }
+    return x;
+}
+
+static uint32_t record_check(const LogRecordHeader *h, const char *payload) {
+    uint32_t x = fnv1a(2166136261u, &h->seq, sizeof(h->seq));
+    x = fnv1a(x, &h->time_us, sizeof(h->time_us));
+    return fnv1a(x, payload, h->len);
+}
+
+static void segment_path(const ChatLog *log, uint64_t base, const char *ext, char *path, size_t cap) {
+    snprintf(path, cap, "%s/%020llu.%s", log->dir, (unsigned long long)base, ext);
+}
+
+/* Écrit n octets en entier, 0 si erreur */
+static int write_full(int fd, const void *buf, size_t n) {
+    const char *p = buf;
+    while (n) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += w;
+        n -= w;
+    }
+    return 1;
+}
+
+/* Rend durable la création ou la suppression d'un fichier du dossier */
+static void sync_dir(const ChatLog *log) {
+    int fd = open(log->dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+static int index_push(LogSegment *seg, uint64_t seq, size_t offset) {
+    if (seg->index_count == seg->index_capacity) {
+        int capacity = seg->index_capacity ? seg->index_capacity * 2 : 64;
+        LogIndexEntry *index = realloc(seg->index, capacity * sizeof(LogIndexEntry));
+        if (!index) return 0;
+        seg->index = index;
+        seg->index_capacity = capacity;
+    }
+    seg->index[seg->index_count++] = (LogIndexEntry){ seq, offset };
+    return 1;
+}
+
+/* Un enregistrement commençant en off mérite-t-il une entrée d'index ? */
+static int needs_index(const LogSegment *seg, size_t off) {
+    return seg->index_count == 0 || off >= seg->index[seg->index_count - 1].offset + LOG_INDEX_INTERVAL;
+}
+
+/*
+ * Vérifie les enregistrements de seg entre off et size, complète l'index
+ * et last_seq/last_time_us. Retourne la fin du dernier enregistrement valide.
+ */
+static size_t segment_scan(LogSegment *seg, size_t off, size_t size) {
+    uint64_t prev = seg->last_seq;
+    while (off + sizeof(LogRecordHeader) <= size) {
+        LogRecordHeader h;
+        memcpy(&h, seg->map + off, sizeof(h));
+        if (h.len < 3 || h.len > LOG_RECORD_MAX || off + sizeof(h) + h.len > size) break;
+        if ((prev && h.seq <= prev) || h.seq < seg->base_seq) break;
+        if (record_check(&h, seg->map + off + sizeof(h)) != h.check) break;
+        if (needs_index(seg, off) && !index_push(seg, h.seq, off)) break;
+        seg->last_seq = prev = h.seq;
+        seg->last_time_us = h.time_us;
+        off += sizeof(h) + h.len;
+    }
+    return off;
+}
+
+static void segment_free(LogSegment *seg) {
+    if (!seg) return;
+    if (seg->map && seg->map != MAP_FAILED) munmap((void *)seg->map, seg->map_len);
+    if (seg->fd >= 0) close(seg->fd);
+    if (seg->idx_fd >= 0) close(seg->idx_fd);
+    free(seg->index);
+    free(seg->targets);
+    pthread_mutex_destroy(&seg->targets_lock);
+    free(seg);
+}
+
+/* Réécrit le fichier d'index de seg à partir de l'index en mémoire */
+static int segment_write_index(const ChatLog *log, LogSegment *seg) {
+    char path[320];
+    segment_path(log, seg->base_seq, "idx", path, sizeof(path));
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    if (!write_full(fd, seg->index, seg->index_count * sizeof(LogIndexEntry))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * Charge un segment existant : projection, index (reconstruit après sa
+ * dernière entrée), fin déchirée tronquée. active : le segment reste
+ * ouvert en ajout. NULL si le segment est vide ou illisible.
+ */
+static LogSegment *segment_load(ChatLog *log, uint64_t base, int active) {
+    char path[320];
+    LogSegment *seg = calloc(1, sizeof(LogSegment));
+    if (!seg) return NULL;
+    pthread_mutex_init(&seg->targets_lock, NULL);
+    seg->base_seq = base;
+    seg->idx_fd = -1;
+    segment_path(log, base, "log", path, sizeof(path));
+    seg->fd = open(path, O_RDWR | O_APPEND);
+    struct stat st;
+    if (seg->fd < 0 || fstat(seg->fd, &st) < 0) {
+        segment_free(seg);
+        return NULL;
+    }
+    size_t size = st.st_size;
+    if (size >= log->segment_bytes) active = 0;
+    if (size == 0 && !active) {
+        segment_free(seg);
+        return NULL;
+    }
+    seg->map_len = active ? log->segment_bytes : size;
+    seg->map = mmap(NULL, seg->map_len, PROT_READ, MAP_SHARED, seg->fd, 0);
+    if (seg->map == MAP_FAILED) {
+        segment_free(seg);
+        return NULL;
+    }
+
+    // Index sur disque : on garde les entrées cohérentes, puis on vérifie
+    // les enregistrements à partir de la dernière
+    segment_path(log, base, "idx", path, sizeof(path));
+    int idx = open(path, O_RDONLY);
+    int stored = 0;
+    if (idx >= 0) {
+        LogIndexEntry e;
+        while (read(idx, &e, sizeof(e)) == (ssize_t)sizeof(e)) {
+            if (e.offset >= size || e.seq < base ||
+                (seg->index_count && (e.seq <= seg->index[seg->index_count - 1].seq ||
+                                      e.offset <= seg->index[seg->index_count - 1].offset))) break;
+            if (!index_push(seg, e.seq, e.offset)) break;
+        }
+        close(idx);
+        stored = seg->index_count;
+    }
+    size_t from = 0;
+    if (seg->index_count) {
+        from = seg->index[seg->index_count - 1].offset;
+        seg->index_count--;   // réinscrite par segment_scan
+        seg->last_seq = seg->index_count ? seg->index[seg->index_count - 1].seq : 0;
+    }
+    size_t end = segment_scan(seg, from, size);
+    if (end < size) {
+        fprintf(stderr, "Journal : segment %020llu tronqué de %zu à %zu octets\n",
+                (unsigned long long)base, size, end);
+        if (ftruncate(seg->fd, end) < 0) perror("ftruncate journal");
+    }
+    seg->size = end;
+    if (seg->size == 0 && !active) {
+        segment_free(seg);
+        return NULL;
+    }
+
+    if (seg->index_count != stored || end < size) {
+        seg->idx_fd = segment_write_index(log, seg);
+    } else if (active) {
+        seg->idx_fd = open(path, O_WRONLY | O_APPEND);
+    }
+    if (active) {
+        if (seg->idx_fd >= 0) {
+            int flags = fcntl(seg->idx_fd, F_GETFL);
+            fcntl(seg->idx_fd, F_SETFL, flags | O_APPEND);
+        }
+    } else {
+        if (seg->idx_fd >= 0) close(seg->idx_fd);
+        close(seg->fd);
+        seg->idx_fd = seg->fd = -1;
+    }
+    return seg;
+}
+
+static int push_segment(ChatLog *log, LogSegment *seg) {
+    if (log->seg_count == log->seg_capacity) {
+        int capacity = log->seg_capacity ? log->seg_capacity * 2 : 16;
+        LogSegment **segs = realloc(log->segs, capacity * sizeof(LogSegment *));
+        if (!segs) return 0;
+        log->segs = segs;
+        log->seg_capacity = capacity;
+    }
+    log->segs[log->seg_count++] = seg;
+    return 1;
+}
+
+/* Scelle le segment actif et en ouvre un nouveau commençant à base, 0 si erreur */
+static int roll_segment(ChatLog *log, uint64_t base) {
+    char path[320];
+    LogSegment *seg = calloc(1, sizeof(LogSegment));
+    if (!seg) return 0;
+    pthread_mutex_init(&seg->targets_lock, NULL);
+    seg->base_seq = base;
+    segment_path(log, base, "log", path, sizeof(path));
+    seg->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_TRUNC, 0644);
+    segment_path(log, base, "idx", path, sizeof(path));
+    seg->idx_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_TRUNC, 0644);
+    seg->map_len = log->segment_bytes;
+    seg->map = seg->fd < 0 ? MAP_FAILED : mmap(NULL, seg->map_len, PROT_READ, MAP_SHARED, seg->fd, 0);
+    if (seg->fd < 0 || seg->idx_fd < 0 || seg->map == MAP_FAILED) {
+        perror("Journal : création de segment");
+        segment_free(seg);
+        return 0;
+    }
+    sync_dir(log);
+
+    pthread_rwlock_wrlock(&log->seg_lock);
+    LogSegment *old = log->seg_count ? log->segs[log->seg_count - 1] : NULL;
+    int ok = push_segment(log, seg);
+    pthread_rwlock_unlock(&log->seg_lock);
+    if (!ok) {
+        segment_free(seg);
+        return 0;
+    }
+    // Le segment scellé reste projeté ; seuls ses descripteurs sont fermés
+    if (old && old->fd >= 0) {
+        close(old->fd);
+        if (old->idx_fd >= 0) close(old->idx_fd);
+        old->fd = old->idx_fd = -1;
+    }
+    return 1;
+}
+
+/*
+ * Écrit un lot d'enregistrements : un write et un fdatasync par segment
+ * touché, puis publication des nouvelles tailles et entrées d'index.
+ */
+static void write_batch(ChatLog *log, char *buf, size_t n) {
+    size_t pos = 0;
+    while (pos < n) {
+        LogSegment *seg = log->seg_count ? log->segs[log->seg_count - 1] : NULL;
+        LogRecordHeader h;
+        memcpy(&h, buf + pos, sizeof(h));
+        if (!seg || seg->fd < 0 || (seg->size && seg->size + sizeof(h) + h.len > log->segment_bytes)) {
+            if (!roll_segment(log, h.seq)) {
+                log->write_errors++;
+                break;
+            }
+            continue;
+        }
+
+        // Enregistrements qui tiennent dans le segment actif, sommes de contrôle comprises
+        size_t end = pos, seg_end = seg->size;
+        while (end < n) {
+            memcpy(&h, buf + end, sizeof(h));
+            size_t rec = sizeof(h) + h.len;
+            if (seg_end + rec > log->segment_bytes) break;
+            h.check = record_check(&h, buf + end + sizeof(h));
+            memcpy(buf + end, &h, sizeof(h));
+            end += rec;
+            seg_end += rec;
+        }
+        if (!write_full(seg->fd, buf + pos, end - pos) || fdatasync(seg->fd) < 0) {
+            perror("Journal : écriture");
+            log->write_errors++;
+            if (ftruncate(seg->fd, seg->size) < 0) perror("ftruncate journal");
+            pos = end;
+            continue;
+        }
+        log->commits++;
+
+        int first_new = seg->index_count;
+        pthread_rwlock_wrlock(&log->seg_lock);
+        for (size_t off = pos; off < end; off += sizeof(h) + h.len) {
+            memcpy(&h, buf + off, sizeof(h));
+            size_t at = seg->size + (off - pos);
+            if (needs_index(seg, at)) index_push(seg, h.seq, at);
+            seg->last_seq = h.seq;
+            seg->last_time_us = h.time_us;
+        }
+        seg->size = seg_end;
+        pthread_rwlock_unlock(&log->seg_lock);
+
+        // L'index se reconstruit à l'ouverture : pas de synchronisation
+        if (seg->idx_fd >= 0 && seg->index_count > first_new &&
+            !write_full(seg->idx_fd, seg->index + first_new, (seg->index_count - first_new) * sizeof(LogIndexEntry))) {
+            log->write_errors++;
+        }
+        pos = end;
+    }
+}
+
+/* Supprime les segments scellés dont le dernier message a dépassé la rétention */
+static void drop_expired(ChatLog *log) {
+    if (!log->retention_us) return;
+    uint64_t now = wall_us();
+    while (log->seg_count > 1 && log->segs[0]->last_time_us + log->retention_us < now) {
+        pthread_rwlock_wrlock(&log->seg_lock);
+        LogSegment *seg = log->segs[0];
+        memmove(log->segs, log->segs + 1, (log->seg_count - 1) * sizeof(LogSegment *));
+        log->seg_count--;
+        pthread_rwlock_unlock(&log->seg_lock);
+
+        char path[320];
+        segment_path(log, seg->base_seq, "log", path, sizeof(path));
+        unlink(path);
+        segment_path(log, seg->base_seq, "idx", path, sizeof(path));
+        unlink(path);
+        segment_free(seg);
+        sync_dir(log);
+    }
+}
+
+static void *writer_main(void *arg) {
+    ChatLog *log = arg;
+    for (;;) {
+        pthread_mutex_lock(&log->lock);
+        if (!log->pending_len && !log->stop) {
+            // Réveil au moins une fois par seconde pour la rétention
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += 1;
+            pthread_cond_timedwait(&log->wake, &log->lock, &deadline);
+        }
+        if (!log->pending_len && log->stop) {
+            pthread_mutex_unlock(&log->lock);
+            break;
+        }
+        // Les producteurs continuent dans l'autre tampon pendant l'écriture
+        char *batch = log->pending;
+        size_t n = log->pending_len;
+        log->pending = log->writing;
+        log->writing = batch;
+        log->pending_len = 0;
+        pthread_mutex_unlock(&log->lock);
+
+        if (n) write_batch(log, batch, n);
+        drop_expired(log);
+    }
+    return NULL;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+ChatLog *chatlog_open(const char *dir, size_t segment_bytes, unsigned retention_hours) {
+    ChatLog *log = calloc(1, sizeof(ChatLog));
+    if (!log) return NULL;
+    snprintf(log->dir, sizeof(log->dir), "%s", dir);
+    log->segment_bytes = segment_bytes < LOG_MIN_SEGMENT ? LOG_MIN_SEGMENT : segment_bytes;
+    log->retention_us = (uint64_t)retention_hours * 3600 * 1000000;
+    log->next_seq = 1;
+    pthread_rwlock_init(&log->seg_lock, NULL);
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->wake, NULL);
+
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        perror("Journal : mkdir");
+        chatlog_close(log);
+        return NULL;
+    }
+
+    // Segments existants, par seq de base croissant
+    uint64_t *bases = NULL;
+    int base_count = 0, base_capacity = 0;
+    DIR *d = opendir(dir);
+    if (!d) {
+        perror("Journal : opendir");
+        chatlog_close(log);
+        return NULL;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        unsigned long long base;
+        char ext[8];
+        if (strlen(ent->d_name) != 24 || sscanf(ent->d_name, "%20llu.%3s", &base, ext) != 2 ||
+            strcmp(ext, "log") != 0) continue;
+        if (base_count == base_capacity) {
+            base_capacity = base_capacity ? base_capacity * 2 : 16;
+            uint64_t *grown = realloc(bases, base_capacity * sizeof(uint64_t));
+            if (!grown) break;
+            bases = grown;
+        }
+        bases[base_count++] = base;
+    }
+    closedir(d);
+    if (base_count) qsort(bases, base_count, sizeof(uint64_t), compare_u64);
+
+    for (int i = 0; i < base_count; i++) {
+        LogSegment *seg = segment_load(log, bases[i], i == base_count - 1);
+        if (!seg) continue;
+        if (!push_segment(log, seg)) {
+            segment_free(seg);
+            continue;
+        }
+        if (seg->last_seq >= log->next_seq) log->next_seq = seg->last_seq + 1;
+        if (seg->base_seq > log->next_seq) log->next_seq = seg->base_seq;
+    }
+    free(bases);
+
+    log->pending = malloc(LOG_BUFFER_BYTES);
+    log->writing = malloc(LOG_BUFFER_BYTES);
+    if (!log->pending || !log->writing ||
+        pthread_create(&log->writer, NULL, writer_main, log) != 0) {
+        chatlog_close(log);
+        return NULL;
+    }
+    log->writer_started = 1;
+    return log;
+}
+
+void chatlog_stop(ChatLog *log) {
+    if (!log->writer_started) return;
+    pthread_mutex_lock(&log->lock);
+    log->stop = 1;
+    pthread_cond_signal(&log->wake);
+    pthread_mutex_unlock(&log->lock);
+    pthread_join(log->writer, NULL);
+    log->writer_started = 0;
+}
+
+void chatlog_close(ChatLog *log) {
+    if (!log) return;
+    chatlog_stop(log);
+    for (int i = 0; i < log->seg_count; i++) segment_free(log->segs[i]);
+    free(log->segs);
+    free(log->pending);
+    free(log->writing);
+    pthread_rwlock_destroy(&log->seg_lock);
+    pthread_mutex_destroy(&log->lock);
+    pthread_cond_destroy(&log->wake);
+    free(log);
+}
+
+uint64_t chatlog_append(ChatLog *log, char kind, const char *target,
+                        const char *sender, const char *message) {
+    size_t target_len = strlen(target) + 1, sender_len = strlen(sender) + 1;
+    size_t message_len = strlen(message);
+    if (1 + target_len + sender_len + message_len > LOG_RECORD_MAX) {
+        message_len = 1 + target_len + sender_len < LOG_RECORD_MAX ? LOG_RECORD_MAX - 1 - target_len - sender_len : 0;
+    }
+    LogRecordHeader h = { .len = 1 + target_len + sender_len + message_len };
+    size_t rec = sizeof(h) + h.len;
+
+    pthread_mutex_lock(&log->lock);
+    h.seq = log->next_seq++;
+    h.time_us = wall_us();
+    if (h.len > LOG_RECORD_MAX || log->pending_len + rec > LOG_BUFFER_BYTES) {
+        log->dropped++;
+        pthread_mutex_unlock(&log->lock);
+        return h.seq;
+    }
+    char *p = log->pending + log->pending_len;
+    memcpy(p, &h, sizeof(h));
+    p += sizeof(h);
+    *p++ = kind;
+    memcpy(p, target, target_len);
+    memcpy(p + target_len, sender, sender_len);
+    memcpy(p + target_len + sender_len, message, message_len);
+    // Le thread d'écriture n'attend que si le tampon était vide
+    if (log->pending_len == 0) pthread_cond_signal(&log->wake);
+    log->pending_len += rec;
+    log->appended++;
+    pthread_mutex_unlock(&log->lock);
+    return h.seq;
+}
+
+/* Découpe la charge utile d'un enregistrement, 0 si elle est malformée */
+static int parse_record(const char *payload, size_t len, const char **target,
+                        const char **sender, const char **message, size_t *message_len) {
+    const char *end = payload + len;
+    const char *t = payload + 1;
+    const char *z = memchr(t, '\0', end - t);
+    if (!z) return 0;
+    const char *s = z + 1;
+    z = memchr(s, '\0', end - s);
+    if (!z) return 0;
+    *target = t;
+    *sender = s;
+    *message = z + 1;
+    *message_len = end - (z + 1);
+    return 1;
+}
+
+/* Première entrée d'index de seq >= before (index_count si aucune) */
+static int index_bound(const LogSegment *seg, uint64_t before) {
+    int lo = 0, hi = seg->index_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (seg->index[mid].seq < before) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+typedef struct {
+    const LogSegment *seg;
+    size_t off;
+} LogHit;
+
+static uint32_t target_hash(const char *target) {
+    uint32_t x = fnv1a(2166136261u, target, strlen(target));
+    return x ? x : 1;
+}
+
+static int targets_insert(LogSegment *seg, uint32_t hash) {
+    if (2 * (seg->target_count + 1) > seg->target_capacity) {
+        size_t capacity = seg->target_capacity ? seg->target_capacity * 2 : 64;
+        uint32_t *targets = calloc(capacity, sizeof(uint32_t));
+        if (!targets) return 0;
+        for (size_t i = 0; i < seg->target_capacity; i++) {
+            if (!seg->targets[i]) continue;
+            size_t j = seg->targets[i] & (capacity - 1);
+            while (targets[j]) j = (j + 1) & (capacity - 1);
+            targets[j] = seg->targets[i];
+        }
+        free(seg->targets);
+        seg->targets = targets;
+        seg->target_capacity = capacity;
+    }
+    size_t j = hash & (seg->target_capacity - 1);
+    while (seg->targets[j] && seg->targets[j] != hash) j = (j + 1) & (seg->target_capacity - 1);
+    if (!seg->targets[j]) {
+        seg->targets[j] = hash;
+        seg->target_count++;
+    }
+    return 1;
+}
+
+/*
+ * target (empreinte hash) apparaît-il dans seg ? Les enregistrements écrits
+ * depuis la lecture précédente sont d'abord ajoutés à l'ensemble : chacun
+ * n'est parcouru qu'une fois. L'appelant détient seg_lock en lecture.
+ */
+static int segment_has_target(LogSegment *seg, uint32_t hash) {
+    pthread_mutex_lock(&seg->targets_lock);
+    size_t off = seg->targets_end;
+    int complete = 1;
+    while (off < seg->size) {
+        LogRecordHeader h;
+        memcpy(&h, seg->map + off, sizeof(h));
+        const char *t, *sender, *message;
+        size_t message_len;
+        if (parse_record(seg->map + off + sizeof(h), h.len, &t, &sender, &message, &message_len) &&
+            !targets_insert(seg, target_hash(t))) {
+            complete = 0;
+            break;
+        }
+        off += sizeof(h) + h.len;
+    }
+    seg->targets_end = off;
+    int found = !complete;   // ensemble incomplet (mémoire) : on lit le segment
+    if (!found) {
+        size_t j = hash & (seg->target_capacity - 1);
+        while (seg->target_capacity && seg->targets[j]) {
+            if (seg->targets[j] == hash) {
+                found = 1;
+                break;
+            }
+            j = (j + 1) & (seg->target_capacity - 1);
+        }
+    }
+    pthread_mutex_unlock(&seg->targets_lock);
+    return found;
+}
+
+int chatlog_read(ChatLog *log, char kind, const char *target, uint64_t before,
+                 int skip, int count, ChatLogVisit visit, void *ctx, int *total) {
+    int need = skip + count + 1, found = 0;
+    LogHit *hits = malloc(need * sizeof(LogHit));
+    size_t *block = NULL;
+    int block_capacity = 0;
+    if (!hits) {
+        *total = 0;
+        return 0;
+    }
+
+    // Du segment le plus récent au plus ancien, en sautant ceux où target
+    // n'apparaît pas, et dans chacun des blocs de l'index clairsemé du plus
+    // récent au plus ancien : une page récente ne lit que la fin du journal
+    uint32_t hash = target_hash(target);
+    int ended = 0;   // marque 'X' atteinte : rien de plus ancien n'appartient à la salle
+    pthread_rwlock_rdlock(&log->seg_lock);
+    for (int s = log->seg_count - 1; s >= 0 && found < need && !ended; s--) {
+        LogSegment *seg = log->segs[s];
+        if (seg->base_seq >= before || !seg->size || !seg->index_count) continue;
+        if (!segment_has_target(seg, hash)) continue;
+        int bound = index_bound(seg, before);
+        for (int b = bound - 1; b >= 0 && found < need && !ended; b--) {
+            size_t from = seg->index[b].offset;
+            size_t to = b + 1 < seg->index_count ? seg->index[b + 1].offset : seg->size;
+            int matches = 0;
+            for (size_t off = from; off < to;) {
+                LogRecordHeader h;
+                memcpy(&h, seg->map + off, sizeof(h));
+                if (h.seq >= before) break;
+                const char *payload = seg->map + off + sizeof(h);
+                const char *t, *sender, *message;
+                size_t message_len;
+                if (kind == 'R' && payload[0] == 'X' && parse_record(payload, h.len, &t, &sender, &message, &message_len) &&
+                    strcmp(t, target) == 0) {
+                    // Messages plus anciens du bloc : ceux de la salle supprimée
+                    matches = 0;
+                    ended = 1;
+                } else if (payload[0] == kind && parse_record(payload, h.len, &t, &sender, &message, &message_len) &&
+                    strcmp(t, target) == 0) {
+                    if (matches == block_capacity) {
+                        block_capacity = block_capacity ? block_capacity * 2 : 64;
+                        size_t *grown = realloc(block, block_capacity * sizeof(size_t));
+                        if (!grown) break;
+                        block = grown;
+                    }
+                    block[matches++] = off;
+                }
+                off += sizeof(h) + h.len;
+            }
+            while (matches > 0 && found < need) hits[found++] = (LogHit){ seg, block[--matches] };
+        }
+    }
+
+    // hits va du plus récent au plus ancien : visite dans l'ordre inverse
+    int visited = 0;
+    int last = found < skip + count ? found : skip + count;
+    for (int i = last - 1; i >= skip; i--) {
+        LogRecordHeader h;
+        memcpy(&h, hits[i].seg->map + hits[i].off, sizeof(h));
+        const char *t, *sender, *message;
+        size_t message_len;
+        parse_record(hits[i].seg->map + hits[i].off + sizeof(h), h.len, &t, &sender, &message, &message_len);
+        visit(ctx, h.time_us, sender, message, message_len);
+        visited++;
+    }
+    pthread_rwlock_unlock(&log->seg_lock);
+
+    *total = found;
+    free(block);
+    free(hits);
+    return visited;
+}
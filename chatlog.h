@@ -0,0 +1,136 @@
+#ifndef CHATLOG_H
+#define CHATLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/**
+ * Journal des messages (salles et messages privés), en ajout seul.
+ *
+ * Le journal est découpé en segments de taille fixe dans un dossier :
+ *   <seq de base sur 20 chiffres>.log  les enregistrements, bout à bout
+ *   <seq de base sur 20 chiffres>.idx  index clairsemé : une entrée
+ *                                       (seq, position) tous les
+ *                                       LOG_INDEX_INTERVAL octets
+ * Enregistrement : en-tête LogRecordHeader puis
+ *   type ('R' salle, 'D' privé, 'X' salle supprimée), cible '\0',
+ *   expéditeur '\0', texte
+ * Une marque 'X' clôt les archives d'une salle : une salle recréée sous le
+ * même nom ne relit que les messages écrits après elle.
+ * La somme de contrôle détecte la fin déchirée d'un segment après un arrêt
+ * brutal : elle est tronquée à l'ouverture.
+ *
+ * Les workers ne touchent jamais le disque : chatlog_append copie le message
+ * dans un tampon sous un mutex. Un thread d'écriture vide ce tampon d'un seul
+ * write par segment puis un seul fdatasync (écriture groupée) ; les messages
+ * arrivés pendant ce temps partent dans le lot suivant. Si le disque ne suit
+ * pas et que le tampon est plein, le message n'est pas journalisé (compté).
+ *
+ * Les lectures passent par une projection mmap de chaque segment, partagée
+ * par tous les lecteurs. Chaque segment tient l'ensemble des cibles qu'il
+ * contient (empreintes, complété à la lecture) : une lecture ne parcourt
+ * que les segments où la salle ou l'utilisateur apparaît. Les segments plus vieux que la durée de rétention
+ * sont supprimés par le thread d'écriture.
+ */
+
+#define LOG_INDEX_INTERVAL 4096          /* octets entre deux entrées d'index */
+#define LOG_MIN_SEGMENT (64 * 1024)      /* taille minimale d'un segment */
+#define LOG_BUFFER_BYTES (4 * 1024 * 1024) /* tampon des messages en attente d'écriture */
+
+typedef struct {
+    uint32_t len;        /* octets de charge utile après l'en-tête */
+    uint32_t check;      /* FNV-1a de seq, time_us et de la charge utile */
+    uint64_t seq;        /* numéro croissant attribué par chatlog_append */
+    uint64_t time_us;    /* instant d'ajout (µs depuis l'époque Unix) */
+} LogRecordHeader;
+
+typedef struct {
+    uint64_t seq;
+    uint64_t offset;     /* position de l'enregistrement dans le segment */
+} LogIndexEntry;
+
+typedef struct {
+    uint64_t base_seq;       /* seq du premier enregistrement (nom du fichier) */
+    uint64_t last_seq;       /* seq du dernier enregistrement écrit */
+    uint64_t last_time_us;   /* instant du dernier enregistrement écrit */
+    size_t size;             /* octets écrits et synchronisés */
+    int fd;                  /* ouvert en ajout pour le segment actif, -1 une fois scellé */
+    int idx_fd;              /* fichier d'index, -1 une fois scellé */
+    const char *map;         /* projection en lecture seule */
+    size_t map_len;
+    LogIndexEntry *index;    /* index clairsemé, par seq croissant */
+    int index_count, index_capacity;
+
+    /* Cibles présentes (empreintes FNV-1a, adressage ouvert, 0 = case vide),
+       complétées par les lecteurs de targets_end à size sous targets_lock */
+    pthread_mutex_t targets_lock;
+    uint32_t *targets;
+    size_t target_count, target_capacity;
+    size_t targets_end;
+} LogSegment;
+
+typedef struct {
+    char dir[256];
+    size_t segment_bytes;
+    uint64_t retention_us;   /* 0 = conserver indéfiniment */
+
+    /* Segments, du plus ancien au plus récent (le dernier est actif) :
+       lus sous seg_lock en lecture, modifiés par le thread d'écriture en écriture */
+    pthread_rwlock_t seg_lock;
+    LogSegment **segs;
+    int seg_count, seg_capacity;
+
+    /* Tampon des producteurs, échangé avec celui du thread d'écriture */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    char *pending, *writing;
+    size_t pending_len;
+    uint64_t next_seq;
+    int stop;
+    pthread_t writer;
+    int writer_started;
+
+    /* Statistiques */
+    unsigned long appended, dropped, commits, write_errors;
+} ChatLog;
+
+/*
+ * Message visité par chatlog_read : expéditeur, texte (non terminé par
+ * '\0', de longueur message_len) et instant d'ajout.
+ */
+typedef void (*ChatLogVisit)(void *ctx, uint64_t time_us, const char *sender,
+                             const char *message, size_t message_len);
+
+/*
+ * Ouvre (ou crée) le journal du dossier dir, récupère ses segments et lance
+ * le thread d'écriture. retention_hours = 0 conserve tout. NULL si erreur.
+ */
+ChatLog *chatlog_open(const char *dir, size_t segment_bytes, unsigned retention_hours);
+
+/* Écrit les messages en attente puis arrête le thread d'écriture (statistiques définitives) */
+void chatlog_stop(ChatLog *log);
+
+/* Arrête le journal s'il ne l'est pas et le libère */
+void chatlog_close(ChatLog *log);
+
+/*
+ * Journalise un message de sender vers target (kind 'R' : salle, 'D' :
+ * utilisateur) sans jamais attendre le disque. Retourne son seq, attribué
+ * même si le message est perdu faute de place.
+ */
+uint64_t chatlog_append(ChatLog *log, char kind, const char *target,
+                        const char *sender, const char *message);
+
+/*
+ * Messages de target (kind) de seq < before déjà écrits : saute les skip
+ * plus récents puis visite les count suivants, du plus ancien au plus
+ * récent. Pour une salle (kind 'R'), la lecture s'arrête à la dernière
+ * marque 'X' de target. Retourne le nombre de messages visités ; *total reçoit le nombre
+ * de messages trouvés (exact s'il ne dépasse pas skip + count, sinon
+ * skip + count + 1 : il en reste de plus anciens).
+ */
+int chatlog_read(ChatLog *log, char kind, const char *target, uint64_t before,
+                 int skip, int count, ChatLogVisit visit, void *ctx, int *total);
+
+#endif
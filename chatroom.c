@@ -1,80 +1,228 @@
 #include "chatroom.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
-ChatRoom *chatroom_create(const char *name, int max_members) {
-    ChatRoom *room = malloc(sizeof(ChatRoom));
-    if (!room) return NULL;
+/*
+ * Appartenance en O(1) : les membres restent dans un tableau dense (parcouru
+ * par les diffusions) et une petite table à adressage ouvert associe chaque
+ * case client à sa position dans ce tableau. Tableaux et table grandissent
+ * avec les membres (doublement, jusqu'à max_members) : une salle coûte ce
+ * qu'elle contient, pas ce qu'elle pourrait contenir. La table garde au
+ * moins 2 * member_capacity cases (taux de remplissage sous 0,5).
+ */
+
+#define CHATROOM_INITIAL_MEMBERS 8
+
+static size_t member_hash(int client_index) {
+    uint32_t k = (uint32_t)client_index;
+    k ^= k >> 16;
+    k *= 0x45d9f3bU;
+    k ^= k >> 16;
+    return k;
+}
+
+/* Case de la table qui contient client_index, ou case vide où l'insérer */
+static size_t member_lookup(const ChatRoom *room, int client_index) {
+    size_t i = member_hash(client_index) & room->pos_mask;
+    while (room->pos_keys[i] != -1 && room->pos_keys[i] != client_index) {
+        i = (i + 1) & room->pos_mask;
+    }
+    return i;
+}
+
+/* Vide la case i de la table par décalage arrière (pas de pierre tombale) */
+static void member_unlink(ChatRoom *room, size_t i) {
+    size_t mask = room->pos_mask;
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; room->pos_keys[j] != -1; j = (j + 1) & mask) {
+        size_t home = member_hash(room->pos_keys[j]) & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            room->pos_keys[hole] = room->pos_keys[j];
+            room->pos_vals[hole] = room->pos_vals[j];
+            hole = j;
+        }
+    }
+    room->pos_keys[hole] = -1;
+}
+
+/* Table de positions de table_size cases, reconstruite depuis le tableau dense */
+static int member_rehash(ChatRoom *room, size_t table_size) {
+    int *keys = malloc(table_size * sizeof(int));
+    int *vals = malloc(table_size * sizeof(int));
+    if (!keys || !vals) {
+        free(keys);
+        free(vals);
+        return 0;
+    }
+    memset(keys, 0xff, table_size * sizeof(int)); // -1 partout
+    free(room->pos_keys);
+    free(room->pos_vals);
+    room->pos_keys = keys;
+    room->pos_vals = vals;
+    room->pos_mask = table_size - 1;
+    for (int pos = 0; pos < room->member_count; pos++) {
+        size_t i = member_lookup(room, room->member_indices[pos]);
+        room->pos_keys[i] = room->member_indices[pos];
+        room->pos_vals[i] = pos;
+    }
+    return 1;
+}
+
+/* Agrandit un tableau de membres à capacity éléments de size octets */
+static int member_array_grow(void *array_ptr, int capacity, size_t size) {
+    void **array = array_ptr;
+    void *grown = realloc(*array, capacity * size);
+    if (!grown) return 0;
+    *array = grown;
+    return 1;
+}
+
+/* Place pour un membre de plus (capacité doublée, bornée par max_members) */
+static int member_reserve(ChatRoom *room) {
+    if (room->member_count < room->member_capacity) return 1;
+    int capacity = room->member_capacity ? room->member_capacity * 2 : CHATROOM_INITIAL_MEMBERS;
+    if (capacity > room->max_members) capacity = room->max_members;
+    if (!member_array_grow(&room->member_indices, capacity, sizeof(int)) ||
+        !member_array_grow(&room->member_gens, capacity, sizeof(unsigned)) ||
+        !member_array_grow(&room->dests, capacity, sizeof(struct sockaddr_in)) ||
+        !member_array_grow(&room->bin_dests, capacity, sizeof(struct sockaddr_in)) ||
+        !member_array_grow(&room->rel_dests, capacity, sizeof(int)) ||
+        !member_array_grow(&room->batch_dests, capacity, sizeof(int))) {
+        return 0;   // tableaux déjà agrandis gardés, capacité inchangée
+    }
+    size_t table_size = room->pos_mask + 1;
+    while (table_size < 2 * (size_t)capacity) table_size *= 2;
+    if (table_size != room->pos_mask + 1 && !member_rehash(room, table_size)) return 0;
+    room->member_capacity = capacity;
+    return 1;
+}
+
+int chatroom_init(ChatRoom *room, const char *name, int max_members) {
+    if (!room) return 0;
     
     strncpy(room->name, name, sizeof(room->name) - 1);
     room->name[sizeof(room->name) - 1] = '\0'; // Ensure null-termination
+    room->owner[0] = '\0';
     
     room->max_members = max_members;
     room->member_count = 0;
+    room->member_capacity = 0;
     room->active = 1;
     
-    // Allocate memory for member indices
-    room->member_indices = malloc(max_members * sizeof(int));
-    if (!room->member_indices) {
+    // Tableaux des membres alloués au premier ajout (member_reserve), table
+    // de positions minimale d'ici là
+    room->member_indices = NULL;
+    room->member_gens = NULL;
+    room->dests = NULL;
+    room->bin_dests = NULL;
+    room->rel_dests = NULL;
+    room->batch_dests = NULL;
+    room->pos_keys = NULL;
+    room->pos_vals = NULL;
+    if (!member_rehash(room, 2 * CHATROOM_INITIAL_MEMBERS)) return 0;
+    room->dest_count = 0;
+    room->bin_dest_count = 0;
+    room->rel_dest_count = 0;
+    room->batch_dest_count = 0;
+    room->dest_epoch = 0;
+    room->send_errors = 0;
+    room->hist_bytes = NULL;
+    room->hist_entries = NULL;
+    room->hist_capacity = 0;
+    room->hist_max = 0;
+    room->hist_first = 0;
+    room->hist_count = 0;
+    room->hist_write = 0;
+    room->hist_used = 0;
+    pthread_mutex_init(&room->lock, NULL);
+    
+    return 1;
+}
+
+void chatroom_destroy(ChatRoom *room) {
+    if (!room || !room->active) return;
+    
+    pthread_mutex_destroy(&room->lock);
+    free(room->member_indices);
+    free(room->member_gens);
+    free(room->dests);
+    free(room->bin_dests);
+    free(room->rel_dests);
+    free(room->batch_dests);
+    free(room->pos_keys);
+    free(room->pos_vals);
+    free(room->hist_bytes);
+    free(room->hist_entries);
+    room->active = 0;
+}
+
+ChatRoom *chatroom_create(const char *name, int max_members) {
+    ChatRoom *room = malloc(sizeof(ChatRoom));
+    if (!room) return NULL;
+    
+    if (!chatroom_init(room, name, max_members)) {
         free(room);
         return NULL;
     }
-    
     return room;
 }
 
 void chatroom_free(ChatRoom *room) {
     if (!room) return;
     
-    free(room->member_indices);
+    chatroom_destroy(room);
     free(room);
 }
 
-int chatroom_add_member(ChatRoom *room, int client_index) {
-    if (!room || room->member_count >= room->max_members) {
+int chatroom_add_member(ChatRoom *room, int client_index, unsigned generation) {
+    if (!room || client_index < 0 || room->member_count >= room->max_members) {
         return 0; // Room is full or invalid
     }
     
     // Check if client is already a member
-    for (int i = 0; i < room->member_count; i++) {
-        if (room->member_indices[i] == client_index) {
-            return 0; // Already a member
-        }
+    if (room->pos_keys[member_lookup(room, client_index)] != -1) {
+        return 0; // Already a member
     }
+    if (!member_reserve(room)) return 0;
     
-    // Add client index to member array
-    room->member_indices[room->member_count++] = client_index;
+    // Append to the dense array and remember the position
+    size_t slot = member_lookup(room, client_index);
+    int pos = room->member_count++;
+    room->member_indices[pos] = client_index;
+    room->member_gens[pos] = generation;
+    room->pos_keys[slot] = client_index;
+    room->pos_vals[slot] = pos;
+    room->dest_epoch = 0;
     return 1;
 }
 
 int chatroom_remove_member(ChatRoom *room, int client_index) {
-    if (!room) return 0;
+    if (!room || client_index < 0) return 0;
     
-    // Find the client in the member array
-    for (int i = 0; i < room->member_count; i++) {
-        if (room->member_indices[i] == client_index) {
-            // Found the client, remove by shifting array elements
-            for (int j = i; j < room->member_count - 1; j++) {
-                room->member_indices[j] = room->member_indices[j + 1];
-            }
-            room->member_count--;
-            return 1;
-        }
+    size_t slot = member_lookup(room, client_index);
+    if (room->pos_keys[slot] == -1) {
+        return 0; // Client not found
     }
+    int pos = room->pos_vals[slot];
+    member_unlink(room, slot);
     
-    return 0; // Client not found
+    // Swap-remove: the last member takes the freed position
+    int last = --room->member_count;
+    if (pos != last) {
+        int moved = room->member_indices[last];
+        room->member_indices[pos] = moved;
+        room->member_gens[pos] = room->member_gens[last];
+        room->pos_vals[member_lookup(room, moved)] = pos;
+    }
+    room->dest_epoch = 0;
+    return 1;
 }
 
 int chatroom_is_member(ChatRoom *room, int client_index) {
-    if (!room) return 0;
+    if (!room || client_index < 0) return 0;
     
-    for (int i = 0; i < room->member_count; i++) {
-        if (room->member_indices[i] == client_index) {
-            return 1; // Client is a member
-        }
-    }
-    
-    return 0; // Client is not a member
+    return room->pos_keys[member_lookup(room, client_index)] != -1;
 }
 
 int chatroom_get_member_count(ChatRoom *room) {
@@ -91,4 +239,84 @@ int chatroom_is_full(ChatRoom *room) {
 
 const char *chatroom_get_name(ChatRoom *room) {
     return room ? room->name : NULL;
-}
\ No newline at end of file
+}
+
+/*
+ * Historique : les messages sont écrits à la suite dans une arène circulaire
+ * (un message peut faire le tour de la fin au début) et un anneau d'entrées
+ * donne la position de chacun. Les messages conservés occupent toujours la
+ * zone contiguë (modulo la taille) qui précède hist_write : pour faire de la
+ * place, il suffit d'oublier le plus ancien. Aucune allocation par message.
+ */
+
+int chatroom_history_init(ChatRoom *room, int max_messages, size_t max_bytes) {
+    if (max_messages <= 0 || max_bytes == 0) return 1;
+    room->hist_bytes = malloc(max_bytes);
+    room->hist_entries = malloc(max_messages * sizeof(ChatHistoryEntry));
+    if (!room->hist_bytes || !room->hist_entries) {
+        free(room->hist_bytes);
+        free(room->hist_entries);
+        room->hist_bytes = NULL;
+        room->hist_entries = NULL;
+        return 0;
+    }
+    room->hist_capacity = max_bytes;
+    room->hist_max = max_messages;
+    return 1;
+}
+
+/* Copie n octets à la position d'écriture, en repartant du début si besoin */
+static void history_write(ChatRoom *room, const char *src, size_t n) {
+    size_t first = room->hist_capacity - room->hist_write;
+    if (first > n) first = n;
+    memcpy(room->hist_bytes + room->hist_write, src, first);
+    memcpy(room->hist_bytes, src + first, n - first);
+    room->hist_write = (room->hist_write + n) % room->hist_capacity;
+}
+
+void chatroom_history_add(ChatRoom *room, const char *sender, const char *message, uint64_t seq) {
+    if (!room || !room->hist_bytes) return;
+
+    // Expéditeur puis '\0' puis texte ; un texte trop long est tronqué
+    size_t sender_len = strlen(sender) + 1;
+    size_t message_len = strlen(message);
+    if (sender_len >= room->hist_capacity) return;
+    if (sender_len + message_len > room->hist_capacity) message_len = room->hist_capacity - sender_len;
+    size_t len = sender_len + message_len;
+
+    // Oublier les plus anciens jusqu'à avoir une entrée et assez d'octets
+    while (room->hist_count == room->hist_max || room->hist_used + len > room->hist_capacity) {
+        room->hist_used -= room->hist_entries[room->hist_first].len;
+        room->hist_first = (room->hist_first + 1) % room->hist_max;
+        room->hist_count--;
+    }
+
+    ChatHistoryEntry *e = &room->hist_entries[(room->hist_first + room->hist_count) % room->hist_max];
+    e->off = room->hist_write;
+    e->len = len;
+    e->seq = seq;
+    history_write(room, sender, sender_len);
+    history_write(room, message, message_len);
+    room->hist_used += len;
+    room->hist_count++;
+}
+
+uint64_t chatroom_history_oldest_seq(const ChatRoom *room) {
+    if (!room || room->hist_count == 0) return UINT64_MAX;
+    return room->hist_entries[room->hist_first].seq;
+}
+
+int chatroom_history_get(const ChatRoom *room, int i, char *buf, size_t cap, const char **message) {
+    if (!room || i < 0 || i >= room->hist_count || cap < 2) return 0;
+
+    const ChatHistoryEntry *e = &room->hist_entries[(room->hist_first + i) % room->hist_max];
+    size_t len = e->len < cap - 1 ? e->len : cap - 1;
+    size_t first = room->hist_capacity - e->off;
+    if (first > len) first = len;
+    memcpy(buf, room->hist_bytes + e->off, first);
+    memcpy(buf + first, room->hist_bytes, len - first);
+    buf[len] = '\0';
+    size_t sender_len = strnlen(buf, len);
+    *message = sender_len < len ? buf + sender_len + 1 : buf + len;
+    return 1;
+}
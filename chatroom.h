@@ -2,28 +2,71 @@
 #define CHATROOM_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+/* Message conservé dans l'historique : position et longueur dans l'arène */
+typedef struct {
+    size_t off;
+    size_t len;
+    uint64_t seq;                /* Numéro du message dans le journal (0 si non journalisé) */
+} ChatHistoryEntry;
 
 /**
  * Représente une salle de discussion (chat room)
  */
 typedef struct {
     char name[50];               /* Nom de la salle */
+    char owner[50];              /* Créateur de la salle (peut la supprimer) */
     int max_members;             /* Nombre maximum de membres autorisés */
-    int *member_indices;         /* Tableau d'indices vers les clients */
+    int *member_indices;         /* Tableau dense d'indices vers les clients */
+    unsigned *member_gens;       /* Génération de la case client lors de l'ajout */
     int member_count;            /* Nombre actuel de membres */
+    int member_capacity;         /* Cases allouées dans member_indices, member_gens et les tableaux de diffusion */
+    int *pos_keys;               /* Table case client → position dans member_indices : */
+    int *pos_vals;               /*   clés (-1 = vide) et positions, sondage linéaire */
+    size_t pos_mask;             /* Taille de la table - 1 (puissance de 2) */
     int active;                  /* Indique si la salle est active */
+    int next_free;               /* Case libre suivante dans le registre des salles */
+    unsigned generation;         /* Incrémentée à chaque suppression (poignées binaires) */
+    pthread_mutex_t lock;        /* Sérialise les diffusions dans la salle */
+    struct sockaddr_in *dests;   /* Adresses des membres actifs, précalculées pour la diffusion */
+    int dest_count;              /* Nombre d'adresses dans dests */
+    struct sockaddr_in *bin_dests; /* Adresses des membres actifs en protocole binaire */
+    int bin_dest_count;          /* Nombre d'adresses dans bin_dests */
+    int *rel_dests;              /* Membres actifs servis par la couche fiable (cases client) */
+    int rel_dest_count;          /* Nombre de cases dans rel_dests */
+    int *batch_dests;            /* Membres actifs dont les messages sont regroupés (cases client) */
+    int batch_dest_count;        /* Nombre de cases dans batch_dests */
+    unsigned long dest_epoch;    /* Époque des adresses lors du calcul de dests (0 = à refaire) */
+    unsigned long send_errors;   /* Envois en échec lors des diffusions */
+    char *hist_bytes;            /* Historique : arène d'octets préallouée (anneau), NULL si désactivé */
+    size_t hist_capacity;        /* Taille de hist_bytes */
+    size_t hist_write;           /* Position d'écriture du prochain message */
+    size_t hist_used;            /* Octets occupés par les messages conservés */
+    ChatHistoryEntry *hist_entries; /* Anneau des messages conservés, du plus ancien au plus récent */
+    int hist_max;                /* Nombre maximum de messages conservés */
+    int hist_first;              /* Case du plus ancien message dans hist_entries */
+    int hist_count;              /* Nombre de messages conservés */
 } ChatRoom;
 
+/* Initialise une salle déjà allouée (ex. case d'un registre), 0 si erreur */
+int chatroom_init(ChatRoom *room, const char *name, int max_members);
+
+/* Libère les ressources d'une salle sans libérer la structure elle-même */
+void chatroom_destroy(ChatRoom *room);
+
 /* Crée et initialise une nouvelle salle de discussion */
 ChatRoom *chatroom_create(const char *name, int max_members);
 
 /* Libère une salle de discussion et ses ressources */
 void chatroom_free(ChatRoom *room);
 
-/* Ajoute un client à une salle de discussion */
-int chatroom_add_member(ChatRoom *room, int client_index);
+/* Ajoute un client (case et génération de la case) à une salle de discussion */
+int chatroom_add_member(ChatRoom *room, int client_index, unsigned generation);
 
-/* Supprime un client d'une salle de discussion */
+/* Supprime un client d'une salle de discussion (le dernier membre prend sa place) */
 int chatroom_remove_member(ChatRoom *room, int client_index);
 
 /* Vérifie si un client est membre d'une salle */
@@ -41,4 +84,27 @@ int chatroom_is_full(ChatRoom *room);
 /* Retourne le nom d'une salle */
 const char *chatroom_get_name(ChatRoom *room);
 
+/*
+ * Prépare l'historique : au plus max_messages messages dans une arène de
+ * max_bytes octets allouée une fois pour toutes (0 désactive l'historique).
+ * Retourne 0 si erreur d'allocation (l'historique reste désactivé).
+ */
+int chatroom_history_init(ChatRoom *room, int max_messages, size_t max_bytes);
+
+/*
+ * Conserve un message (seq : son numéro dans le journal) ; les plus anciens
+ * sont écrasés quand l'arène ou l'anneau est plein
+ */
+void chatroom_history_add(ChatRoom *room, const char *sender, const char *message, uint64_t seq);
+
+/* Numéro dans le journal du plus ancien message conservé, UINT64_MAX si aucun */
+uint64_t chatroom_history_oldest_seq(const ChatRoom *room);
+
+/*
+ * Copie le message numéro i (0 = le plus ancien conservé) dans buf : buf
+ * contient l'expéditeur et *message pointe sur le texte, dans buf (tronqué
+ * à cap octets). Retourne 0 si i est hors de l'historique.
+ */
+int chatroom_history_get(const ChatRoom *room, int i, char *buf, size_t cap, const char **message);
+
 #endif
\ No newline at end of file
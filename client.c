@@ -12,14 +12,16 @@
 #include "globalVariables.h"
 #include "dict.h"
 #include "chatroom.h"
+#include "reliable.h"
+#include "wire.h"
+#include "outbox.h"
+#include "xferclient.h"
+#include <time.h>
 
 #define BUF_SIZE 1000
 #define BUFFER_SIZE 1000
-#define LOGIN_CMD "@login"
-#define MESSAGE_CMD "@message"
-#define UPLOAD_CMD "@upload"
-#define DOWNLOAD_CMD "@download"
 #define FILE_BUFFER_SIZE 4096
+#define RESUME_MIN_SIZE (1024 * 1024)   // Taille à partir de laquelle un upload part en morceaux qui reprennent
 
 // Define the thread argument structure
 typedef struct {
@@ -28,11 +30,97 @@ typedef struct {
     socklen_t len;
 } thread_arg_t;
 
-pthread_t tid_send, tid_recv;
+pthread_t tid_send, tid_recv, tid_heartbeat, tid_reliable;
 int running = 1; // Flag pour contrôler l'exécution des threads
 
-// Fonction pour envoyer un fichier
+// Couche fiable vers le serveur (option -r, demandée au login avec
+// RELIABLE_OPT) : @message et @roomsg partent numérotés et sont réémis
+// jusqu'à acquittement. Active tant que le serveur a annoncé une époque non
+// nulle (à chaque login réussi, reliable.h)
+RelPeer *rel_peer;
+int reliable_requested = 0;
+
+// Poignées binaires apprises du serveur (WOP_ROOM_BIND / WOP_USER_BIND) :
+// après la première utilisation d'un nom, on envoie sa poignée
+typedef struct {
+    char name[50];
+    uint64_t index, gen;
+} KnownHandle;
+
+typedef struct {
+    KnownHandle *items;
+    int count, capacity;
+} HandleTable;
+
+HandleTable known_rooms, known_users;
+pthread_mutex_t handles_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Enregistre (ou remplace) l'association nom ↔ poignée
+static void handle_learn(HandleTable *t, const char *name, uint64_t index, uint64_t gen) {
+    KnownHandle *slot = NULL;
+    for (int i = 0; i < t->count; i++) {
+        if (strcmp(t->items[i].name, name) == 0 || t->items[i].index == index) {
+            slot = &t->items[i];
+            break;
+        }
+    }
+    if (!slot) {
+        if (t->count == t->capacity) {
+            int capacity = t->capacity ? t->capacity * 2 : 8;
+            KnownHandle *items = realloc(t->items, capacity * sizeof(KnownHandle));
+            if (!items) return;
+            t->items = items;
+            t->capacity = capacity;
+        }
+        slot = &t->items[t->count++];
+    }
+    strncpy(slot->name, name, sizeof(slot->name) - 1);
+    slot->name[sizeof(slot->name) - 1] = '\0';
+    slot->index = index;
+    slot->gen = gen;
+}
+
+static KnownHandle *handle_by_name(HandleTable *t, const char *name) {
+    for (int i = 0; i < t->count; i++) {
+        if (strcmp(t->items[i].name, name) == 0) return &t->items[i];
+    }
+    return NULL;
+}
+
+static KnownHandle *handle_by_index(HandleTable *t, uint64_t index, uint64_t gen) {
+    for (int i = 0; i < t->count; i++) {
+        if (t->items[i].index == index && t->items[i].gen == gen) return &t->items[i];
+    }
+    return NULL;
+}
+
+// Horloge de la couche fiable : millisecondes monotones
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Émission d'une trame de la couche fiable vers le serveur
+static void rel_send_to_server(void *ctx, const char *frame, size_t len) {
+    thread_arg_t *t = (thread_arg_t *)ctx;
+    if (sendto(t->sockfd, frame, len, 0, (struct sockaddr *)&t->servaddr, t->len) < 0) {
+        perror("sendto");
+    }
+}
+
+// Fonction pour envoyer un fichier. Un gros fichier part en morceaux
+// (xfer_upload_parallel, sur un seul flux avec -j 1) : chacun reprend là où
+// le serveur s'est arrêté lors d'un envoi précédent interrompu, et son
+// empreinte se calcule juste avant son envoi, qui relit le morceau depuis
+// le cache de pages plutôt que depuis le disque
 int send_file(const char* filename) {
+    const char *name = xfer_name(filename);
+    if (strlen(name) > WIRE_XFER_NAME_MAX) {
+        printf("Erreur: Nom de fichier trop long\n");
+        return -1;
+    }
+
     // Ouvrir le fichier en lecture
     FILE* file = fopen(filename, "rb");
     if (!file) {
@@ -40,97 +128,94 @@ int send_file(const char* filename) {
         return -1;
     }
 
-    // Créer une socket TCP
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        printf("Erreur: Création socket TCP\n");
-        fclose(file);
-        return -1;
-    }
-
     // Obtenir la taille du fichier
     fseek(file, 0, SEEK_END);
     long file_size = ftell(file);
     fseek(file, 0, SEEK_SET);
 
-    // Configuration de l'adresse du serveur
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(TCP_PORT);
-    server_addr.sin_addr.s_addr = inet_addr("127.0.0.1"); // À modifier avec l'IP du serveur
-
-    // Connexion au serveur
-    if (connect(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        printf("Erreur: Connexion au serveur\n");
-        close(sock);
+    // Gros fichier : morceaux d'au moins RESUME_MIN_SIZE, répartis sur
+    // plusieurs connexions (options -j et -c)
+    uint64_t part_size = (uint64_t)XFER_PART_MB * 1024 * 1024;
+    if (part_size < RESUME_MIN_SIZE) part_size = RESUME_MIN_SIZE;
+    if (file_size >= RESUME_MIN_SIZE) {
+        fclose(file);
+        if (XFER_STREAMS > 1 && (uint64_t)file_size > part_size) {
+            printf("Envoi de %s en morceaux de %lu Mio sur %d flux\n", filename, (unsigned long)(part_size >> 20), XFER_STREAMS);
+        }
+        if (xfer_upload_parallel(filename, name, file_size, XFER_STREAMS, part_size) < 0) {
+            printf("Erreur: Envoi de %s incomplet, relancez %s pour reprendre\n", filename, UPLOAD_CMD);
+            return -1;
+        }
+        printf("Fichier %s envoyé avec succès (%ld octets)\n", filename, file_size);
+        return 0;
+    }
+
+    // Petit fichier : lu une seule fois, pour son empreinte et son envoi
+    char *content = malloc(file_size ? file_size : 1);
+    if (!content || fread(content, 1, file_size, file) != (size_t)file_size) {
+        printf("Erreur: Lecture du fichier %s\n", filename);
+        free(content);
         fclose(file);
         return -1;
     }
+    fclose(file);
 
-    // Envoyer la commande @upload pour indiquer qu'il s'agit d'un upload
-    char command[BUFFER_SIZE];
-    snprintf(command, BUFFER_SIZE, "%s %s", UPLOAD_CMD, filename);
-    if (send(sock, command, strlen(command), 0) < 0) {
+    int sock = xfer_connect();
+    if (sock < 0) {
+        free(content);
+        return -1;
+    }
+
+    // En-tête XOP_UPLOAD : le serveur sait quels octets suivent, et ne les
+    // garde que si ceux qu'il a écrits ont la même empreinte
+    uint64_t digest = wire_xfer_digest(WIRE_XFER_DIGEST_INIT, content, file_size);
+    WireXferHeader h = { .op = XOP_UPLOAD, .length = file_size, .total = file_size, .digest = digest };
+    if (!xfer_send_header(sock, &h, name, file_size > 0)) {
         printf("Erreur: Envoi de la commande upload\n");
-        fclose(file);
+        free(content);
         close(sock);
         return -1;
     }
 
-    // Petite pause pour s'assurer que la commande est bien reçue
-    usleep(100000);  // 100ms
-
     // Envoi du contenu du fichier
-    char buffer[FILE_BUFFER_SIZE];
-    size_t bytes_read;
     long total_sent = 0;
-
-    while ((bytes_read = fread(buffer, 1, FILE_BUFFER_SIZE, file)) > 0) {
-        if (send(sock, buffer, bytes_read, 0) < 0) {
-            printf("Erreur: Envoi du fichier\n");
+    while (total_sent < file_size) {
+        ssize_t n = send(sock, content + total_sent, file_size - total_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            printf("\nErreur: Envoi du fichier\n");
             break;
         }
-        total_sent += bytes_read;
-        printf("Progression: %ld/%ld octets envoyés\r", total_sent, file_size);
-        fflush(stdout);
+        total_sent += n;
     }
-
-    printf("\nFichier %s envoyé avec succès\n", filename);
-    fclose(file);
-    close(sock);
-    return 0;
-}
-
-// Fonction pour télécharger un fichier
-int download_file(const char* filename) {
-    // Créer une socket TCP
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        printf("Erreur: Création socket TCP\n");
+    free(content);
+    // Contenu plus court qu'annoncé : la fin du flux fait répondre le serveur
+    if (total_sent < file_size) shutdown(sock, SHUT_WR);
+
+    // Le fichier n'est complet sur le serveur qu'une fois son accusé reçu
+    WireXferHeader ack;
+    if (!xfer_recv_header(sock, &ack) || ack.op != XOP_ACK) {
+        printf("\nErreur: Pas d'accusé de réception du serveur\n");
+        close(sock);
         return -1;
     }
-
-    // Configuration de l'adresse du serveur
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(TCP_PORT);
-    server_addr.sin_addr.s_addr = inet_addr("127.0.0.1"); // À modifier avec l'IP du serveur
-
-    // Connexion au serveur
-    if (connect(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        printf("Erreur: Connexion au serveur\n");
-        close(sock);
+    close(sock);
+    if (ack.status != XST_OK || ack.total != (uint64_t)file_size || ack.digest != digest) {
+        printf("\nErreur: Le serveur a refusé %s (%s, %lu/%ld octets conservés)\n", filename,
+               wire_xfer_status(ack.op, ack.status), (unsigned long)ack.total, file_size);
         return -1;
     }
+    printf("Fichier %s envoyé avec succès (%s, %lu octets)\n", filename, wire_xfer_status(ack.op, ack.status), (unsigned long)ack.total);
+    return 0;
+}
 
-    // Envoyer la commande de téléchargement avec le nom du fichier
-    char command[BUFFER_SIZE];
-    snprintf(command, BUFFER_SIZE, "%s %s", DOWNLOAD_CMD, filename);
-    if (send(sock, command, strlen(command), 0) < 0) {
-        printf("Erreur: Envoi de la commande de téléchargement\n");
-        close(sock);
+// Fonction pour télécharger un fichier. Sans plage, le contenu arrive dans
+// downloads/<nom>.part, renommé une fois complet : un téléchargement
+// interrompu reprend à la fin de ce fichier. Avec une plage (range), les
+// octets [offset, offset + length) s'écrivent à leur place dans downloads/<nom>
+int download_file(const char* filename, int range, uint64_t offset, uint64_t length) {
+    const char *name = xfer_name(filename);
+    if (strlen(name) > WIRE_XFER_NAME_MAX) {
+        printf("Erreur: Nom de fichier trop long\n");
         return -1;
     }
 
@@ -139,62 +224,120 @@ int download_file(const char* filename) {
     if (stat("downloads", &st) == -1) {
         mkdir("downloads", 0777);
     }
+    char local_path[WIRE_XFER_NAME_MAX + 16], part_path[WIRE_XFER_NAME_MAX + 16];
+    snprintf(local_path, sizeof(local_path), "downloads/%s", name);
+    snprintf(part_path, sizeof(part_path), "downloads/%s.part", name);
+    // Gros fichier sans téléchargement en cours à reprendre : plusieurs flux
+    uint64_t part_size = (uint64_t)XFER_PART_MB * 1024 * 1024, size;
+    if (!range && XFER_STREAMS > 1 && part_size > 0 && stat(part_path, &st) < 0 &&
+        xfer_remote_size(name, &size) == XST_OK && size > part_size) {
+        printf("Téléchargement de %s en morceaux de %d Mio sur %d flux\n", name, XFER_PART_MB, XFER_STREAMS);
+        if (xfer_download_parallel(name, size, XFER_STREAMS, part_size) < 0) {
+            printf("Erreur: Téléchargement de %s incomplet\n", filename);
+            return -1;
+        }
+        printf("Fichier %s téléchargé avec succès (%lu octets)\n", filename, (unsigned long)size);
+        return 0;
+    }
+    if (!range) {
+        offset = stat(part_path, &st) == 0 ? (uint64_t)st.st_size : 0;
+        length = WIRE_XFER_ALL;
+    }
 
-    // Création du fichier local
-    char local_path[256];
-    snprintf(local_path, sizeof(local_path), "downloads/%s", filename);
-    FILE* file = fopen(local_path, "wb");
-    if (!file) {
-        printf("Erreur: Impossible de créer le fichier %s\n", local_path);
+    int sock = xfer_connect();
+    if (sock < 0) return -1;
+
+    // Envoyer la commande de téléchargement avec le nom du fichier
+    WireXferHeader h = { .op = XOP_DOWNLOAD, .offset = offset, .length = length };
+    if (!xfer_send_header(sock, &h, name, 0)) {
+        printf("Erreur: Envoi de la commande de téléchargement\n");
         close(sock);
         return -1;
     }
 
-    // D'abord recevoir le message de contrôle
-    char control_msg[BUFFER_SIZE];
-    ssize_t control_size = recv(sock, control_msg, BUFFER_SIZE - 1, 0);
-    if (control_size <= 0) {
+    // D'abord l'en-tête de réponse : statut et octets qui suivent
+    WireXferHeader reply;
+    if (!xfer_recv_header(sock, &reply)) {
         printf("Erreur: Pas de réponse du serveur\n");
-        fclose(file);
         close(sock);
         return -1;
     }
-    control_msg[control_size] = '\0';
-
-    // Vérifier le message de contrôle
-    if (strcmp(control_msg, "FILE_NOT_FOUND") == 0) {
+    if (reply.op != XOP_FILE) {
+        printf("Erreur: Réponse inattendue du serveur\n");
+        close(sock);
+        return -1;
+    }
+    if (reply.status == XST_NOT_FOUND) {
         printf("Erreur: Fichier non trouvé sur le serveur\n");
-        fclose(file);
         close(sock);
-        remove(local_path);
         return -1;
     }
-    else if (strcmp(control_msg, "FILE_SEND_START") != 0) {
-        printf("Erreur: Réponse inattendue du serveur\n");
-        fclose(file);
+    if (reply.status == XST_BAD_RANGE && !range) {
+        // Le fichier du serveur est plus court que le morceau déjà reçu : il a changé
+        printf("Le fichier %s a changé sur le serveur, nouveau téléchargement\n", name);
+        close(sock);
+        remove(part_path);
+        return download_file(filename, 0, 0, 0);
+    }
+    if (reply.status != XST_OK) {
+        printf("Erreur: Le serveur ne peut pas envoyer %s (%s)\n", name, wire_xfer_status(reply.op, reply.status));
+        close(sock);
+        return -1;
+    }
+    if (offset > 0 && !range) printf("Reprise du téléchargement de %s à l'octet %lu/%lu\n", name, (unsigned long)offset, (unsigned long)reply.total);
+
+    // Fichier local : suite du morceau déjà reçu, ou plage écrite à sa place
+    FILE* file = range ? fopen(local_path, "r+b") : fopen(part_path, "ab");
+    if (!file && range) file = fopen(local_path, "wb");
+    if (!file || (range && fseeko(file, offset, SEEK_SET) < 0)) {
+        printf("Erreur: Impossible de créer le fichier %s\n", range ? local_path : part_path);
+        if (file) fclose(file);
         close(sock);
-        remove(local_path);
         return -1;
     }
 
-    // Recevoir le contenu du fichier
+    // Recevoir exactement la longueur annoncée
     char buffer[FILE_BUFFER_SIZE];
-    ssize_t bytes_received;
-    long total_received = 0;
-
-    // Attendre un court instant pour que le serveur commence à envoyer le fichier
-    usleep(100000);  // 100ms
-
-    while ((bytes_received = recv(sock, buffer, FILE_BUFFER_SIZE, 0)) > 0) {
-        fwrite(buffer, 1, bytes_received, file);
+    ssize_t bytes_received = 0;
+    unsigned long total_received = 0;
+    int write_ok = 1;
+
+    while (total_received < reply.length) {
+        size_t want = reply.length - total_received < FILE_BUFFER_SIZE ? reply.length - total_received : FILE_BUFFER_SIZE;
+        bytes_received = recv(sock, buffer, want, 0);
+        if (bytes_received <= 0) break;
+        if (fwrite(buffer, 1, bytes_received, file) != (size_t)bytes_received) write_ok = 0;
         total_received += bytes_received;
-        printf("Téléchargement en cours: %ld octets reçus\r", total_received);
+        printf("Téléchargement en cours: %lu/%lu octets reçus\r", (unsigned long)reply.offset + total_received, (unsigned long)(reply.offset + reply.length));
         fflush(stdout);
     }
+    if (fclose(file) != 0) write_ok = 0;
 
-    printf("\nFichier %s téléchargé avec succès (%ld octets)\n", filename, total_received);
-    fclose(file);
+    if (total_received < reply.length) {
+        printf("\nErreur: Téléchargement de %s interrompu (%lu/%lu octets)\n", filename, total_received, (unsigned long)reply.length);
+        if (!range) printf("Relancez %s pour reprendre le téléchargement\n", DOWNLOAD_CMD);
+        close(sock);
+        return -1;
+    }
+
+    // Accusé au serveur : il sait que le fichier est bien arrivé
+    WireXferHeader ack = { .op = XOP_ACK, .status = write_ok ? XST_OK : XST_WRITE_ERROR, .offset = reply.offset, .length = total_received };
+    xfer_send_header(sock, &ack, "", 0);
     close(sock);
+    if (!write_ok) {
+        printf("\nErreur: Écriture de %s\n", range ? local_path : part_path);
+        return -1;
+    }
+    if (!range && rename(part_path, local_path) < 0) {
+        printf("\nErreur: Renommage de %s\n", part_path);
+        return -1;
+    }
+    if (range) {
+        printf("\nOctets %lu à %lu de %s écrits dans %s\n", (unsigned long)reply.offset,
+               (unsigned long)(reply.offset + total_received), filename, local_path);
+    } else {
+        printf("\nFichier %s téléchargé avec succès (%lu octets)\n", filename, (unsigned long)reply.total);
+    }
     return 0;
 }
 
@@ -206,10 +349,47 @@ void handle_signal(int sig) {
     // Cancel both threads to force immediate exit
     pthread_cancel(tid_send);
     pthread_cancel(tid_recv);
+    pthread_cancel(tid_heartbeat);
+    pthread_cancel(tid_reliable);
     
     exit(EXIT_SUCCESS);
 }
 
+// Traduit "@roomsg salle texte" ou "@message &dest texte" en trame binaire,
+// par poignée si le nom est déjà connu. Retourne sa taille, 0 si impossible
+static size_t encode_command(const char *msg, uint8_t *frame, size_t cap) {
+    WireWriter w;
+    const char *params, *space;
+    int is_room = strncmp(msg, ROOMSG_CMD, strlen(ROOMSG_CMD)) == 0;
+    if (is_room) {
+        params = msg + strlen(ROOMSG_CMD) + 1;
+    } else {
+        params = strchr(msg, '&');
+        if (!params) return 0;
+        params++;
+    }
+    space = strchr(params, ' ');
+    if (!space || space == params || space - params >= 50) return 0;
+
+    char name[50];
+    memcpy(name, params, space - params);
+    name[space - params] = '\0';
+
+    pthread_mutex_lock(&handles_lock);
+    KnownHandle *h = handle_by_name(is_room ? &known_rooms : &known_users, name);
+    if (h) {
+        wire_begin(&w, frame, cap, is_room ? WOP_ROOMSG : WOP_MESSAGE);
+        wire_put_varint(&w, h->index);
+        wire_put_varint(&w, h->gen);
+    } else {
+        wire_begin(&w, frame, cap, is_room ? WOP_ROOMSG_NAMED : WOP_MESSAGE_NAMED);
+        wire_put_str(&w, name);
+    }
+    pthread_mutex_unlock(&handles_lock);
+    wire_put_str(&w, space + 1);
+    return w.overflow ? 0 : w.len;
+}
+
 // Thread pour envoyer les messages saisis au clavier
 void *sendThread(void *arg) {
     thread_arg_t *t = (thread_arg_t *)arg;
@@ -220,9 +400,11 @@ void *sendThread(void *arg) {
     printf("%s nom_salle max_membres - Créer une nouvelle salle\n", CREATEROOM_CMD);
     printf("%s nom_salle - Rejoindre une salle existante\n", JOINROOM_CMD);
     printf("%s nom_salle - Quitter une salle\n", LEAVEROOM_CMD);
+    printf("%s nom_salle - Supprimer une salle que vous avez créée\n", DELETEROOM_CMD);
     printf("%s - Lister toutes les salles disponibles\n", LISTROOMS_CMD);
     printf("%s nom_salle - Lister les membres d'une salle\n", LISTMEMBERS_CMD);
     printf("%s nom_salle message - Envoyer un message à tous les membres d'une salle\n", ROOMSG_CMD);
+    printf("%s nom_salle [page] - Relire les messages précédents d'une salle\n", HISTORY_CMD);
     printf("===================================\n\n");
     
     while (running && fgets(msg, BUF_SIZE, stdin) != NULL) {
@@ -256,10 +438,41 @@ void *sendThread(void *arg) {
         else if (strncmp(msg, DOWNLOAD_CMD, strlen(DOWNLOAD_CMD)) == 0) {
             char *filename = msg + strlen(DOWNLOAD_CMD) + 1;
             while (*filename == ' ') filename++; // Ignore les espaces
-            if (strlen(filename) > 0) {
-                download_file(filename);
+            // "@download nom" ou "@download nom début longueur" (plage d'octets)
+            char name[WIRE_XFER_NAME_MAX + 1];
+            unsigned long long offset, length;
+            int fields = sscanf(filename, "%255s %llu %llu", name, &offset, &length);
+            if (fields == 3) {
+                download_file(name, 1, offset, length);
+                continue;
+            }
+            if (fields == 1) {
+                download_file(name, 0, 0, 0);
+                continue;
+            }
+        }
+        
+        // Les messages passent en binaire par la couche fiable, le reste en
+        // commande texte dans un datagramme simple
+        if (strncmp(msg, MESSAGE_CMD, strlen(MESSAGE_CMD)) == 0 ||
+            strncmp(msg, ROOMSG_CMD, strlen(ROOMSG_CMD)) == 0) {
+            // Une trame plus longue que le tampon du serveur y serait tronquée
+            uint8_t frame[REL_MAX_UPLINK_PAYLOAD];
+            size_t frame_len = encode_command(msg, frame, sizeof(frame));
+            if (!frame_len) {
+                printf("Erreur: Message trop long.\n");
                 continue;
             }
+            pthread_mutex_lock(&rel_peer->lock);
+            int reliable = rel_peer->epoch != 0;
+            int ok = !reliable || rel_send(rel_peer, 0, (const char *)frame, frame_len, now_ms(), rel_send_to_server, t);
+            pthread_mutex_unlock(&rel_peer->lock);
+            if (!ok) printf("Erreur: Trop de messages en attente, message abandonné.\n");
+            if (!reliable && sendto(t->sockfd, frame, frame_len, 0, (struct sockaddr *)&t->servaddr, t->len) < 0) {
+                perror("sendto");
+                break;
+            }
+            continue;
         }
         
         if (sendto(t->sockfd, msg, strlen(msg), 0, (struct sockaddr *)&t->servaddr, t->len) < 0) {
@@ -270,36 +483,176 @@ void *sendThread(void *arg) {
     return NULL;
 }
 
+// Thread qui réémet les messages non acquittés et envoie les acquittements
+// différés de la couche fiable
+void *reliableThread(void *arg) {
+    thread_arg_t *t = (thread_arg_t *)arg;
+    while (running) {
+        usleep(REL_TICK_MS * 1000);
+        pthread_mutex_lock(&rel_peer->lock);
+        rel_tick(rel_peer, now_ms(), rel_send_to_server, t);
+        pthread_mutex_unlock(&rel_peer->lock);
+    }
+    return NULL;
+}
+
+// Affiche une trame binaire du serveur (ou apprend une poignée)
+static void print_wire_frame(const char *buffer, size_t len) {
+    WireReader r;
+    uint8_t op = wire_open(&r, buffer, len);
+    char name[50], sender[50], text[WIRE_FRAME_MAX];
+    uint64_t index, gen;
+
+    switch (op) {
+    case WOP_ROOM_BIND:
+    case WOP_USER_BIND:
+        index = wire_get_varint(&r);
+        gen = wire_get_varint(&r);
+        wire_get_str(&r, name, sizeof(name));
+        if (r.error) break;
+        pthread_mutex_lock(&handles_lock);
+        handle_learn(op == WOP_ROOM_BIND ? &known_rooms : &known_users, name, index, gen);
+        pthread_mutex_unlock(&handles_lock);
+        break;
+    case WOP_ROOM_MSG: {
+        index = wire_get_varint(&r);
+        gen = wire_get_varint(&r);
+        wire_get_str(&r, sender, sizeof(sender));
+        wire_get_str(&r, text, sizeof(text));
+        if (r.error) break;
+        pthread_mutex_lock(&handles_lock);
+        KnownHandle *room = handle_by_index(&known_rooms, index, gen);
+        if (room) snprintf(name, sizeof(name), "%s", room->name);
+        else snprintf(name, sizeof(name), "#%llu", (unsigned long long)index);
+        pthread_mutex_unlock(&handles_lock);
+        printf("\033[1;34m[%s] %s: %s\033[0m\n", name, sender, text); // Bleu gras
+        break;
+    }
+    case WOP_DIRECT_MSG:
+        wire_get_str(&r, sender, sizeof(sender));
+        wire_get_str(&r, text, sizeof(text));
+        if (!r.error) printf("Message de %s: %s\n", sender, text);
+        break;
+    case WOP_STATUS:
+        index = wire_get_varint(&r);
+        wire_get_str(&r, text, sizeof(text));
+        if (r.error) break;
+        if (index == WST_STALE_HANDLE) {
+            // Poignées périmées : on repassera par les noms
+            pthread_mutex_lock(&handles_lock);
+            known_rooms.count = 0;
+            known_users.count = 0;
+            pthread_mutex_unlock(&handles_lock);
+            printf("%s Renvoyez le message.\n", text);
+        } else {
+            printf("%s\n", text);
+        }
+        break;
+    }
+}
+
+// Affiche un message du serveur (texte ou trame binaire)
+static void print_server_message(const char *buffer, size_t len) {
+    if (wire_is_frame(buffer, len)) {
+        print_wire_frame(buffer, len);
+        return;
+    }
+    // Affichage spécial pour les messages de salle (qui commencent par "[nom_salle]")
+    if (buffer[0] == '[') {
+        char *end_bracket = strchr(buffer, ']');
+        if (end_bracket) {
+            printf("\033[1;34m%s\033[0m\n", buffer); // Bleu gras
+        } else {
+            printf("%s\n", buffer);
+        }
+    } else {
+        printf("%s\n", buffer);
+    }
+}
+
+// Thread qui signale régulièrement au serveur que le client est toujours là,
+// même sans rien taper (sinon la session expire après SESSION_TIMEOUT)
+void *heartbeatThread(void *arg) {
+    thread_arg_t *t = (thread_arg_t *)arg;
+    while (running) {
+        sleep(HEARTBEAT_INTERVAL);
+        if (sendto(t->sockfd, HEARTBEAT_CMD, strlen(HEARTBEAT_CMD), 0,
+                   (struct sockaddr *)&t->servaddr, t->len) < 0) {
+            perror("sendto heartbeat");
+        }
+    }
+    return NULL;
+}
+
 // Thread pour recevoir et afficher les messages du serveur
+// Traite un message du serveur (buffer terminé par '\0')
+static void handle_server_message(thread_arg_t *t, const char *buffer, size_t n) {
+    // Époque annoncée (login, ou trame d'une session que le serveur ne
+    // connaît plus) : une autre époque repart de zéro, 0 coupe la couche
+    uint32_t epoch;
+    if (rel_is_frame(buffer, n) && buffer[1] == 'E') {
+        if (!rel_frame_epoch(buffer, n, &epoch)) return;
+        pthread_mutex_lock(&rel_peer->lock);
+        int changed = epoch != rel_peer->epoch;
+        int lost = changed ? rel_reset(rel_peer, epoch) : 0;
+        pthread_mutex_unlock(&rel_peer->lock);
+        if (lost) printf("%d message(s) non acquitté(s) abandonné(s) : nouvelle session avec le serveur\n", lost);
+        if (changed && !epoch && reliable_requested) printf("Couche fiable inactive : reconnectez-vous avec %s <username> <password> %s\n", LOGIN_CMD, RELIABLE_OPT);
+        return;
+    }
+
+    // Trame de la couche fiable : acquittements, doublons, remise en ordre
+    if (rel_is_frame(buffer, n)) {
+        RelMsg msgs[REL_MAX_DELIVER];
+        pthread_mutex_lock(&rel_peer->lock);
+        int count = rel_receive(rel_peer, buffer, n, now_ms(), msgs, rel_send_to_server, t);
+        pthread_mutex_unlock(&rel_peer->lock);
+        for (int i = 0; i < count; i++) {
+            print_server_message(msgs[i].data, msgs[i].len);
+            free(msgs[i].data);
+        }
+        return;
+    }
+
+    // Vérifier si le message concerne un port TCP pour l'upload
+    if (strncmp(buffer, "UPLOAD_PORT", 11) == 0) {
+        printf("Notification reçue: %s\n", buffer);
+        return;
+    }
+
+    print_server_message(buffer, n);
+}
+
 void *recvThread(void *arg) {
     thread_arg_t *t = (thread_arg_t *)arg;
-    char buffer[BUF_SIZE];
+    char buffer[REL_FRAME_MAX + 1];
+    char part[REL_FRAME_MAX];
     while (running) {
-        ssize_t n = recvfrom(t->sockfd, buffer, BUF_SIZE-1, 0,
+        // MSG_TRUNC : n est la taille réelle du datagramme, même tronqué
+        ssize_t n = recvfrom(t->sockfd, buffer, sizeof(buffer)-1, MSG_TRUNC,
                              (struct sockaddr *)&t->servaddr, &t->len);
         if (n < 0) {
             perror("recvfrom");
             break;
         }
+        if (n > (ssize_t)sizeof(buffer) - 1) continue;  // tronqué : ni acquitté ni affiché
         buffer[n] = '\0';
-        
-        // Vérifier si le message concerne un port TCP pour l'upload
-        if (strncmp(buffer, "UPLOAD_PORT", 11) == 0) {
-            printf("Notification reçue: %s\n", buffer);
-            continue;
-        }
-        
-        // Affichage spécial pour les messages de salle (qui commencent par "[nom_salle]")
-        if (buffer[0] == '[') {
-            char *end_bracket = strchr(buffer, ']');
-            if (end_bracket) {
-                printf("\033[1;34m%s\033[0m\n", buffer); // Bleu gras
-            } else {
-                printf("%s\n", buffer);
+
+        // Datagramme regroupé par le serveur : chaque message est traité
+        // comme s'il était arrivé seul
+        if (outbox_is_batch(buffer, n)) {
+            size_t pos = 0, len;
+            const char *msg;
+            while (outbox_next(buffer, n, &pos, &msg, &len)) {
+                if (len >= sizeof(part)) continue;
+                memcpy(part, msg, len);
+                part[len] = '\0';
+                handle_server_message(t, part, len);
             }
-        } else {
-            printf("%s\n", buffer);
+            continue;
         }
+
+        handle_server_message(t, buffer, n);
     }
     return NULL;
 }
@@ -309,10 +662,24 @@ int main(int argc, char *argv[]) {
     signal(SIGINT, handle_signal);
     signal(SIGTERM, handle_signal);
 
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <server_ip>\n", argv[0]);
+    // Options : -r couche fiable, -j flux parallèles et -c taille des
+    // morceaux (Mio) des gros transferts
+    int opt;
+    while ((opt = getopt(argc, argv, "rj:c:")) != -1) {
+        switch (opt) {
+            case 'r': reliable_requested = 1; break;
+            case 'j': XFER_STREAMS = atoi(optarg); break;
+            case 'c': XFER_PART_MB = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-r] [-j flux] [-c morceau_mio] <server_ip>\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Usage: %s [-r] [-j flux] [-c morceau_mio] <server_ip>\n", argv[0]);
         exit(EXIT_FAILURE);
     }
+    const char *server_ip = argv[optind];
 
     // Demande du nom d'utilisateur
     printf("Entrez nom d'utilisateur: ");
@@ -344,15 +711,23 @@ int main(int argc, char *argv[]) {
     memset(&servaddr, 0, sizeof(servaddr));
     servaddr.sin_family = AF_INET;
     servaddr.sin_port = htons(serverPort);
-    if (inet_pton(AF_INET, argv[1], &servaddr.sin_addr) <= 0) {
+    if (inet_pton(AF_INET, server_ip, &servaddr.sin_addr) <= 0) {
         perror("inet_pton");
         exit(EXIT_FAILURE);
     }
+    xfer_set_server(server_ip);
     socklen_t servlen = sizeof(servaddr);
 
     // Envoi de la commande de login avec username et password
     char login_msg[BUF_SIZE];
-    snprintf(login_msg, BUF_SIZE, "%s %s %s", LOGIN_CMD, username, password);
+    snprintf(login_msg, BUF_SIZE, "%s %s %s %s %s%s", LOGIN_CMD, username, password,
+             BINARY_OPT, BATCH_OPT, reliable_requested ? " " RELIABLE_OPT : "");
+    // Inactive jusqu'à ce que le serveur annonce l'époque de la session
+    rel_peer = rel_create(0);
+    if (!rel_peer) {
+        perror("rel_create");
+        exit(EXIT_FAILURE);
+    }
     if (sendto(dS, login_msg, strlen(login_msg), 0,
                (struct sockaddr *)&servaddr, servlen) < 0) {
         perror("sendto login");
@@ -385,10 +760,20 @@ int main(int argc, char *argv[]) {
         perror("pthread_create recvThread");
         exit(EXIT_FAILURE);
     }
+    if (pthread_create(&tid_heartbeat, NULL, heartbeatThread, &arg) != 0) {
+        perror("pthread_create heartbeatThread");
+        exit(EXIT_FAILURE);
+    }
+    if (pthread_create(&tid_reliable, NULL, reliableThread, &arg) != 0) {
+        perror("pthread_create reliableThread");
+        exit(EXIT_FAILURE);
+    }
 
-    // Attente de la fin du thread d'envoi puis arrêt du thread de réception
+    // Attente de la fin du thread d'envoi puis arrêt des autres threads
     pthread_join(tid_send, NULL);
     pthread_cancel(tid_recv);
+    pthread_cancel(tid_heartbeat);
+    pthread_cancel(tid_reliable);
     close(dS);
 
     return 0;
@@ -0,0 +1,95 @@
+#include "clients.h"
+#include <stdlib.h>
+#include <string.h>
+
+ClientRegistry *clients_create(void) {
+    ClientRegistry *reg = calloc(1, sizeof(ClientRegistry));
+    if (!reg) return NULL;
+    reg->free_head = -1;
+    return reg;
+}
+
+void clients_free(ClientRegistry *reg) {
+    if (!reg) return;
+    for (int i = 0; i < reg->high_water; i++) {
+        free(clients_get(reg, i)->joined_rooms);
+        rel_free(clients_get(reg, i)->rel);
+    }
+    for (int i = 0; i < reg->chunk_count; i++) free(reg->chunks[i]);
+    free(reg->chunks);
+    free(reg);
+}
+
+/* Ajoute une tranche : seul le tableau des tranches est réalloué */
+static int clients_grow(ClientRegistry *reg) {
+    ClientInfo **chunks = realloc(reg->chunks, (reg->chunk_count + 1) * sizeof(ClientInfo *));
+    if (!chunks) return 0;
+    reg->chunks = chunks;
+    ClientInfo *chunk = calloc(CLIENT_CHUNK_SIZE, sizeof(ClientInfo));
+    if (!chunk) return 0;
+    reg->chunks[reg->chunk_count++] = chunk;
+    return 1;
+}
+
+int clients_alloc(ClientRegistry *reg) {
+    if (!reg) return -1;
+    int index;
+    if (reg->free_head >= 0) {
+        // Recyclage d'une case rendue
+        index = reg->free_head;
+        reg->free_head = clients_get(reg, index)->next_free;
+    } else {
+        if (reg->high_water == reg->chunk_count * CLIENT_CHUNK_SIZE && !clients_grow(reg)) {
+            return -1;
+        }
+        index = reg->high_water++;
+    }
+
+    ClientInfo *c = clients_get(reg, index);
+    unsigned generation = c->generation;
+    memset(c, 0, sizeof(*c));
+    c->generation = generation;
+    c->in_use = 1;
+    c->next_free = -1;
+    reg->used++;
+    return index;
+}
+
+void clients_release(ClientRegistry *reg, int index) {
+    if (!reg || index < 0 || index >= reg->high_water) return;
+    ClientInfo *c = clients_get(reg, index);
+    if (!c->in_use) return;
+    c->in_use = 0;
+    c->active = 0;
+    free(c->joined_rooms);
+    c->joined_rooms = NULL;
+    c->room_count = 0;
+    c->room_capacity = 0;
+    c->generation++;
+    c->next_free = reg->free_head;
+    reg->free_head = index;
+    reg->used--;
+}
+
+int client_add_room(ClientInfo *c, int room) {
+    if (c->room_count == c->room_capacity) {
+        int capacity = c->room_capacity ? c->room_capacity * 2 : 4;
+        int *rooms = realloc(c->joined_rooms, capacity * sizeof(int));
+        if (!rooms) return 0;
+        c->joined_rooms = rooms;
+        c->room_capacity = capacity;
+    }
+    c->joined_rooms[c->room_count++] = room;
+    return 1;
+}
+
+int client_remove_room(ClientInfo *c, int room) {
+    for (int i = 0; i < c->room_count; i++) {
+        if (c->joined_rooms[i] == room) {
+            // L'ordre des salles n'importe pas : la dernière prend la place
+            c->joined_rooms[i] = c->joined_rooms[--c->room_count];
+            return 1;
+        }
+    }
+    return 0;
+}
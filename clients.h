@@ -0,0 +1,68 @@
+#ifndef CLIENTS_H
+#define CLIENTS_H
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include "timerwheel.h"
+#include "reliable.h"
+
+#define CLIENT_CHUNK_SHIFT 10                      /* 1024 cases par tranche */
+#define CLIENT_CHUNK_SIZE (1 << CLIENT_CHUNK_SHIFT)
+
+/**
+ * Informations complètes d'un client (une case du registre)
+ */
+typedef struct {
+    char username[50];               /* Nom d'utilisateur */
+    struct sockaddr_in addr;         /* Adresse du client */
+    int active;                      /* Flag si session active */
+    int *joined_rooms;               /* Salles auxquelles il a adhéré (tableau extensible) */
+    int room_count;                  /* Nombre de salles */
+    int room_capacity;               /* Taille allouée de joined_rooms */
+    uint64_t last_seen;              /* Tick (seconde monotone) du dernier datagramme reçu */
+    TimerNode timer;                 /* Minuteur d'inactivité de la session */
+    RelPeer *rel;                    /* État de la couche fiable, NULL si non demandée */
+    int binary;                      /* Protocole binaire demandé au login */
+    int batch;                       /* Regroupement des messages sortants demandé au login */
+    unsigned generation;             /* Incrémentée à chaque recyclage de la case */
+    int in_use;                      /* Case attribuée */
+    int next_free;                   /* Case libre suivante (liste libre) */
+} ClientInfo;
+
+/**
+ * Registre des clients : tranches de CLIENT_CHUNK_SIZE cases allouées à la
+ * demande, jamais déplacées (pointeurs et index restent stables), et liste
+ * libre des cases rendues
+ */
+typedef struct {
+    ClientInfo **chunks;  /* tranches allouées */
+    int chunk_count;      /* nb de tranches */
+    int high_water;       /* cases [0, high_water) déjà attribuées au moins une fois */
+    int free_head;        /* première case libre, -1 si aucune */
+    int used;             /* nb de cases attribuées */
+} ClientRegistry;
+
+/* Crée un registre vide */
+ClientRegistry *clients_create(void);
+
+/* Libère le registre et toutes ses tranches */
+void clients_free(ClientRegistry *reg);
+
+/* Attribue une case remise à zéro (génération conservée), -1 si erreur */
+int clients_alloc(ClientRegistry *reg);
+
+/* Rend une case : sa génération change, les références existantes deviennent périmées */
+void clients_release(ClientRegistry *reg, int index);
+
+/* Ajoute la salle room aux salles du client, 0 si erreur */
+int client_add_room(ClientInfo *c, int room);
+
+/* Retire la salle room des salles du client, 1 si retirée, 0 sinon */
+int client_remove_room(ClientInfo *c, int room);
+
+/* Accès à la case index (index < high_water) */
+static inline ClientInfo *clients_get(ClientRegistry *reg, int index) {
+    return &reg->chunks[index >> CLIENT_CHUNK_SHIFT][index & (CLIENT_CHUNK_SIZE - 1)];
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "cmdhash.h"
+#include <string.h>
+
+/* FNV-1a 32 bits graine comprise, puis brassage final des bits hauts */
+static uint32_t token_hash(uint32_t seed, const char *token, size_t len) {
+    uint32_t h = 0x811c9dc5u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)token[i];
+        h *= 0x01000193u;
+    }
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    return h;
+}
+
+/* Essaie une graine : 1 si tous les jetons tombent dans des cases distinctes */
+static int try_seed(CmdHash *h, uint32_t seed) {
+    memset(h->slots, -1, sizeof(h->slots));
+    for (int i = 0; i < h->count; i++) {
+        uint32_t s = token_hash(seed, h->keys[i], h->lens[i]) & h->mask;
+        if (h->slots[s] >= 0) return 0;
+        h->slots[s] = (int8_t)i;
+    }
+    h->seed = seed;
+    return 1;
+}
+
+int cmdhash_build(CmdHash *h, const char *const *keys, int count) {
+    if (count <= 0 || count > CMDHASH_MAX_KEYS) return 0;
+    h->keys = keys;
+    h->count = count;
+    for (int i = 0; i < count; i++) h->lens[i] = strlen(keys[i]);
+
+    // Deux fois plus de cases que de jetons au départ ; on agrandit si
+    // aucune graine ne convient (ou si deux jetons sont identiques)
+    uint32_t size = 1;
+    while (size < 2u * (uint32_t)count) size <<= 1;
+    for (; size <= CMDHASH_MAX_SLOTS; size <<= 1) {
+        h->mask = size - 1;
+        for (uint32_t seed = 1; seed <= 100000; seed++) {
+            if (try_seed(h, seed)) return 1;
+        }
+    }
+    return 0;
+}
+
+int cmdhash_lookup(const CmdHash *h, const char *buf, size_t *token_len) {
+    // Délimitation du jeton et hachage en une seule passe (même calcul que token_hash)
+    uint32_t x = 0x811c9dc5u ^ h->seed;
+    size_t len = 0;
+    for (unsigned char c; (c = (unsigned char)buf[len]) != '\0' && c != ' ' && c != '\n'; len++) {
+        x ^= c;
+        x *= 0x01000193u;
+    }
+    x ^= x >> 15;
+    x *= 0x2c1b3c6du;
+    x ^= x >> 12;
+    if (token_len) *token_len = len;
+
+    int i = h->slots[x & h->mask];
+    if (i < 0 || h->lens[i] != len || memcmp(h->keys[i], buf, len) != 0) return -1;
+    return i;
+}
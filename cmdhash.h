@@ -0,0 +1,38 @@
+#ifndef CMDHASH_H
+#define CMDHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Hachage parfait des jetons de commande ("@login", "@roomsg", ...)
+ * Les jetons sont connus d'avance : cmdhash_build cherche une graine pour
+ * laquelle aucun jeton ne partage sa case, dans une table puissance de 2.
+ * Une recherche coûte alors un hachage, une case et une seule comparaison
+ * (pour rejeter un jeton inconnu), quelle que soit la commande.
+ * Les jetons ne sont pas copiés : le tableau de l'appelant doit rester valide.
+ */
+
+#define CMDHASH_MAX_KEYS 32
+#define CMDHASH_MAX_SLOTS 256
+
+typedef struct {
+    const char *const *keys;           /* jetons de l'appelant */
+    size_t lens[CMDHASH_MAX_KEYS];     /* longueur de chaque jeton */
+    int count;                         /* nb de jetons */
+    uint32_t seed;                     /* graine trouvée par cmdhash_build */
+    uint32_t mask;                     /* nb de cases - 1 */
+    int8_t slots[CMDHASH_MAX_SLOTS];   /* numéro de jeton, -1 si case vide */
+} CmdHash;
+
+/* Construit la table pour keys[0..count-1] (jetons distincts), 0 si impossible */
+int cmdhash_build(CmdHash *h, const char *const *keys, int count);
+
+/*
+ * Retourne le numéro du jeton de commande en tête de buf (jusqu'à ' ', '\n'
+ * ou la fin), -1 s'il est inconnu. Sa longueur est écrite dans *token_len
+ * si token_len n'est pas NULL.
+ */
+int cmdhash_lookup(const CmdHash *h, const char *buf, size_t *token_len);
+
+#endif
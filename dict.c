@@ -1,42 +1,208 @@
 #include "dict.h"
 #include <stdlib.h>
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-#define INITIAL_CAPACITY 2
-#define LOAD_FACTOR_THRESHOLD 0.8
+#define INITIAL_CAPACITY 16
+#define LOAD_FACTOR_THRESHOLD 0.75
+#define GROUP_WIDTH 16
+#define CTRL_EMPTY 0x80
+
+/* FNV-1a 64 bits suivi d'un mélange final (les 7 bits de contrôle sont pris en haut) */
+static uint64_t dict_hash(const char *key) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        h ^= *p;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint8_t h2(uint64_t h) {
+    return (uint8_t)(h >> 57);
+}
+
+/* Masque des octets de contrôle égaux à tag parmi les 16 à partir de ctrl */
+static inline unsigned group_match(const uint8_t *ctrl, uint8_t tag) {
+#ifdef __SSE2__
+    __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)tag)));
+#else
+    unsigned m = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++) {
+        if (ctrl[i] == tag) m |= 1u << i;
+    }
+    return m;
+#endif
+}
+
+/* Masque des cases vides parmi les 16 à partir de ctrl */
+static inline unsigned group_empty(const uint8_t *ctrl) {
+#ifdef __SSE2__
+    return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+    return group_match(ctrl, CTRL_EMPTY);
+#endif
+}
+
+/* Écrit un octet de contrôle et sa copie en fin de tableau */
+static inline void set_ctrl(SimpleDict *d, size_t i, uint8_t v) {
+    d->ctrl[i] = v;
+    if (i < GROUP_WIDTH) d->ctrl[d->table_size + i] = v;
+}
+
+/* Alloue une table de cases vide de taille n */
+static int table_alloc(SimpleDict *d, size_t n) {
+    uint8_t *ctrl = malloc(n + GROUP_WIDTH);
+    uint32_t *slots = malloc(n * sizeof(uint32_t));
+    if (!ctrl || !slots) {
+        free(ctrl);
+        free(slots);
+        return 0;
+    }
+    memset(ctrl, CTRL_EMPTY, n + GROUP_WIDTH);
+    free(d->ctrl);
+    free(d->slots);
+    d->ctrl = ctrl;
+    d->slots = slots;
+    d->table_size = n;
+    return 1;
+}
+
+/* Place l'entrée pos dans la première case vide de sa séquence de sondage */
+static void table_place(SimpleDict *d, size_t pos) {
+    size_t mask = d->table_size - 1;
+    size_t i = d->hashes[pos] & mask;
+    for (;;) {
+        unsigned empty = group_empty(d->ctrl + i);
+        if (empty) {
+            i = (i + __builtin_ctz(empty)) & mask;
+            break;
+        }
+        i = (i + GROUP_WIDTH) & mask;
+    }
+    set_ctrl(d, i, h2(d->hashes[pos]));
+    d->slots[i] = (uint32_t)pos;
+}
+
+/**
+ * Cherche la case de key. Le sondage est linéaire : tant qu'aucune case
+ * vide n'est rencontrée la clé peut se trouver plus loin
+ */
+static long table_find(const SimpleDict *d, const char *key, uint64_t h) {
+    size_t mask = d->table_size - 1;
+    size_t i = h & mask;
+    uint8_t tag = h2(h);
+    for (;;) {
+        const uint8_t *g = d->ctrl + i;
+        unsigned match = group_match(g, tag);
+        unsigned empty = group_empty(g);
+        // Seules les cases avant la première case vide comptent
+        if (empty) match &= (1u << __builtin_ctz(empty)) - 1;
+        while (match) {
+            size_t s = (i + __builtin_ctz(match)) & mask;
+            uint32_t pos = d->slots[s];
+            if (d->hashes[pos] == h && strcmp(d->entries[pos].key, key) == 0) return (long)s;
+            match &= match - 1;
+        }
+        if (empty) return -1;
+        i = (i + GROUP_WIDTH) & mask;
+    }
+}
+
+/* Cherche la case qui pointe vers l'entrée pos */
+static size_t table_slot_of(const SimpleDict *d, size_t pos) {
+    size_t mask = d->table_size - 1;
+    size_t i = d->hashes[pos] & mask;
+    while (d->slots[i] != pos || d->ctrl[i] == CTRL_EMPTY) i = (i + 1) & mask;
+    return i;
+}
+
+/* Reconstruit la table de cases avec n cases */
+static int table_rebuild(SimpleDict *d, size_t n) {
+    if (!table_alloc(d, n)) return 0;
+    for (size_t pos = 0; pos < d->count; pos++) table_place(d, pos);
+    return 1;
+}
+
+/* Redimensionne le tableau d'entrées */
+static int entries_resize(SimpleDict *d, size_t new_capacity) {
+    Entry *new_entries = realloc(d->entries, new_capacity * sizeof(Entry));
+    if (!new_entries) return 0;
+    d->entries = new_entries;
+    uint64_t *new_hashes = realloc(d->hashes, new_capacity * sizeof(uint64_t));
+    if (!new_hashes) return 0;
+    d->hashes = new_hashes;
+    d->capacity = new_capacity;
+    return 1;
+}
+
+/* Copie une chaîne dans le stockage du dictionnaire */
+static char *dict_strdup(SimpleDict *d, const char *s) {
+    return d->arena ? arena_strdup(d->arena, s) : strdup(s);
+}
+
+/* Rend une chaîne au stockage du dictionnaire */
+static void dict_strfree(SimpleDict *d, char *s) {
+    if (d->arena) arena_release(d->arena, s);
+    else free(s);
+}
 
 /* Crée et initialise un dictionnaire */
 SimpleDict *dict_create(void) {
-    SimpleDict *d = malloc(sizeof(SimpleDict));
+    SimpleDict *d = calloc(1, sizeof(SimpleDict));
+    if (!d) return NULL;
+    if (!entries_resize(d, INITIAL_CAPACITY) ||
+        !table_alloc(d, INITIAL_CAPACITY * 2)) {
+        dict_free(d);
+        return NULL;
+    }
+    return d;
+}
+
+/* Crée un dictionnaire dont les chaînes sont stockées dans une arène */
+SimpleDict *dict_create_arena(void) {
+    SimpleDict *d = dict_create();
     if (!d) return NULL;
-    d->entries = malloc(INITIAL_CAPACITY * sizeof(Entry));
-    if (!d->entries) {
-        free(d);
+    d->arena = arena_create();
+    if (!d->arena) {
+        dict_free(d);
         return NULL;
     }
-    d->count = 0;
-    d->capacity = INITIAL_CAPACITY;
     return d;
 }
 
 /* Libère un dictionnaire et ses ressources */
 void dict_free(SimpleDict *d) {
     if (!d) return;
-    for (size_t i = 0; i < d->count; i++) {
-        free(d->entries[i].key);
-        free(d->entries[i].value);
+    if (d->arena) {
+        // Toutes les chaînes partent avec les blocs de l'arène
+        arena_free(d->arena);
+    } else {
+        for (size_t i = 0; i < d->count; i++) {
+            free(d->entries[i].key);
+            free(d->entries[i].value);
+        }
     }
     free(d->entries);
+    free(d->hashes);
+    free(d->ctrl);
+    free(d->slots);
     free(d);
 }
 
-/* Redimensionne le tableau d'entrées */
-static int dict_resize(SimpleDict *d) {
-    size_t new_capacity = d->capacity * 2;
-    Entry *new_entries = realloc(d->entries, new_capacity * sizeof(Entry));
-    if (!new_entries) return 0;
-    d->entries = new_entries;
-    d->capacity = new_capacity;
+/* Réserve la place pour n entrées */
+int dict_reserve(SimpleDict *d, size_t n) {
+    if (!d) return 0;
+    if (n > d->capacity && !entries_resize(d, n)) return 0;
+    size_t size = d->table_size;
+    while (n > size * LOAD_FACTOR_THRESHOLD) size *= 2;
+    if (size != d->table_size && !table_rebuild(d, size)) return 0;
     return 1;
 }
 
@@ -44,46 +210,80 @@ static int dict_resize(SimpleDict *d) {
 int dict_insert(SimpleDict *d, const char *key, const char *value) {
     if (!d || !key || !value) return 0;
 
-    for (size_t i = 0; i < d->count; i++) {
-        if (strcmp(d->entries[i].key, key) == 0) {
-            free(d->entries[i].value);
-            d->entries[i].value = strdup(value);
-            return 1;
-        }
+    uint64_t h = dict_hash(key);
+    long s = table_find(d, key, h);
+    if (s >= 0) {
+        Entry *e = &d->entries[d->slots[s]];
+        char *v = dict_strdup(d, value);
+        if (!v) return 0;
+        dict_strfree(d, e->value);
+        e->value = v;
+        return 1;
     }
 
-    if (d->count >= d->capacity * LOAD_FACTOR_THRESHOLD) {
-        if (!dict_resize(d)) return 0;
+    if (d->count >= d->capacity && !entries_resize(d, d->capacity * 2)) return 0;
+    if (d->count + 1 > d->table_size * LOAD_FACTOR_THRESHOLD) {
+        if (!table_rebuild(d, d->table_size * 2)) return 0;
     }
 
-    d->entries[d->count].key = strdup(key);
-    d->entries[d->count].value = strdup(value);
+    size_t pos = d->count;
+    d->entries[pos].key = dict_strdup(d, key);
+    d->entries[pos].value = dict_strdup(d, value);
+    if (!d->entries[pos].key || !d->entries[pos].value) {
+        if (d->entries[pos].key) dict_strfree(d, d->entries[pos].key);
+        if (d->entries[pos].value) dict_strfree(d, d->entries[pos].value);
+        return 0;
+    }
+    d->hashes[pos] = h;
     d->count++;
+    table_place(d, pos);
     return 1;
 }
 
 /* Récupère la valeur associée à la clé */
 const char *dict_get(SimpleDict *d, const char *key) {
     if (!d || !key) return NULL;
-    for (size_t i = 0; i < d->count; i++) {
-        if (strcmp(d->entries[i].key, key) == 0) {
-            return d->entries[i].value;
-        }
-    }
-    return NULL;
+    long s = table_find(d, key, dict_hash(key));
+    return s >= 0 ? d->entries[d->slots[s]].value : NULL;
+}
+
+/* Position de l'entrée de la clé dans entries */
+long dict_index_of(SimpleDict *d, const char *key) {
+    if (!d || !key) return -1;
+    long s = table_find(d, key, dict_hash(key));
+    return s >= 0 ? (long)d->slots[s] : -1;
 }
 
 /* Supprime une clé et sa valeur */
 int dict_remove(SimpleDict *d, const char *key) {
     if (!d || !key) return 0;
-    for (size_t i = 0; i < d->count; i++) {
-        if (strcmp(d->entries[i].key, key) == 0) {
-            free(d->entries[i].key);
-            free(d->entries[i].value);
-            d->entries[i] = d->entries[d->count - 1];
-            d->count--;
-            return 1;
+    long s = table_find(d, key, dict_hash(key));
+    if (s < 0) return 0;
+
+    size_t pos = d->slots[s];
+    dict_strfree(d, d->entries[pos].key);
+    dict_strfree(d, d->entries[pos].value);
+
+    // Décalage arrière des cases suivantes de la grappe (pas de pierre tombale)
+    size_t mask = d->table_size - 1;
+    size_t hole = (size_t)s;
+    for (size_t j = (hole + 1) & mask; d->ctrl[j] != CTRL_EMPTY; j = (j + 1) & mask) {
+        size_t home = d->hashes[d->slots[j]] & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            set_ctrl(d, hole, d->ctrl[j]);
+            d->slots[hole] = d->slots[j];
+            hole = j;
         }
     }
-    return 0;
-}
\ No newline at end of file
+    set_ctrl(d, hole, CTRL_EMPTY);
+
+    // La dernière entrée dense prend la place de l'entrée supprimée
+    size_t last = d->count - 1;
+    if (pos != last) {
+        d->slots[table_slot_of(d, last)] = (uint32_t)pos;
+        d->entries[pos] = d->entries[last];
+        d->hashes[pos] = d->hashes[last];
+    }
+    d->count--;
+    return 1;
+}
@@ -2,6 +2,8 @@
 #define SIMPLE_DICT_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
 
 /**
  * Représente une paire (username → password)
@@ -12,27 +14,47 @@ typedef struct {
 } Entry;
 
 /**
- * Dictionnaire simple : tableau dynamique d'Entry
+ * Dictionnaire : table de hachage à adressage ouvert façon « Swiss table »
+ * - les entrées restent denses dans `entries` (parcours de 0 à count-1)
+ * - la table de cases associe à chaque case un octet de contrôle (vide, ou
+ *   7 bits du hachage) et la position de l'entrée dans `entries`
+ * - la recherche compare 16 octets de contrôle à la fois (SSE2)
+ * - la suppression décale les cases suivantes : aucune pierre tombale
  */
 typedef struct {
-    Entry *entries;   /* tableau d'entrées */
-    size_t count;     /* nb d'entrées occupées */
-    size_t capacity;  /* taille du tableau alloué */
+    Entry *entries;     /* tableau dense d'entrées */
+    uint64_t *hashes;   /* hachage de chaque entrée */
+    size_t count;       /* nb d'entrées occupées */
+    size_t capacity;    /* taille du tableau d'entrées alloué */
+    uint8_t *ctrl;      /* octets de contrôle (table_size + 16, fin recopiée du début) */
+    uint32_t *slots;    /* case → position dans entries */
+    size_t table_size;  /* nb de cases (puissance de 2) */
+    Arena *arena;       /* stockage des clés et valeurs, NULL = strdup/free */
 } SimpleDict;
 
 /* Crée et initialise un dictionnaire */
 SimpleDict *dict_create(void);
 
+/* Crée un dictionnaire dont les clés et valeurs sont stockées dans une arène
+   (moins de mémoire par entrée, libération en O(1) par rapport au nb d'entrées) */
+SimpleDict *dict_create_arena(void);
+
 /* Libère un dictionnaire et ses ressources */
 void dict_free(SimpleDict *d);
 
+/* Réserve la place pour n entrées (chargement en masse sans redimensionnement) */
+int dict_reserve(SimpleDict *d, size_t n);
+
 /* Insère une nouvelle clé/valeur, redimensionne si seuil atteint */
 int dict_insert(SimpleDict *d, const char *key, const char *value);
 
 /* Récupère la valeur associée à la clé, NULL si absent */
 const char *dict_get(SimpleDict *d, const char *key);
 
+/* Position de l'entrée de la clé dans entries (valable jusqu'à la prochaine suppression), -1 si absente */
+long dict_index_of(SimpleDict *d, const char *key);
+
 /* Supprime une clé et sa valeur, renvoie 1 si supprimé, 0 sinon */
 int dict_remove(SimpleDict *d, const char *key);
 
-#endif
\ No newline at end of file
+#endif
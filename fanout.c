@@ -0,0 +1,46 @@
+#define _GNU_SOURCE
+#include "fanout.h"
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+int fanout_send(int sock, const void *payload, size_t len,
+                const struct sockaddr_in *dests, int count,
+                const struct sockaddr_in *skip) {
+    struct mmsghdr msgs[FANOUT_BATCH];
+    struct iovec iov = { .iov_base = (void *)payload, .iov_len = len };
+    int errors = 0;
+    int i = 0;
+
+    while (i < count) {
+        // Préparer un lot de destinataires (le contenu est partagé par tous)
+        int n = 0;
+        while (i < count && n < FANOUT_BATCH) {
+            const struct sockaddr_in *d = &dests[i++];
+            if (skip && d->sin_addr.s_addr == skip->sin_addr.s_addr &&
+                d->sin_port == skip->sin_port) {
+                continue;
+            }
+            memset(&msgs[n], 0, sizeof(msgs[n]));
+            msgs[n].msg_hdr.msg_name    = (void *)d;
+            msgs[n].msg_hdr.msg_namelen = sizeof(*d);
+            msgs[n].msg_hdr.msg_iov     = &iov;
+            msgs[n].msg_hdr.msg_iovlen  = 1;
+            n++;
+        }
+
+        // sendmmsg s'arrête au premier échec : on compte le destinataire
+        // fautif et on reprend juste après lui
+        int off = 0;
+        while (off < n) {
+            int sent = sendmmsg(sock, msgs + off, n - off, 0);
+            if (sent < 0) {
+                errors++;
+                off++;
+            } else {
+                off += sent;
+            }
+        }
+    }
+    return errors;
+}
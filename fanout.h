@@ -0,0 +1,19 @@
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include <stddef.h>
+#include <netinet/in.h>
+
+/* Nombre de datagrammes passés au noyau par appel sendmmsg */
+#define FANOUT_BATCH 64
+
+/**
+ * Envoie le même datagramme à toutes les adresses de dests (sauf skip si non NULL)
+ * en regroupant les envois par appels sendmmsg de FANOUT_BATCH messages.
+ * Retourne le nombre de destinataires pour lesquels l'envoi a échoué.
+ */
+int fanout_send(int sock, const void *payload, size_t len,
+                const struct sockaddr_in *dests, int count,
+                const struct sockaddr_in *skip);
+
+#endif
@@ -3,4 +3,19 @@
 int serverPort = 4141;
 int TCP_PORT = 8888;
 int INITIAL_CAPACITY = 2;
-int LOAD_FACTOR_THRESHOLD = 0.8;
\ No newline at end of file
+int LOAD_FACTOR_THRESHOLD = 0.8;
+int UDP_WORKERS = 1;
+int SESSION_TIMEOUT = 90;
+int HEARTBEAT_INTERVAL = 30;
+int ROOM_HISTORY_MESSAGES = 100;
+int ROOM_HISTORY_BYTES = 16384;
+int COALESCE_WINDOW_US = 0;
+int LOG_SEGMENT_MB = 16;
+int LOG_RETENTION_HOURS = 24 * 21;
+int CHECKPOINT_INTERVAL = 300;
+int AUTH_THREADS = -1;
+int KDF_ITERATIONS = 100000;
+int XFER_THREADS = 2;
+int XFER_STREAMS = 4;
+int XFER_PART_MB = 16;
+int XFER_MAX_FILE_MB = 4096;
\ No newline at end of file
@@ -5,10 +5,41 @@ extern int serverPort;
 extern int TCP_PORT;
 extern int INITIAL_CAPACITY;
 extern int LOAD_FACTOR_THRESHOLD;
+extern int UDP_WORKERS;           /* Nombre de workers UDP du serveur (0 = un par cœur) */
+extern int SESSION_TIMEOUT;       /* Secondes sans datagramme avant expiration d'une session */
+extern int HEARTBEAT_INTERVAL;    /* Secondes entre deux battements de cœur du client */
+extern int ROOM_HISTORY_MESSAGES; /* Messages conservés par salle (0 = pas d'historique) */
+extern int ROOM_HISTORY_BYTES;    /* Taille de l'arène d'historique d'une salle (octets) */
+extern int COALESCE_WINDOW_US;    /* Attente max (µs) avant l'envoi des messages regroupés (0 = fin du tour de boucle) */
+extern int LOG_SEGMENT_MB;         /* Taille d'un segment du journal des messages (Mo) */
+extern int LOG_RETENTION_HOURS;   /* Heures de conservation du journal (0 = indéfiniment) */
+extern int CHECKPOINT_INTERVAL;    /* Secondes entre deux points de reprise du WAL d'état (0 = sur la taille seulement) */
+extern int AUTH_THREADS;           /* Threads de vérification des mots de passe (-1 = un par cœur, 0 = dans le worker) */
+extern int KDF_ITERATIONS;         /* Itérations PBKDF2 des mots de passe enregistrés (kdf.h) */
+extern int XFER_THREADS;           /* Réacteurs epoll du serveur de fichiers (xfer.h) */
+extern int XFER_STREAMS;           /* Connexions parallèles d'un gros transfert côté client (xferclient.h, 1 = une seule) */
+extern int XFER_PART_MB;           /* Taille des morceaux d'un transfert parallèle (Mio) */
+extern int XFER_MAX_FILE_MB;       /* Taille maximale d'un fichier reçu par le serveur (Mio) */
+
+#define CHATLOG_DIR "logs"        /* Dossier par défaut du journal des messages (chatlog.h) */
+#define STATE_WAL_FILE "state.wal" /* WAL des comptes et des salles (wal.h) */
+#define STATE_SNAPSHOT_FILE "state.snap" /* Instantané binaire des comptes et des salles (snapshot.h) */
 
 /* Commandes de base */
 #define LOGIN_CMD "@login"        /* Format: "@login username" */
 #define MESSAGE_CMD "@message"    /* Format: "@message &destinataire message" */
+#define HEARTBEAT_CMD "@heartbeat" /* Format: "@heartbeat" (maintien de session, sans réponse) */
+#define RELIABLE_OPT "+rel"       /* Option de @login : "@login username password +rel" active la couche fiable */
+#define BINARY_OPT "+bin"         /* Option de @login : protocole binaire (wire.h) pour les messages */
+#define BATCH_OPT "+batch"        /* Option de @login : messages sortants regroupés par datagramme (outbox.h) */
+#define PING_CMD "@ping"          /* Format: "@ping" */
+#define SHUTDOWN_CMD "@shutdown"  /* Format: "@shutdown" (admin uniquement) */
+#define HELP_CMD "@help"          /* Format: "@help" */
+#define CREDITS_CMD "@credits"    /* Format: "@credits" */
+
+/* Commandes de transfert de fichiers */
+#define UPLOAD_CMD "@upload"      /* Format: "@upload nom_fichier" */
+#define DOWNLOAD_CMD "@download"  /* Format: "@download nom_fichier [début longueur]" (connexion TCP) */
 
 /* Commandes pour les salles de chat */
 #define CREATEROOM_CMD "@createroom"  /* Format: "@createroom nom_salle max_membres" */
@@ -17,9 +48,37 @@ extern int LOAD_FACTOR_THRESHOLD;
 #define LISTROOMS_CMD "@listrooms"    /* Format: "@listrooms" */
 #define ROOMSG_CMD "@roomsg"          /* Format: "@roomsg nom_salle message" */
 #define LISTMEMBERS_CMD "@listmembers" /* Format: "@listmembers nom_salle" */
+#define DELETEROOM_CMD "@deleteroom"  /* Format: "@deleteroom nom_salle" */
+#define HISTORY_CMD "@history"        /* Format: "@history nom_salle [page]" (page 1 = messages les plus récents) */
+
+/*
+ * Table des commandes UDP du serveur, déclarée une seule fois :
+ * X(jeton, gestionnaire, drapeaux). server.c en dérive un gestionnaire
+ * cmd_<gestionnaire> par commande et leur table de hachage parfait (cmdhash.h).
+ * Drapeaux : CMD_PUBLIC (utilisable sans session), CMD_MUTATES (verrou d'état
+ * en écriture), CMD_QUIET (pas de trace à la réception), CMD_SECRET (trace
+ * sans les arguments après le premier, ex. le mot de passe de @login).
+ */
+#define SERVER_COMMANDS(X) \
+    X(LOGIN_CMD,       login,       CMD_PUBLIC | CMD_SECRET) \
+    X(HEARTBEAT_CMD,   heartbeat,   CMD_PUBLIC | CMD_QUIET) \
+    X(PING_CMD,        ping,        0) \
+    X(SHUTDOWN_CMD,    shutdown,    0) \
+    X(MESSAGE_CMD,     message,     0) \
+    X(UPLOAD_CMD,      upload,      0) \
+    X(CREATEROOM_CMD,  createroom,  CMD_MUTATES) \
+    X(JOINROOM_CMD,    joinroom,    CMD_MUTATES) \
+    X(LEAVEROOM_CMD,   leaveroom,   CMD_MUTATES) \
+    X(DELETEROOM_CMD,  deleteroom,  CMD_MUTATES) \
+    X(LISTROOMS_CMD,   listrooms,   0) \
+    X(LISTMEMBERS_CMD, listmembers, 0) \
+    X(ROOMSG_CMD,      roomsg,      0) \
+    X(HISTORY_CMD,     history,     0) \
+    X(HELP_CMD,        help,        0) \
+    X(CREDITS_CMD,     credits,     0)
 
 /* Configuration des salles de chat */
-#define MAX_ROOMS 20              /* Nombre maximum de salles */
 #define MAX_ROOM_NAME_LENGTH 50   /* Longueur maximum du nom d'une salle */
+#define MAX_ROOM_MEMBERS 100000   /* Plafond de max_members (@createroom, restauration) */
 
 #endif
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "kdf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+
+#define KDF_MAX_ITERATIONS 100000000u   /* borne d'un enregistrement relu */
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void compress(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)block[4*i] << 24 | (uint32_t)block[4*i+1] << 16 |
+               (uint32_t)block[4*i+2] << 8 | block[4*i+3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR(w[i-15], 7) ^ ROR(w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = ROR(w[i-2], 17) ^ ROR(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void sha256_init(Sha256 *c) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(c->state, iv, sizeof(iv));
+    c->length = 0;
+    c->used = 0;
+}
+
+void sha256_update(Sha256 *c, const void *data, size_t len) {
+    const uint8_t *p = data;
+    c->length += len;
+    if (c->used) {
+        size_t n = 64 - c->used < len ? 64 - c->used : len;
+        memcpy(c->block + c->used, p, n);
+        c->used += n;
+        p += n;
+        len -= n;
+        if (c->used < 64) return;
+        compress(c->state, c->block);
+        c->used = 0;
+    }
+    for (; len >= 64; p += 64, len -= 64) compress(c->state, p);
+    memcpy(c->block, p, len);
+    c->used = len;
+}
+
+void sha256_final(Sha256 *c, uint8_t out[SHA256_BYTES]) {
+    uint64_t bits = c->length * 8;
+    c->block[c->used++] = 0x80;
+    if (c->used > 56) {
+        memset(c->block + c->used, 0, 64 - c->used);
+        compress(c->state, c->block);
+        c->used = 0;
+    }
+    memset(c->block + c->used, 0, 56 - c->used);
+    for (int i = 0; i < 8; i++) c->block[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+    compress(c->state, c->block);
+    for (int i = 0; i < 8; i++) {
+        out[4*i] = c->state[i] >> 24;
+        out[4*i+1] = c->state[i] >> 16;
+        out[4*i+2] = c->state[i] >> 8;
+        out[4*i+3] = c->state[i];
+    }
+}
+
+/* HMAC-SHA256 : contextes intérieur et extérieur préparés une fois par clé */
+typedef struct {
+    Sha256 inner, outer;
+} Hmac;
+
+static void hmac_init(Hmac *h, const void *key, size_t key_len) {
+    uint8_t k[64] = { 0 }, pad[64];
+    if (key_len > 64) {
+        Sha256 c;
+        sha256_init(&c);
+        sha256_update(&c, key, key_len);
+        sha256_final(&c, k);
+    } else {
+        memcpy(k, key, key_len);
+    }
+    for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x36;
+    sha256_init(&h->inner);
+    sha256_update(&h->inner, pad, 64);
+    for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x5c;
+    sha256_init(&h->outer);
+    sha256_update(&h->outer, pad, 64);
+}
+
+/* HMAC(clé, a || b) à partir des contextes préparés */
+static void hmac(const Hmac *h, const void *a, size_t a_len, const void *b, size_t b_len,
+                 uint8_t out[SHA256_BYTES]) {
+    Sha256 c = h->inner;
+    sha256_update(&c, a, a_len);
+    if (b_len) sha256_update(&c, b, b_len);
+    sha256_final(&c, out);
+    c = h->outer;
+    sha256_update(&c, out, SHA256_BYTES);
+    sha256_final(&c, out);
+}
+
+void pbkdf2_sha256(const void *password, size_t password_len, const void *salt, size_t salt_len,
+                   unsigned iterations, uint8_t *out, size_t out_len) {
+    Hmac h;
+    hmac_init(&h, password, password_len);
+    for (uint32_t block = 1; out_len > 0; block++) {
+        uint8_t index[4] = { block >> 24, block >> 16, block >> 8, block };
+        uint8_t u[SHA256_BYTES], t[SHA256_BYTES];
+        hmac(&h, salt, salt_len, index, sizeof(index), u);
+        memcpy(t, u, sizeof(t));
+        for (unsigned i = 1; i < iterations; i++) {
+            hmac(&h, u, sizeof(u), NULL, 0, u);
+            for (int j = 0; j < SHA256_BYTES; j++) t[j] ^= u[j];
+        }
+        size_t n = out_len < SHA256_BYTES ? out_len : SHA256_BYTES;
+        memcpy(out, t, n);
+        out += n;
+        out_len -= n;
+    }
+}
+
+static void to_hex(const uint8_t *bytes, size_t n, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < n; i++) {
+        out[2*i] = digits[bytes[i] >> 4];
+        out[2*i+1] = digits[bytes[i] & 15];
+    }
+    out[2*n] = '\0';
+}
+
+/* Décode exactement n octets depuis hex (2n chiffres suivis de stop), 0 si invalide */
+static int from_hex(const char *hex, uint8_t *out, size_t n, char stop) {
+    for (size_t i = 0; i < 2 * n; i++) {
+        char ch = hex[i];
+        int v = ch >= '0' && ch <= '9' ? ch - '0' : ch >= 'a' && ch <= 'f' ? ch - 'a' + 10 : -1;
+        if (v < 0) return 0;
+        if (i % 2 == 0) out[i/2] = v << 4;
+        else out[i/2] |= v;
+    }
+    return hex[2*n] == stop;
+}
+
+int kdf_hash_password(const char *password, unsigned iterations, char *out, size_t cap) {
+    uint8_t salt[KDF_SALT_BYTES], hash[KDF_HASH_BYTES];
+    if (getrandom(salt, sizeof(salt), 0) != (ssize_t)sizeof(salt)) return 0;
+    pbkdf2_sha256(password, strlen(password), salt, sizeof(salt), iterations, hash, sizeof(hash));
+    char salt_hex[2 * KDF_SALT_BYTES + 1], hash_hex[2 * KDF_HASH_BYTES + 1];
+    to_hex(salt, sizeof(salt), salt_hex);
+    to_hex(hash, sizeof(hash), hash_hex);
+    int n = snprintf(out, cap, KDF_PREFIX "%u$%s$%s", iterations, salt_hex, hash_hex);
+    return n > 0 && (size_t)n < cap;
+}
+
+/* Égalité de a et b (n octets) sans sortie anticipée */
+static int equal_ct(const uint8_t *a, const uint8_t *b, size_t n) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < n; i++) diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
+int kdf_is_hashed(const char *stored) {
+    return strncmp(stored, KDF_PREFIX, strlen(KDF_PREFIX)) == 0;
+}
+
+int kdf_verify_password(const char *stored, const char *password) {
+    if (!kdf_is_hashed(stored)) {
+        size_t a = strlen(stored), b = strlen(password);
+        return a == b && equal_ct((const uint8_t *)stored, (const uint8_t *)password, a);
+    }
+    const char *p = stored + strlen(KDF_PREFIX);
+    char *end;
+    unsigned long iterations = strtoul(p, &end, 10);
+    if (end == p || *end != '$' || iterations == 0 || iterations > KDF_MAX_ITERATIONS) return 0;
+    uint8_t salt[KDF_SALT_BYTES], expected[KDF_HASH_BYTES], hash[KDF_HASH_BYTES];
+    if (!from_hex(end + 1, salt, sizeof(salt), '$') ||
+        !from_hex(end + 2 + 2 * KDF_SALT_BYTES, expected, sizeof(expected), '\0')) return 0;
+    pbkdf2_sha256(password, strlen(password), salt, sizeof(salt), (unsigned)iterations, hash, sizeof(hash));
+    return equal_ct(hash, expected, sizeof(hash));
+}
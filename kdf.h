@@ -0,0 +1,59 @@
+#ifndef KDF_H
+#define KDF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Dérivation de clé pour les mots de passe : SHA-256, HMAC-SHA256 et
+ * PBKDF2-HMAC-SHA256 (RFC 8018), sans dépendance externe.
+ *
+ * Un mot de passe est conservé (users_dict, WAL, instantané) sous la forme
+ *   pbkdf2-sha256$itérations$sel$empreinte
+ * sel (16 octets) et empreinte (32 octets) en hexadécimal : aucun ':'
+ * n'y figure, la ligne reste lisible par les formats texte existants.
+ *
+ * Une vérification coûte `itérations` appels HMAC, soit plusieurs
+ * millisecondes de CPU : elle se fait hors du verrou d'état (workpool.h).
+ */
+
+#define KDF_PREFIX "pbkdf2-sha256$"
+#define KDF_SALT_BYTES 16
+#define KDF_HASH_BYTES 32
+#define KDF_RECORD_MAX 160      /* taille max d'un enregistrement, '\0' compris */
+#define KDF_PASSWORD_MAX 128    /* longueur max d'un mot de passe, '\0' compris */
+
+#define SHA256_BYTES 32
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;            /* octets absorbés */
+    uint8_t block[64];
+    size_t used;                /* octets en attente dans block */
+} Sha256;
+
+void sha256_init(Sha256 *c);
+void sha256_update(Sha256 *c, const void *data, size_t len);
+void sha256_final(Sha256 *c, uint8_t out[SHA256_BYTES]);
+
+/* PBKDF2-HMAC-SHA256 : out_len octets de clé dérivée dans out */
+void pbkdf2_sha256(const void *password, size_t password_len, const void *salt, size_t salt_len,
+                   unsigned iterations, uint8_t *out, size_t out_len);
+
+/*
+ * Dérive password avec un sel aléatoire et écrit l'enregistrement dans
+ * out (KDF_RECORD_MAX octets). Retourne 0 si erreur (pas d'aléa)
+ */
+int kdf_hash_password(const char *password, unsigned iterations, char *out, size_t cap);
+
+/*
+ * Vérifie password contre l'enregistrement stored, en temps constant.
+ * Un enregistrement sans préfixe KDF_PREFIX est un ancien mot de passe en
+ * clair (users.txt) : comparé tel quel, à remplacer par kdf_hash_password
+ */
+int kdf_verify_password(const char *stored, const char *password);
+
+/* L'enregistrement est-il une empreinte (et non un ancien mot de passe en clair) ? */
+int kdf_is_hashed(const char *stored);
+
+#endif
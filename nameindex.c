@@ -0,0 +1,122 @@
+#include "nameindex.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NAMEINDEX_INITIAL_CAPACITY 64
+
+/* FNV-1a 64 bits */
+static uint64_t name_hash(const char *name) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static int nameindex_alloc(NameIndex *ix, size_t capacity) {
+    ix->keys = malloc(capacity * sizeof(const char *));
+    ix->hashes = malloc(capacity * sizeof(uint64_t));
+    ix->slots = malloc(capacity * sizeof(int));
+    if (!ix->keys || !ix->hashes || !ix->slots) {
+        free(ix->keys);
+        free(ix->hashes);
+        free(ix->slots);
+        return 0;
+    }
+    for (size_t i = 0; i < capacity; i++) ix->slots[i] = -1;
+    ix->capacity = capacity;
+    ix->count = 0;
+    return 1;
+}
+
+NameIndex *nameindex_create(void) {
+    NameIndex *ix = malloc(sizeof(NameIndex));
+    if (!ix) return NULL;
+    if (!nameindex_alloc(ix, NAMEINDEX_INITIAL_CAPACITY)) {
+        free(ix);
+        return NULL;
+    }
+    return ix;
+}
+
+void nameindex_free(NameIndex *ix) {
+    if (!ix) return;
+    free(ix->keys);
+    free(ix->hashes);
+    free(ix->slots);
+    free(ix);
+}
+
+/* Position de name dans la table, ou de la case vide où l'insérer */
+static size_t nameindex_find(const NameIndex *ix, const char *name, uint64_t h) {
+    size_t mask = ix->capacity - 1;
+    size_t i = h & mask;
+    while (ix->slots[i] != -1 &&
+           (ix->hashes[i] != h || strcmp(ix->keys[i], name) != 0)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/* Double la capacité et réinsère toutes les clés */
+static int nameindex_grow(NameIndex *ix) {
+    NameIndex old = *ix;
+    if (!nameindex_alloc(ix, old.capacity * 2)) {
+        *ix = old;
+        return 0;
+    }
+    size_t mask = ix->capacity - 1;
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (old.slots[i] == -1) continue;
+        size_t j = old.hashes[i] & mask;
+        while (ix->slots[j] != -1) j = (j + 1) & mask;
+        ix->keys[j] = old.keys[i];
+        ix->hashes[j] = old.hashes[i];
+        ix->slots[j] = old.slots[i];
+        ix->count++;
+    }
+    free(old.keys);
+    free(old.hashes);
+    free(old.slots);
+    return 1;
+}
+
+int nameindex_put(NameIndex *ix, const char *name, int slot) {
+    if (!ix || !name || slot < 0) return 0;
+    if ((ix->count + 1) * 2 > ix->capacity && !nameindex_grow(ix)) return 0;
+    uint64_t h = name_hash(name);
+    size_t i = nameindex_find(ix, name, h);
+    if (ix->slots[i] == -1) ix->count++;
+    ix->keys[i] = name;
+    ix->hashes[i] = h;
+    ix->slots[i] = slot;
+    return 1;
+}
+
+int nameindex_get(const NameIndex *ix, const char *name) {
+    if (!ix || !name) return -1;
+    return ix->slots[nameindex_find(ix, name, name_hash(name))];
+}
+
+int nameindex_remove(NameIndex *ix, const char *name) {
+    if (!ix || !name) return 0;
+    size_t mask = ix->capacity - 1;
+    size_t i = nameindex_find(ix, name, name_hash(name));
+    if (ix->slots[i] == -1) return 0;
+
+    // Décalage arrière (voir addrindex.c)
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; ix->slots[j] != -1; j = (j + 1) & mask) {
+        size_t home = ix->hashes[j] & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            ix->keys[hole] = ix->keys[j];
+            ix->hashes[hole] = ix->hashes[j];
+            ix->slots[hole] = ix->slots[j];
+            hole = j;
+        }
+    }
+    ix->slots[hole] = -1;
+    ix->count--;
+    return 1;
+}
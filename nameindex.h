@@ -0,0 +1,36 @@
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Index nom d'utilisateur → index de client
+ * Les clés ne sont pas copiées : elles pointent vers le nom stocké par
+ * l'appelant (ex. clients[i].username), qui doit rester valide.
+ * Table à adressage ouvert, sondage linéaire, suppression par décalage arrière
+ */
+typedef struct {
+    const char **keys;  /* nom de chaque case */
+    uint64_t *hashes;   /* hachage mémorisé : évite la plupart des strcmp */
+    int *slots;         /* index de client, -1 si case vide */
+    size_t count;       /* nb de cases occupées */
+    size_t capacity;    /* nb de cases (puissance de 2) */
+} NameIndex;
+
+/* Crée un index vide */
+NameIndex *nameindex_create(void);
+
+/* Libère un index (les noms référencés ne sont pas libérés) */
+void nameindex_free(NameIndex *ix);
+
+/* Associe name à slot (remplace l'association existante), 0 si erreur */
+int nameindex_put(NameIndex *ix, const char *name, int slot);
+
+/* Retourne l'index de client associé à name, -1 si absent */
+int nameindex_get(const NameIndex *ix, const char *name);
+
+/* Supprime l'association de name, renvoie 1 si supprimée, 0 sinon */
+int nameindex_remove(NameIndex *ix, const char *name);
+
+#endif
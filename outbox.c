@@ -0,0 +1,239 @@
+#define _GNU_SOURCE
+#include "outbox.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define OUTBOX_SEND_BATCH 64         /* datagrammes passés au noyau par appel sendmmsg */
+#define OUTBOX_INITIAL_SLOTS 256
+#define OUTBOX_INITIAL_DGRAMS 256
+#define OUTBOX_INITIAL_BYTES (256 * OUTBOX_MTU)
+
+static uint64_t addr_key(const struct sockaddr_in *addr) {
+    return ((uint64_t)addr->sin_addr.s_addr << 16) | addr->sin_port;
+}
+
+/* Mélange final de murmur3 (comme addrindex) */
+static size_t addr_hash(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return (size_t)k;
+}
+
+/* Case de key : celle qui la contient, sinon la case vide où l'insérer */
+static size_t probe(const Outbox *ob, uint64_t key) {
+    size_t mask = ob->slot_capacity - 1;
+    size_t i = addr_hash(key) & mask;
+    while (ob->slots[i] >= 0 && ob->keys[i] != key) i = (i + 1) & mask;
+    return i;
+}
+
+static int grow_slots(Outbox *ob) {
+    size_t old_capacity = ob->slot_capacity;
+    int *old_slots = ob->slots;
+    uint64_t *old_keys = ob->keys;
+    int *slots = malloc(old_capacity * 2 * sizeof(int));
+    uint64_t *keys = malloc(old_capacity * 2 * sizeof(uint64_t));
+    if (!slots || !keys) {
+        free(slots);
+        free(keys);
+        return 0;
+    }
+    memset(slots, 0xff, old_capacity * 2 * sizeof(int));
+    ob->slots = slots;
+    ob->keys = keys;
+    ob->slot_capacity = old_capacity * 2;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i] < 0) continue;
+        size_t j = probe(ob, old_keys[i]);
+        ob->slots[j] = old_slots[i];
+        ob->keys[j] = old_keys[i];
+    }
+    free(old_slots);
+    free(old_keys);
+    return 1;
+}
+
+/* Nouveau datagramme de cap octets pour to, retourne son numéro ou -1 */
+static int new_dgram(Outbox *ob, const struct sockaddr_in *to, size_t cap) {
+    if (ob->dgram_count == ob->dgram_capacity) {
+        int capacity = ob->dgram_capacity * 2;
+        OutDatagram *dgrams = realloc(ob->dgrams, capacity * sizeof(OutDatagram));
+        if (!dgrams) return -1;
+        ob->dgrams = dgrams;
+        ob->dgram_capacity = capacity;
+    }
+    if (ob->bytes_used + cap > ob->bytes_capacity) {
+        size_t capacity = ob->bytes_capacity * 2;
+        while (ob->bytes_used + cap > capacity) capacity *= 2;
+        char *bytes = realloc(ob->bytes, capacity);
+        if (!bytes) return -1;
+        ob->bytes = bytes;
+        ob->bytes_capacity = capacity;
+    }
+    OutDatagram *d = &ob->dgrams[ob->dgram_count];
+    d->addr = *to;
+    d->off = ob->bytes_used;
+    d->cap = cap;
+    d->len = OUTBOX_HEADER_LEN;
+    d->count = 0;
+    d->sealed = 0;
+    memcpy(ob->bytes + d->off, OUTBOX_HEADER, OUTBOX_HEADER_LEN);
+    ob->bytes_used += cap;
+    return ob->dgram_count++;
+}
+
+int outbox_init(Outbox *ob, int sock) {
+    memset(ob, 0, sizeof(*ob));
+    ob->sock = sock;
+    ob->slot_capacity = OUTBOX_INITIAL_SLOTS;
+    ob->slots = malloc(ob->slot_capacity * sizeof(int));
+    ob->keys = malloc(ob->slot_capacity * sizeof(uint64_t));
+    ob->dgram_capacity = OUTBOX_INITIAL_DGRAMS;
+    ob->dgrams = malloc(ob->dgram_capacity * sizeof(OutDatagram));
+    ob->bytes_capacity = OUTBOX_INITIAL_BYTES;
+    ob->bytes = malloc(ob->bytes_capacity);
+    if (!ob->slots || !ob->keys || !ob->dgrams || !ob->bytes) {
+        outbox_destroy(ob);
+        return 0;
+    }
+    memset(ob->slots, 0xff, ob->slot_capacity * sizeof(int));
+    return 1;
+}
+
+void outbox_destroy(Outbox *ob) {
+    free(ob->slots);
+    free(ob->keys);
+    free(ob->dgrams);
+    free(ob->bytes);
+    ob->slots = NULL;
+    ob->keys = NULL;
+    ob->dgrams = NULL;
+    ob->bytes = NULL;
+    ob->dgram_count = 0;
+}
+
+int outbox_add(Outbox *ob, const struct sockaddr_in *to, const void *msg, size_t len, uint64_t now_us) {
+    char head[24];
+    size_t head_len = (size_t)snprintf(head, sizeof(head), "%zu\n", len);
+    size_t record = head_len + len;
+
+    if ((size_t)(ob->recipients + 1) * 2 > ob->slot_capacity && !grow_slots(ob)) goto direct;
+    uint64_t key = addr_key(to);
+    size_t s = probe(ob, key);
+    OutDatagram *d = ob->slots[s] >= 0 ? &ob->dgrams[ob->slots[s]] : NULL;
+
+    // Nouveau datagramme si le destinataire n'en a pas d'ouvert ou si le
+    // message n'y tient plus ; un message trop long part seul
+    if (!d || d->sealed || d->len + record > d->cap) {
+        int big = OUTBOX_HEADER_LEN + record > OUTBOX_MTU;
+        if (!outbox_pending(ob)) ob->first_at = now_us;
+        int i = new_dgram(ob, to, big ? OUTBOX_HEADER_LEN + record : OUTBOX_MTU);
+        if (i < 0) goto direct;
+        if (ob->slots[s] < 0) {
+            ob->keys[s] = key;
+            ob->recipients++;
+        }
+        ob->slots[s] = i;
+        d = &ob->dgrams[i];
+        d->sealed = big;
+    }
+
+    char *p = ob->bytes + d->off + d->len;
+    memcpy(p, head, head_len);
+    memcpy(p + head_len, msg, len);
+    if (d->count == 0) {
+        d->first_off = d->len + head_len;
+        d->first_len = len;
+    }
+    d->len += record;
+    d->count++;
+    ob->messages++;
+    return 1;
+
+direct:
+    // Plus de mémoire : envoi immédiat plutôt que perte
+    ob->messages++;
+    ob->datagrams++;
+    if (sendto(ob->sock, msg, len, 0, (const struct sockaddr *)to, sizeof(*to)) < 0) {
+        ob->errors++;
+        return 0;
+    }
+    return 1;
+}
+
+int outbox_flush(Outbox *ob) {
+    struct mmsghdr msgs[OUTBOX_SEND_BATCH];
+    struct iovec iovs[OUTBOX_SEND_BATCH];
+    int errors = 0;
+
+    for (int base = 0; base < ob->dgram_count; base += OUTBOX_SEND_BATCH) {
+        int n = ob->dgram_count - base;
+        if (n > OUTBOX_SEND_BATCH) n = OUTBOX_SEND_BATCH;
+        for (int k = 0; k < n; k++) {
+            OutDatagram *d = &ob->dgrams[base + k];
+            // Un message seul part sans cadre
+            if (d->count == 1) {
+                iovs[k].iov_base = ob->bytes + d->off + d->first_off;
+                iovs[k].iov_len = d->first_len;
+            } else {
+                iovs[k].iov_base = ob->bytes + d->off;
+                iovs[k].iov_len = d->len;
+            }
+            memset(&msgs[k], 0, sizeof(msgs[k]));
+            msgs[k].msg_hdr.msg_name    = &d->addr;
+            msgs[k].msg_hdr.msg_namelen = sizeof(d->addr);
+            msgs[k].msg_hdr.msg_iov     = &iovs[k];
+            msgs[k].msg_hdr.msg_iovlen  = 1;
+        }
+
+        // sendmmsg s'arrête au premier échec : on compte le datagramme
+        // fautif et on reprend juste après lui (comme fanout_send)
+        int off = 0;
+        while (off < n) {
+            int sent = sendmmsg(ob->sock, msgs + off, n - off, 0);
+            if (sent < 0) {
+                errors++;
+                off++;
+            } else {
+                off += sent;
+            }
+        }
+    }
+
+    ob->datagrams += ob->dgram_count;
+    ob->errors += errors;
+    ob->dgram_count = 0;
+    ob->bytes_used = 0;
+    if (ob->recipients) {
+        memset(ob->slots, 0xff, ob->slot_capacity * sizeof(int));
+        ob->recipients = 0;
+    }
+    return errors;
+}
+
+int outbox_is_batch(const char *buf, size_t len) {
+    return len >= OUTBOX_HEADER_LEN && memcmp(buf, OUTBOX_HEADER, OUTBOX_HEADER_LEN) == 0;
+}
+
+int outbox_next(const char *buf, size_t len, size_t *pos, const char **msg, size_t *msg_len) {
+    size_t i = *pos ? *pos : OUTBOX_HEADER_LEN;
+    if (i >= len) return 0;
+
+    size_t n = 0;
+    int digits = 0;
+    while (i < len && buf[i] >= '0' && buf[i] <= '9' && digits < 9) {
+        n = n * 10 + (size_t)(buf[i++] - '0');
+        digits++;
+    }
+    if (!digits || i >= len || buf[i] != '\n' || n > len - i - 1) return 0;
+    *msg = buf + i + 1;
+    *msg_len = n;
+    *pos = i + 1 + n;
+    return 1;
+}
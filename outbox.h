@@ -0,0 +1,84 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+
+/**
+ * Regroupement des messages sortants par destinataire.
+ * Pendant un tour de boucle d'un worker, les messages destinés à un même
+ * client sont accumulés puis envoyés dans aussi peu de datagrammes que
+ * possible (au plus OUTBOX_MTU octets chacun), par appels sendmmsg.
+ *
+ * Format d'un datagramme regroupé (le '~' ne commence aucune commande) :
+ *   "~M\n" puis, pour chaque message, "<longueur>\n<octets>"
+ * Un datagramme qui ne contient qu'un message part tel quel, sans cadre ;
+ * un message trop long pour un datagramme regroupé part seul aussi, après
+ * ceux qui le précèdent pour le même destinataire.
+ *
+ * Une outbox appartient à un seul thread : aucune fonction ne verrouille.
+ */
+
+#define OUTBOX_MTU 1400          /* taille max d'un datagramme regroupé (sous la MTU du chemin) */
+#define OUTBOX_HEADER "~M\n"
+#define OUTBOX_HEADER_LEN 3
+
+/* Datagramme en construction ou prêt à partir */
+typedef struct {
+    struct sockaddr_in addr;
+    size_t off;                /* début dans bytes */
+    size_t len, cap;           /* octets écrits, réservés */
+    size_t first_off, first_len; /* premier message (envoyé sans cadre s'il est seul) */
+    int count;                 /* nb de messages */
+    int sealed;                /* plus d'ajout possible (message trop long) */
+} OutDatagram;
+
+typedef struct {
+    int sock;
+    OutDatagram *dgrams;       /* dans l'ordre de création : l'ordre par destinataire est conservé */
+    int dgram_count, dgram_capacity;
+    int *slots;                /* adresse → dernier datagramme du destinataire, -1 si vide */
+    uint64_t *keys;
+    size_t slot_capacity;      /* puissance de 2 */
+    int recipients;            /* nb de cases occupées */
+    char *bytes;               /* contenu de tous les datagrammes */
+    size_t bytes_used, bytes_capacity;
+    uint64_t first_at;         /* instant (µs) du premier message en attente */
+
+    /* Statistiques */
+    unsigned long messages, datagrams, errors;
+} Outbox;
+
+/* Prépare une outbox vide qui enverra par sock, 0 si erreur */
+int outbox_init(Outbox *ob, int sock);
+
+/* Libère les tampons d'une outbox (les messages en attente sont perdus) */
+void outbox_destroy(Outbox *ob);
+
+/*
+ * Met msg en attente pour to ; now_us sert à mesurer l'attente du premier
+ * message. En cas d'échec d'allocation, le message part tout de suite.
+ * Retourne 0 si le message est perdu.
+ */
+int outbox_add(Outbox *ob, const struct sockaddr_in *to, const void *msg, size_t len, uint64_t now_us);
+
+/* Retourne 1 si des messages attendent */
+static inline int outbox_pending(const Outbox *ob) {
+    return ob->dgram_count > 0;
+}
+
+/* Envoie tous les datagrammes en attente, retourne le nombre d'échecs */
+int outbox_flush(Outbox *ob);
+
+/* Retourne 1 si buf est un datagramme regroupé */
+int outbox_is_batch(const char *buf, size_t len);
+
+/*
+ * Parcourt un datagramme regroupé : *pos vaut 0 au premier appel.
+ * Retourne 1 et le message suivant dans (*msg, *msg_len), 0 à la fin ou
+ * si le datagramme est malformé.
+ */
+int outbox_next(const char *buf, size_t len, size_t *pos, const char **msg, size_t *msg_len);
+
+#endif
@@ -0,0 +1,380 @@
+#include "reliable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+RelPeer *rel_create(uint32_t epoch) {
+    RelPeer *p = calloc(1, sizeof(RelPeer));
+    if (!p) return NULL;
+    pthread_mutex_init(&p->lock, NULL);
+    p->epoch = epoch;
+    p->next_seq = 1;
+    p->send_base = 1;
+    p->rto = REL_RTO_INITIAL_MS;
+    return p;
+}
+
+/* Libère les messages du pair, retourne le nombre d'émis non acquittés */
+static int rel_release(RelPeer *p) {
+    int unacked = 0;
+    for (int i = 0; i < REL_WINDOW; i++) {
+        if (p->inflight[i].data) unacked++;
+        free(p->inflight[i].data);
+        free(p->held[i].data);
+    }
+    while (p->backlog_head) {
+        RelQueued *q = p->backlog_head;
+        p->backlog_head = q->next;
+        free(q);
+    }
+    free(p->streams);
+    return unacked;
+}
+
+int rel_reset(RelPeer *p, uint32_t epoch) {
+    int unacked = rel_release(p) + p->backlog_len;
+    memset(p->inflight, 0, sizeof(p->inflight));
+    memset(p->held, 0, sizeof(p->held));
+    p->backlog_tail = NULL;
+    p->backlog_len = 0;
+    p->streams = NULL;
+    p->stream_count = p->stream_capacity = 0;
+    p->epoch = epoch;
+    p->next_seq = 1;
+    p->send_base = 1;
+    p->srtt = p->rttvar = 0;
+    p->rto = REL_RTO_INITIAL_MS;
+    p->rtt_valid = 0;
+    p->cum_ack = 0;
+    p->sack = 0;
+    p->ack_pending = 0;
+    p->ack_due = 0;
+    return unacked;
+}
+
+void rel_free(RelPeer *p) {
+    if (!p) return;
+    rel_release(p);
+    pthread_mutex_destroy(&p->lock);
+    free(p);
+}
+
+int rel_is_frame(const char *buf, size_t len) {
+    return len >= 2 && buf[0] == '~' && (buf[1] == 'R' || buf[1] == 'A' || buf[1] == 'E');
+}
+
+int rel_frame_epoch(const char *buf, size_t len, uint32_t *epoch) {
+    // Le champ suit "~X " : il tient dans les premiers octets de l'en-tête
+    char header[16];
+    if (!rel_is_frame(buf, len)) return 0;
+    size_t n = len < sizeof(header) - 1 ? len : sizeof(header) - 1;
+    memcpy(header, buf, n);
+    header[n] = '\0';
+    return sscanf(header + 2, " %" SCNu32, epoch) == 1;
+}
+
+size_t rel_epoch_frame(char *out, size_t cap, uint32_t epoch) {
+    int n = snprintf(out, cap, "~E %" PRIu32, epoch);
+    return n < 0 ? 0 : (size_t)n < cap ? (size_t)n : cap - 1;
+}
+
+/* Compteurs du flux id, créés à la première utilisation (NULL si erreur) */
+static RelStream *rel_stream(RelPeer *p, uint32_t id) {
+    // Un pair n'utilise que quelques flux (ses salles) : parcours linéaire
+    for (int i = 0; i < p->stream_count; i++) {
+        if (p->streams[i].id == id) return &p->streams[i];
+    }
+    if (p->stream_count == p->stream_capacity) {
+        int cap = p->stream_capacity ? p->stream_capacity * 2 : 4;
+        RelStream *s = realloc(p->streams, cap * sizeof(RelStream));
+        if (!s) return NULL;
+        p->streams = s;
+        p->stream_capacity = cap;
+    }
+    RelStream *s = &p->streams[p->stream_count++];
+    s->id = id;
+    s->next_send = 1;
+    s->next_recv = 1;
+    return s;
+}
+
+/* Émet la trame de slot avec l'état d'acquittement courant (piggy-back) */
+static void rel_emit(RelPeer *p, RelSlot *slot, uint64_t now, RelSendFn fn, void *ctx) {
+    char frame[REL_FRAME_MAX];
+    int h = snprintf(frame, REL_HEADER_MAX, "~R %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIx64 "\n",
+                     p->epoch, slot->seq, slot->stream, slot->sseq, p->cum_ack, p->sack);
+    memcpy(frame + h, slot->data, slot->len);
+    fn(ctx, frame, h + slot->len);
+    slot->sent_at = now;
+    p->ack_pending = 0;
+    p->ack_due = 0;
+}
+
+static void rel_send_ack(RelPeer *p, RelSendFn fn, void *ctx) {
+    char frame[REL_HEADER_MAX];
+    int h = snprintf(frame, sizeof(frame), "~A %" PRIu32 " %" PRIu32 " %" PRIx64, p->epoch, p->cum_ack, p->sack);
+    fn(ctx, frame, h);
+    p->ack_pending = 0;
+    p->ack_due = 0;
+}
+
+/* Place un message dans la fenêtre et l'émet (la fenêtre a de la place) */
+static int rel_transmit(RelPeer *p, uint32_t stream, uint32_t sseq, const char *msg,
+                        size_t len, uint64_t now, RelSendFn fn, void *ctx) {
+    RelSlot *slot = &p->inflight[p->next_seq % REL_WINDOW];
+    slot->data = malloc(len ? len : 1);
+    if (!slot->data) return 0;
+    memcpy(slot->data, msg, len);
+    slot->len = len;
+    slot->seq = p->next_seq++;
+    slot->stream = stream;
+    slot->sseq = sseq;
+    slot->retransmits = 0;
+    rel_emit(p, slot, now, fn, ctx);
+    return 1;
+}
+
+static int rel_window_full(const RelPeer *p) {
+    return p->next_seq - p->send_base >= REL_WINDOW;
+}
+
+int rel_send(RelPeer *p, uint32_t stream, const char *msg, size_t len,
+             uint64_t now, RelSendFn fn, void *ctx) {
+    if (len > REL_MAX_PAYLOAD) {
+        p->dropped++;
+        return 0;
+    }
+    RelStream *s = rel_stream(p, stream);
+    if (!s) {
+        p->dropped++;
+        return 0;
+    }
+
+    // Le sseq n'est consommé que si le message est accepté, sinon le
+    // destinataire attendrait indéfiniment un trou dans le flux
+    if (!p->backlog_head && !rel_window_full(p)) {
+        if (!rel_transmit(p, stream, s->next_send, msg, len, now, fn, ctx)) {
+            p->dropped++;
+            return 0;
+        }
+        s->next_send++;
+        return 1;
+    }
+
+    if (p->backlog_len >= REL_BACKLOG_MAX) {
+        p->dropped++;
+        return 0;
+    }
+    RelQueued *q = malloc(sizeof(RelQueued) + len);
+    if (!q) {
+        p->dropped++;
+        return 0;
+    }
+    q->next = NULL;
+    q->stream = stream;
+    q->sseq = s->next_send++;
+    q->len = len;
+    memcpy(q->data, msg, len);
+    if (p->backlog_tail) p->backlog_tail->next = q;
+    else p->backlog_head = q;
+    p->backlog_tail = q;
+    p->backlog_len++;
+    return 1;
+}
+
+/* Fait entrer la file d'attente dans la fenêtre libérée */
+static void rel_drain_backlog(RelPeer *p, uint64_t now, RelSendFn fn, void *ctx) {
+    while (p->backlog_head && !rel_window_full(p)) {
+        RelQueued *q = p->backlog_head;
+        if (!rel_transmit(p, q->stream, q->sseq, q->data, q->len, now, fn, ctx)) return;
+        p->backlog_head = q->next;
+        if (!p->backlog_head) p->backlog_tail = NULL;
+        p->backlog_len--;
+        free(q);
+    }
+}
+
+/* Met à jour SRTT/RTTVAR/RTO avec un échantillon (RFC 6298) */
+static void rel_rtt_sample(RelPeer *p, uint32_t rtt) {
+    if (!p->rtt_valid) {
+        p->srtt = rtt;
+        p->rttvar = rtt / 2;
+        p->rtt_valid = 1;
+    } else {
+        uint32_t err = rtt > p->srtt ? rtt - p->srtt : p->srtt - rtt;
+        p->rttvar = (3 * p->rttvar + err) / 4;
+        p->srtt = (7 * p->srtt + rtt) / 8;
+    }
+    uint32_t rto = p->srtt + 4 * p->rttvar;
+    if (rto < REL_RTO_MIN_MS) rto = REL_RTO_MIN_MS;
+    if (rto > REL_RTO_MAX_MS) rto = REL_RTO_MAX_MS;
+    p->rto = rto;
+}
+
+/* Délai de retransmission d'une trame (doublé à chaque réémission) */
+static uint64_t rel_slot_timeout(const RelPeer *p, const RelSlot *slot) {
+    uint64_t rto = (uint64_t)p->rto << (slot->retransmits < 6 ? slot->retransmits : 6);
+    return rto < REL_RTO_MAX_MS ? rto : REL_RTO_MAX_MS;
+}
+
+/* Applique un acquittement cumulatif + sélectif reçu du pair */
+static void rel_on_ack(RelPeer *p, uint32_t ack, uint64_t sack, uint64_t now,
+                       RelSendFn fn, void *ctx) {
+    uint32_t highest_sacked = 0;
+    for (uint32_t seq = p->send_base; seq != p->next_seq; seq++) {
+        RelSlot *slot = &p->inflight[seq % REL_WINDOW];
+        if (!slot->data) continue;
+        uint32_t d = seq - ack - 1;
+        int acked = (int32_t)(seq - ack) <= 0 || (d < 64 && (sack >> d) & 1);
+        if (!acked) continue;
+        if ((int32_t)(seq - ack) > 0) highest_sacked = seq;
+        // Karn : pas d'échantillon sur une trame réémise (ambigu)
+        if (slot->retransmits == 0) rel_rtt_sample(p, (uint32_t)(now - slot->sent_at));
+        free(slot->data);
+        slot->data = NULL;
+    }
+    while (p->send_base != p->next_seq && !p->inflight[p->send_base % REL_WINDOW].data) {
+        p->send_base++;
+    }
+
+    // Retransmission rapide : les trous sous une trame acquittée
+    // sélectivement sont réémis sans attendre leur délai
+    if (highest_sacked) {
+        for (uint32_t seq = p->send_base; (int32_t)(highest_sacked - seq) > 0; seq++) {
+            RelSlot *slot = &p->inflight[seq % REL_WINDOW];
+            if (slot->data && now - slot->sent_at >= (p->rtt_valid ? p->srtt : p->rto)) {
+                slot->retransmits++;
+                p->retransmits++;
+                rel_emit(p, slot, now, fn, ctx);
+            }
+        }
+    }
+    rel_drain_backlog(p, now, fn, ctx);
+}
+
+/* Copie un message délivré (deux '\0' : "commande + strlen + 1" reste valide) */
+static int rel_deliver(RelMsg *out, int n, uint32_t stream, const char *data, size_t len) {
+    char *copy = malloc(len + 2);
+    if (!copy) return n;
+    memcpy(copy, data, len);
+    copy[len] = '\0';
+    copy[len + 1] = '\0';
+    out[n].stream = stream;
+    out[n].data = copy;
+    out[n].len = len;
+    return n + 1;
+}
+
+int rel_receive(RelPeer *p, const char *frame, size_t len, uint64_t now,
+                RelMsg *out, RelSendFn fn, void *ctx) {
+    uint32_t epoch, seq, stream, sseq, ack;
+    uint64_t sack;
+    if (!rel_is_frame(frame, len) || frame[1] == 'E') return -1;
+
+    // Copie terminée par '\0' de l'en-tête pour sscanf
+    char header[REL_HEADER_MAX];
+    const char *nl = memchr(frame, '\n', len);
+    size_t hlen = nl ? (size_t)(nl - frame) : len;
+    if (hlen >= sizeof(header)) return -1;
+    memcpy(header, frame, hlen);
+    header[hlen] = '\0';
+
+    // Trame d'une session précédente : ses numéros ne valent rien dans celle-ci
+    if (frame[1] == 'A') {
+        if (sscanf(header, "~A %" SCNu32 " %" SCNu32 " %" SCNx64, &epoch, &ack, &sack) != 3 || epoch != p->epoch) return -1;
+        rel_on_ack(p, ack, sack, now, fn, ctx);
+        return 0;
+    }
+    if (!nl || sscanf(header, "~R %" SCNu32 " %" SCNu32 " %" SCNu32 " %" SCNu32 " %" SCNu32 " %" SCNx64,
+                      &epoch, &seq, &stream, &sseq, &ack, &sack) != 6 || epoch != p->epoch) {
+        return -1;
+    }
+    rel_on_ack(p, ack, sack, now, fn, ctx);
+
+    const char *data = nl + 1;
+    size_t data_len = len - hlen - 1;
+
+    // Doublon (déjà reçu) : notre acquittement s'est sans doute perdu
+    uint32_t d = seq - p->cum_ack - 1;
+    if ((int32_t)(seq - p->cum_ack) <= 0 || (d < 64 && (p->sack >> d) & 1)) {
+        p->duplicates++;
+        rel_send_ack(p, fn, ctx);
+        return 0;
+    }
+    if (d >= 64) return 0;  // hors fenêtre : l'émetteur réessaiera
+
+    int in_order = (d == 0);
+    p->sack |= (uint64_t)1 << d;
+    while (p->sack & 1) {
+        p->cum_ack++;
+        p->sack >>= 1;
+    }
+
+    // Acquittement immédiat si un trou apparaît ou toutes les deux trames,
+    // sinon différé (il partira avec la prochaine trame de données)
+    p->ack_pending++;
+    if (!in_order || p->sack || p->ack_pending >= 2) rel_send_ack(p, fn, ctx);
+    else if (!p->ack_due) p->ack_due = now + REL_ACK_DELAY_MS;
+
+    // Remise en ordre dans le flux
+    RelStream *s = rel_stream(p, stream);
+    if (!s) return 0;
+    int n = 0;
+    if ((int32_t)(sseq - s->next_recv) < 0) return 0;
+    if (sseq != s->next_recv) {
+        for (int i = 0; i < REL_WINDOW; i++) {
+            if (p->held[i].data) continue;
+            p->held[i].data = malloc(data_len ? data_len : 1);
+            if (!p->held[i].data) return 0;
+            memcpy(p->held[i].data, data, data_len);
+            p->held[i].len = data_len;
+            p->held[i].stream = stream;
+            p->held[i].sseq = sseq;
+            break;
+        }
+        return 0;
+    }
+    n = rel_deliver(out, n, stream, data, data_len);
+    s->next_recv++;
+
+    // Les messages retenus qui suivent deviennent délivrables
+    for (int found = 1; found && n < REL_MAX_DELIVER; ) {
+        found = 0;
+        for (int i = 0; i < REL_WINDOW; i++) {
+            RelHeld *h = &p->held[i];
+            if (h->data && h->stream == stream && h->sseq == s->next_recv) {
+                n = rel_deliver(out, n, stream, h->data, h->len);
+                free(h->data);
+                h->data = NULL;
+                s->next_recv++;
+                found = 1;
+            }
+        }
+    }
+    return n;
+}
+
+uint64_t rel_deadline(const RelPeer *p) {
+    uint64_t next = p->ack_due;
+    for (uint32_t seq = p->send_base; seq != p->next_seq; seq++) {
+        const RelSlot *slot = &p->inflight[seq % REL_WINDOW];
+        if (!slot->data) continue;
+        uint64_t due = slot->sent_at + rel_slot_timeout(p, slot);
+        if (!next || due < next) next = due;
+    }
+    return next;
+}
+
+uint64_t rel_tick(RelPeer *p, uint64_t now, RelSendFn fn, void *ctx) {
+    for (uint32_t seq = p->send_base; seq != p->next_seq; seq++) {
+        RelSlot *slot = &p->inflight[seq % REL_WINDOW];
+        if (slot->data && now >= slot->sent_at + rel_slot_timeout(p, slot)) {
+            slot->retransmits++;
+            p->retransmits++;
+            rel_emit(p, slot, now, fn, ctx);
+        }
+    }
+    if (p->ack_due && now >= p->ack_due) rel_send_ack(p, fn, ctx);
+    return rel_deadline(p);
+}
@@ -0,0 +1,171 @@
+#ifndef RELIABLE_H
+#define RELIABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "timerwheel.h"
+
+/**
+ * Couche de fiabilité optionnelle au-dessus d'UDP, partagée par le serveur
+ * et le client. Chaque pair a :
+ *  - des numéros de séquence (seq) pour l'acquittement et la retransmission ;
+ *  - des flux indépendants (un par salle côté serveur) numérotés à part
+ *    (sseq) : l'ordre est garanti dans un flux, une perte dans un flux ne
+ *    bloque pas les autres ;
+ *  - des acquittements cumulatifs + sélectifs (bitmap des REL_WINDOW seq
+ *    suivants) portés par chaque trame de données, ou envoyés seuls après
+ *    REL_ACK_DELAY_MS s'il n'y a rien à transmettre ;
+ *  - une retransmission sur délai estimé à partir du RTT (SRTT/RTTVAR,
+ *    algorithme de Karn) ;
+ *  - l'élimination des doublons à la réception.
+ *
+ * Format des trames (texte, le '~' ne commence aucune commande) :
+ *   données : "~R époque seq flux sseq ack sack\n<message>"
+ *   acquittement seul : "~A époque ack sack"
+ *   annonce d'époque : "~E époque"
+ * ack = plus grand seq reçu sans trou, sack = bits des seq ack+1..ack+64
+ * reçus, en hexadécimal.
+ *
+ * L'époque identifie une session fiable : le serveur en tire une nouvelle à
+ * chaque login qui demande la couche, et l'annonce (0 : pas de couche
+ * fiable) à chaque login réussi, puis en réponse à toute trame d'une autre
+ * époque. Une trame d'une autre époque est ignorée ; le pair qui apprend
+ * une nouvelle époque repart de zéro (rel_reset), ses numéros ne se mêlent
+ * jamais à ceux d'une session précédente.
+ *
+ * Aucune fonction ne verrouille : l'appelant détient p->lock.
+ */
+
+#define REL_WINDOW 64                /* trames non acquittées au plus (taille du SACK) */
+#define REL_BACKLOG_MAX 4096         /* messages en attente d'une place dans la fenêtre */
+#define REL_FRAME_MAX 4096           /* taille maximale d'une trame */
+#define REL_HEADER_MAX 96            /* place réservée à l'en-tête */
+#define REL_MAX_PAYLOAD (REL_FRAME_MAX - REL_HEADER_MAX)
+#define REL_SERVER_FRAME_MAX 1998    /* trame la plus longue que le serveur reçoit (BUFFER_SIZE - 2 de server.c) */
+#define REL_MAX_UPLINK_PAYLOAD (REL_SERVER_FRAME_MAX - REL_HEADER_MAX) /* message d'un client au plus */
+#define REL_MAX_DELIVER (REL_WINDOW + 1) /* messages délivrés au plus par trame reçue */
+#define REL_ACK_DELAY_MS 20          /* délai max avant un acquittement seul */
+#define REL_RTO_INITIAL_MS 200
+#define REL_RTO_MIN_MS 50
+#define REL_RTO_MAX_MS 4000
+#define REL_TICK_MS 10               /* granularité conseillée pour rel_tick */
+
+/* Émet une trame vers le pair (sendto de l'appelant) */
+typedef void (*RelSendFn)(void *ctx, const char *frame, size_t len);
+
+/* Trame émise en attente d'acquittement */
+typedef struct {
+    char *data;                /* message (sans en-tête), NULL si case libre */
+    size_t len;
+    uint32_t seq, stream, sseq;
+    uint64_t sent_at;          /* dernière émission (ms) */
+    int retransmits;           /* nb de réémissions (pas d'échantillon RTT si > 0) */
+} RelSlot;
+
+/* Message qui attend une place dans la fenêtre d'émission */
+typedef struct RelQueued {
+    struct RelQueued *next;
+    uint32_t stream, sseq;
+    size_t len;
+    char data[];
+} RelQueued;
+
+/* Message reçu en avance dans son flux, retenu jusqu'à combler le trou */
+typedef struct {
+    char *data;                /* NULL si case libre */
+    size_t len;
+    uint32_t stream, sseq;
+} RelHeld;
+
+/* Compteurs d'un flux dans chaque sens */
+typedef struct {
+    uint32_t id;
+    uint32_t next_send;        /* prochain sseq à attribuer */
+    uint32_t next_recv;        /* prochain sseq attendu */
+} RelStream;
+
+/* Message délivré, dans l'ordre de son flux (data terminé par deux '\0', à libérer) */
+typedef struct {
+    uint32_t stream;
+    char *data;
+    size_t len;
+} RelMsg;
+
+typedef struct {
+    pthread_mutex_t lock;      /* protège tout le pair */
+    TimerNode timer;           /* prochaine échéance (usage libre de l'appelant) */
+    uint32_t epoch;            /* session fiable (0 : couche inactive) */
+
+    /* Émission */
+    uint32_t next_seq;         /* prochain seq à attribuer */
+    uint32_t send_base;        /* plus ancien seq non acquitté */
+    RelSlot inflight[REL_WINDOW];  /* indexé par seq % REL_WINDOW */
+    RelQueued *backlog_head, *backlog_tail;
+    int backlog_len;
+    uint32_t srtt, rttvar, rto;    /* estimation du RTT (ms) */
+    int rtt_valid;
+
+    /* Réception */
+    uint32_t cum_ack;          /* plus grand seq reçu sans trou */
+    uint64_t sack;             /* bit i : seq cum_ack + 1 + i reçu */
+    int ack_pending;           /* trames reçues depuis le dernier acquittement */
+    uint64_t ack_due;          /* échéance de l'acquittement seul, 0 si aucun */
+    RelHeld held[REL_WINDOW];
+
+    RelStream *streams;
+    int stream_count, stream_capacity;
+
+    /* Statistiques */
+    unsigned long retransmits, duplicates, dropped;
+} RelPeer;
+
+/* Crée un pair de l'époque epoch à l'état initial (aucune trame échangée) */
+RelPeer *rel_create(uint32_t epoch);
+
+/*
+ * Remet le pair à l'état initial dans l'époque epoch (nouvelle session) :
+ * messages en attente et reçus en avance abandonnés. Retourne le nombre de
+ * messages émis qui n'avaient pas été acquittés.
+ */
+int rel_reset(RelPeer *p, uint32_t epoch);
+
+/* Libère un pair et tous ses messages en attente */
+void rel_free(RelPeer *p);
+
+/* Retourne 1 si buf est une trame de la couche fiable */
+int rel_is_frame(const char *buf, size_t len);
+
+/* Époque d'une trame (données, acquittement ou annonce), 0 si la trame est invalide */
+int rel_frame_epoch(const char *buf, size_t len, uint32_t *epoch);
+
+/* Écrit l'annonce "~E époque" dans out, retourne sa longueur */
+size_t rel_epoch_frame(char *out, size_t cap, uint32_t epoch);
+
+/*
+ * Envoie msg dans le flux stream : émis tout de suite si la fenêtre le
+ * permet, sinon mis en file. Retourne 0 si le message est abandonné
+ * (file pleine ou message trop long).
+ */
+int rel_send(RelPeer *p, uint32_t stream, const char *msg, size_t len,
+             uint64_t now, RelSendFn fn, void *ctx);
+
+/*
+ * Traite une trame reçue : acquittements, doublons, remise en ordre.
+ * Les messages devenus délivrables sont copiés dans out (au plus
+ * REL_MAX_DELIVER). Retourne leur nombre, ou -1 si la trame est invalide,
+ * d'une autre époque, ou une annonce.
+ */
+int rel_receive(RelPeer *p, const char *frame, size_t len, uint64_t now,
+                RelMsg *out, RelSendFn fn, void *ctx);
+
+/*
+ * Réémet les trames dont le délai a expiré et envoie l'acquittement seul
+ * s'il est dû. Retourne la prochaine échéance (ms), 0 s'il n'y en a pas.
+ */
+uint64_t rel_tick(RelPeer *p, uint64_t now, RelSendFn fn, void *ctx);
+
+/* Prochaine échéance (retransmission ou acquittement), 0 s'il n'y en a pas */
+uint64_t rel_deadline(const RelPeer *p);
+
+#endif
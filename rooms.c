@@ -0,0 +1,62 @@
+#include "rooms.h"
+#include <stdlib.h>
+
+RoomRegistry *rooms_create(void) {
+    RoomRegistry *reg = calloc(1, sizeof(RoomRegistry));
+    if (!reg) return NULL;
+    reg->free_head = -1;
+    return reg;
+}
+
+void rooms_free(RoomRegistry *reg) {
+    if (!reg) return;
+    for (int i = 0; i < reg->high_water; i++) chatroom_destroy(rooms_get(reg, i));
+    for (int i = 0; i < reg->chunk_count; i++) free(reg->chunks[i]);
+    free(reg->chunks);
+    free(reg);
+}
+
+/* Ajoute une tranche : seul le tableau des tranches est réalloué */
+static int rooms_grow(RoomRegistry *reg) {
+    ChatRoom **chunks = realloc(reg->chunks, (reg->chunk_count + 1) * sizeof(ChatRoom *));
+    if (!chunks) return 0;
+    reg->chunks = chunks;
+    ChatRoom *chunk = calloc(ROOM_CHUNK_SIZE, sizeof(ChatRoom));
+    if (!chunk) return 0;
+    reg->chunks[reg->chunk_count++] = chunk;
+    return 1;
+}
+
+int rooms_alloc(RoomRegistry *reg, const char *name, int max_members) {
+    if (!reg) return -1;
+    int handle;
+    int recycled = reg->free_head >= 0;
+    if (recycled) {
+        handle = reg->free_head;
+    } else {
+        if (reg->high_water == reg->chunk_count * ROOM_CHUNK_SIZE && !rooms_grow(reg)) {
+            return -1;
+        }
+        handle = reg->high_water;
+    }
+
+    ChatRoom *room = rooms_get(reg, handle);
+    int next_free = room->next_free;
+    if (!chatroom_init(room, name, max_members)) return -1;
+    if (recycled) reg->free_head = next_free;
+    else reg->high_water++;
+    room->next_free = -1;
+    reg->used++;
+    return handle;
+}
+
+void rooms_release(RoomRegistry *reg, int handle) {
+    if (!reg || handle < 0 || handle >= reg->high_water) return;
+    ChatRoom *room = rooms_get(reg, handle);
+    if (!room->active) return;
+    chatroom_destroy(room);
+    room->generation++;
+    room->next_free = reg->free_head;
+    reg->free_head = handle;
+    reg->used--;
+}
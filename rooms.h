@@ -0,0 +1,39 @@
+#ifndef ROOMS_H
+#define ROOMS_H
+
+#include "chatroom.h"
+
+#define ROOM_CHUNK_SHIFT 8                     /* 256 salles par tranche */
+#define ROOM_CHUNK_SIZE (1 << ROOM_CHUNK_SHIFT)
+
+/**
+ * Registre des salles : tranches de ROOM_CHUNK_SIZE salles allouées à la
+ * demande et jamais déplacées (une salle garde son adresse et son numéro
+ * jusqu'à sa suppression), liste libre des numéros de salles supprimées
+ */
+typedef struct {
+    ChatRoom **chunks;  /* tranches allouées */
+    int chunk_count;    /* nb de tranches */
+    int high_water;     /* numéros [0, high_water) déjà attribués au moins une fois */
+    int free_head;      /* premier numéro libre, -1 si aucun */
+    int used;           /* nb de salles actives */
+} RoomRegistry;
+
+/* Crée un registre vide */
+RoomRegistry *rooms_create(void);
+
+/* Libère le registre, ses salles et ses tranches */
+void rooms_free(RoomRegistry *reg);
+
+/* Crée une salle et retourne son numéro, -1 si erreur */
+int rooms_alloc(RoomRegistry *reg, const char *name, int max_members);
+
+/* Supprime une salle, son numéro pourra être réutilisé */
+void rooms_release(RoomRegistry *reg, int handle);
+
+/* Accès à la salle handle (handle < high_water), vérifier `active` */
+static inline ChatRoom *rooms_get(RoomRegistry *reg, int handle) {
+    return &reg->chunks[handle >> ROOM_CHUNK_SHIFT][handle & (ROOM_CHUNK_SIZE - 1)];
+}
+
+#endif
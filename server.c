@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
@@ -6,46 +7,142 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <errno.h>
 #include <signal.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <time.h>
 #include "globalVariables.h"
 #include "dict.h"
 #include "chatroom.h"
+#include "fanout.h"
+#include "addrindex.h"
+#include "nameindex.h"
+#include "clients.h"
+#include "rooms.h"
+#include "timerwheel.h"
+#include "reliable.h"
+#include "wire.h"
+#include "cmdhash.h"
+#include "outbox.h"
+#include "chatlog.h"
+#include "wal.h"
+#include "snapshot.h"
+#include "kdf.h"
+#include "workpool.h"
+#include "xfer.h"
 
 #define BUFFER_SIZE 2000
-#define FILE_BUFFER_SIZE 4096
-#define LOGIN_CMD "@login"
-#define MESSAGE_CMD "@message"
-#define UPLOAD_CMD "@upload"
-#define DOWNLOAD_CMD "@download"
-#define HELP_CMD "@help"
-#define CREDITS_CMD "@credits"
-#define MAX_USERS 100
+#define RECV_BATCH 32       // Datagrammes lus au plus par appel recvmmsg
+#define DIRECT_STREAM 0     // Flux fiable des messages privés ; salle h → flux h + 1
+#define HISTORY_PAGE_SIZE 20 // Messages par page de @history (et rejoués à l'arrivée dans une salle)
+#define WAL_CHECKPOINT_BYTES (4 * 1024 * 1024) // Taille du WAL qui déclenche un point de reprise
+#define AUTH_QUEUE_MAX 4096 // Connexions en attente de vérification au plus (au-delà : serveur saturé)
+#define AUTH_NICE 10        // Priorité réduite des threads de vérification
 
 // Flag pour contrôler la boucle principale
 static volatile sig_atomic_t running = 1;
 
-// Structure pour stocker les informations complètes d'un client
+// Worker UDP : un thread épinglé sur un cœur avec sa propre socket SO_REUSEPORT
 typedef struct {
-    char username[50];               // Nom d'utilisateur
-    struct sockaddr_in addr;         // Adresse du client
-    int active;                      // Flag si actif
-    int joined_rooms[MAX_ROOMS];     // Salles auxquelles il a adhéré
-    int room_count;                  // Nombre de salles
-} ClientInfo;
+    int id;                          // Numéro du worker (et du cœur)
+    int sock;                        // Socket UDP liée à serverPort
+    pthread_t tid;                   // Thread du worker
+} UdpWorker;
 
 // Variables globales pour les sockets
-int dS_udp;  // Socket UDP pour la messagerie
-int dS_tcp;  // Socket TCP pour les fichiers
+__thread int dS_udp = -1;  // Socket UDP du worker courant pour la messagerie
+static __thread Outbox *outbox = NULL;   // Messages regroupés du worker courant (NULL hors worker)
+static __thread bool reply_coalesce = false; // L'expéditeur en cours a demandé le regroupement
+int dS_tcp;                // Socket TCP pour les fichiers
 
 // Variables globales pour le système de chat
-SimpleDict *users_dict;              // Dictionnaire username → password
-ClientInfo *clients;                 // Tableau des clients
-int client_count = 0;                // Nombre de clients
-ChatRoom *rooms[MAX_ROOMS];          // Tableau des salles
-int room_count = 0;                  // Nombre de salles
-SimpleDict *room_dict;               // Dictionnaire nom_salle → index
+SimpleDict *users_dict;              // Dictionnaire username → empreinte du mot de passe (kdf.h)
+ClientRegistry *clients;             // Registre des clients (cases stables, recyclées)
+RoomRegistry *rooms;                 // Registre des salles (adresses stables, numéros réutilisés)
+NameIndex *room_names;               // Index nom_salle → numéro de salle
+AddrIndex *addr_index;               // Index (adresse, port) → client connecté
+static ChatLog *chat_log = NULL;     // Journal des messages (NULL si désactivé)
+static Wal *state_wal = NULL;        // WAL des comptes et des salles (NULL : instantané à l'arrêt seulement)
+static WorkPool *auth_pool = NULL;   // Vérification des mots de passe (NULL : dans le worker)
+NameIndex *name_index;               // Index username → client
+
+// Verrou de l'état partagé ci-dessus : lecture pour les commandes de
+// messagerie, écriture pour login/createroom/joinroom/leaveroom/deleteroom
+pthread_rwlock_t state_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Incrémentée à chaque changement d'adresse ou d'état d'un client (login) :
+// les caches d'adresses des salles calculés à une époque antérieure sont périmés
+unsigned long addr_epoch = 1;
+
+// Minuteurs d'inactivité des sessions (un par client connecté), avancés
+// par le worker 0 sous le verrou en écriture
+TimerWheel session_timers;
+
+// Échéances de la couche fiable (retransmissions, acquittements différés),
+// en ticks de REL_TICK_MS ; un minuteur par client qui l'a demandée
+TimerWheel rel_timers;
+pthread_mutex_t rel_timers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Compteurs de la couche fiable des sessions terminées
+unsigned long rel_retransmits = 0, rel_duplicates = 0, rel_dropped = 0;
+
+// Dernière époque fiable attribuée (reliable.h), sous le verrou en écriture.
+// Partie de l'heure du démarrage : une session d'avant un redémarrage ne
+// retombe pas sur le même numéro
+uint32_t rel_epoch_last = 0;
+
+// Compteurs du regroupement des messages, cumulés par les workers à leur arrêt
+unsigned long batch_messages = 0, batch_datagrams = 0;
+pthread_mutex_t batch_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Accès à la case i du registre des clients
+static inline ClientInfo *client_at(int i) {
+    return clients_get(clients, i);
+}
+
+// Tick courant des minuteurs de session : secondes d'horloge monotone
+static uint64_t now_tick(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec;
+}
+
+// Horloge de la couche fiable : millisecondes monotones
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Microsecondes monotones (fenêtre de regroupement des messages)
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Envoie un datagramme à to : mis en attente dans l'outbox du worker si le
+// destinataire a demandé le regroupement, sendto immédiat sinon.
+// Retourne 0 si échec
+static int udp_send(const struct sockaddr_in *to, socklen_t lg, const void *msg, size_t len, bool coalesce) {
+    if (coalesce && outbox) return outbox_add(outbox, to, msg, len, now_us());
+    return sendto(dS_udp, msg, len, 0, (const struct sockaddr*)to, lg) >= 0;
+}
+
+// Réponse à l'expéditeur du datagramme en cours de traitement
+static void reply(const struct sockaddr_in *to, socklen_t lg, const void *msg, size_t len) {
+    udp_send(to, lg, msg, len, reply_coalesce);
+}
+
+// Accès à la salle numéro h du registre des salles
+static inline ChatRoom *room_at(int h) {
+    return rooms_get(rooms, h);
+}
 
 // Fonction pour créer et configurer la socket TCP
 int setup_tcp_socket() {
@@ -71,7 +168,9 @@ int setup_tcp_socket() {
         close(tcp_socket);
         return -1;
     }
-    if (listen(tcp_socket, 5) < 0) {
+    // File d'attente des connexions au maximum du système : le réacteur
+    // (xfer.h) les accepte toutes à chaque réveil
+    if (listen(tcp_socket, SOMAXCONN) < 0) {
         perror("Erreur listen socket TCP");
         close(tcp_socket);
         return -1;
@@ -80,193 +179,542 @@ int setup_tcp_socket() {
     return tcp_socket;
 }
 
-// Fonction pour gérer l'upload d'un fichier
-void handle_file_upload(int client_socket, const char* command) {
-    // Extraire le nom du fichier de la commande
-    const char* filename = command + strlen(UPLOAD_CMD) + 1;
-    while (*filename == ' ') filename++; // Ignorer les espaces
+// Vérifie que le i-ème membre d'une salle désigne toujours la même
+// occupation de sa case client (sinon la case a été recyclée depuis)
+static int room_member_is_current(ChatRoom *room, int i) {
+    ClientInfo *c = client_at(room->member_indices[i]);
+    return c->in_use && c->generation == room->member_gens[i];
+}
 
-    if (strlen(filename) == 0) {
-        printf("Erreur: Nom de fichier manquant\n");
-        return;
+// Émission d'une trame de la couche fiable vers le client ctx
+static void rel_sendto(void *ctx, const char *frame, size_t len) {
+    ClientInfo *c = ctx;
+    udp_send(&c->addr, sizeof(c->addr), frame, len, c->batch);
+}
+
+// Avance (jamais ne recule) l'échéance de la couche fiable du client c.
+// Appelé sans tenir c->rel->lock : on ne détient jamais les deux verrous
+static void arm_rel_timer(ClientInfo *c, uint64_t deadline) {
+    if (!deadline) return;
+    uint64_t tick = (deadline + REL_TICK_MS - 1) / REL_TICK_MS;
+    pthread_mutex_lock(&rel_timers_lock);
+    if (!c->rel->timer.armed || tick < c->rel->timer.expires) {
+        timerwheel_schedule(&rel_timers, &c->rel->timer, tick);
     }
+    pthread_mutex_unlock(&rel_timers_lock);
+}
 
-    // Vérifier que le dossier uploads existe
-    struct stat st = {0};
-    if (stat("uploads", &st) == -1) {
-        mkdir("uploads", 0777);
-        printf("Dossier uploads créé\n");
+// Envoie msg au client uid : par la couche fiable, dans le flux stream, s'il
+// l'a demandée au login, en simple datagramme sinon. Retourne 0 si échec
+static int send_to_client(int uid, uint32_t stream, const char *msg, size_t len) {
+    ClientInfo *c = client_at(uid);
+    if (!c->rel) {
+        return udp_send(&c->addr, sizeof(c->addr), msg, len, c->batch);
     }
+    pthread_mutex_lock(&c->rel->lock);
+    int ok = rel_send(c->rel, stream, msg, len, now_ms(), rel_sendto, c);
+    uint64_t deadline = rel_deadline(c->rel);
+    pthread_mutex_unlock(&c->rel->lock);
+    arm_rel_timer(c, deadline);
+    return ok;
+}
 
-    // Créer le chemin complet du fichier
-    char filepath[512];
-    snprintf(filepath, sizeof(filepath), "uploads/%s", filename);
-    printf("Réception du fichier: %s\n", filepath);
+// Supprime l'état de la couche fiable du client c (fin de session ou
+// nouveau login) ; appelé sous le verrou d'état en écriture
+static void drop_reliable_peer(ClientInfo *c) {
+    if (!c->rel) return;
+    pthread_mutex_lock(&rel_timers_lock);
+    timerwheel_cancel(&c->rel->timer);
+    pthread_mutex_unlock(&rel_timers_lock);
+    rel_retransmits += c->rel->retransmits;
+    rel_duplicates += c->rel->duplicates;
+    rel_dropped += c->rel->dropped;
+    rel_free(c->rel);
+    c->rel = NULL;
+}
 
-    // Ouvrir le fichier en écriture
-    FILE* file = fopen(filepath, "wb");
-    if (!file) {
-        printf("Erreur: Création du fichier %s\n", filepath);
-        return;
+// Recalcule le cache d'adresses des membres actifs d'une salle
+// (l'appelant détient room->lock)
+static void refresh_room_dests(ChatRoom *room) {
+    room->dest_count = 0;
+    room->bin_dest_count = 0;
+    room->rel_dest_count = 0;
+    room->batch_dest_count = 0;
+    for (int i = 0; i < room->member_count; i++) {
+        int member = room->member_indices[i];
+        if (room_member_is_current(room, i) && client_at(member)->active) {
+            if (client_at(member)->rel) room->rel_dests[room->rel_dest_count++] = member;
+            else if (client_at(member)->batch) room->batch_dests[room->batch_dest_count++] = member;
+            else if (client_at(member)->binary) room->bin_dests[room->bin_dest_count++] = client_at(member)->addr;
+            else room->dests[room->dest_count++] = client_at(member)->addr;
+        }
     }
+    room->dest_epoch = addr_epoch;
+}
 
-    // Recevoir et écrire le contenu du fichier
-    char buffer[FILE_BUFFER_SIZE];
-    ssize_t bytes_received;
-    size_t total_received = 0;
-    
-    while ((bytes_received = recv(client_socket, buffer, FILE_BUFFER_SIZE, 0)) > 0) {
-        fwrite(buffer, 1, bytes_received, file);
-        total_received += bytes_received;
-        printf("Réception en cours: %zu octets reçus\r", total_received);
-        fflush(stdout);
+// Trame binaire d'un message de salle : la même pour tous les destinataires
+// (le nom de l'expéditeur reste en clair, la salle est une poignée)
+static size_t build_room_msg_frame(uint8_t *frame, int room_index, const char *sender, const char *message) {
+    WireWriter w;
+    wire_begin(&w, frame, WIRE_FRAME_MAX, WOP_ROOM_MSG);
+    wire_put_varint(&w, room_index);
+    wire_put_varint(&w, room_at(room_index)->generation);
+    wire_put_str(&w, sender);
+    wire_put_str(&w, message);
+    return w.overflow ? 0 : w.len;
+}
+
+// Diffuse un message à tous les membres d'une salle (sauf expéditeur) ;
+// record : le message entre dans l'historique de la salle (pas les avis du serveur)
+void broadcast_to_room(int room_index, const char *message, const char *sender_username,
+                       struct sockaddr_in *sender_addr, bool record) {
+    if (room_index < 0 || room_index >= rooms->high_water || !room_at(room_index)->active) return;
+    ChatRoom *room = room_at(room_index);
+    char forward_msg[BUFFER_SIZE];
+    int len = snprintf(forward_msg, sizeof(forward_msg), "[%s] %s: %s", room->name, sender_username, message);
+    if (len >= (int)sizeof(forward_msg)) len = sizeof(forward_msg) - 1;
+    uint8_t frame[WIRE_FRAME_MAX];
+    size_t frame_len = 0;
+
+    // Le verrou de la salle sérialise les diffusions venant de workers
+    // différents : tous les membres voient les messages dans le même ordre
+    pthread_mutex_lock(&room->lock);
+    if (record) {
+        uint64_t seq = chat_log ? chatlog_append(chat_log, 'R', room->name, sender_username, message) : 0;
+        chatroom_history_add(room, sender_username, message, seq);
+    }
+    if (room->dest_epoch != addr_epoch) refresh_room_dests(room);
+    room->send_errors += fanout_send(dS_udp, forward_msg, len,
+                                     room->dests, room->dest_count, sender_addr);
+    if (room->bin_dest_count || room->rel_dest_count || room->batch_dest_count) {
+        frame_len = build_room_msg_frame(frame, room_index, sender_username, message);
+    }
+    if (room->bin_dest_count) {
+        if (frame_len) {
+            room->send_errors += fanout_send(dS_udp, frame, frame_len,
+                                             room->bin_dests, room->bin_dest_count, sender_addr);
+        } else {
+            room->send_errors += room->bin_dest_count;
+        }
+    }
+    // Membres qui regroupent leurs messages : copie dans l'outbox du worker,
+    // envoyée avec leurs autres messages à la fin du tour de boucle
+    for (int i = 0; i < room->batch_dest_count; i++) {
+        ClientInfo *c = client_at(room->batch_dests[i]);
+        if (sender_addr && c->addr.sin_addr.s_addr == sender_addr->sin_addr.s_addr &&
+            c->addr.sin_port == sender_addr->sin_port) continue;
+        int ok = c->binary ? frame_len && udp_send(&c->addr, sizeof(c->addr), frame, frame_len, true)
+                           : udp_send(&c->addr, sizeof(c->addr), forward_msg, len, true);
+        if (!ok) room->send_errors++;
     }
+    // Membres en mode fiable : une trame (numérotée) par destinataire, dans
+    // le flux de la salle pour ne pas bloquer les autres salles sur une perte
+    for (int i = 0; i < room->rel_dest_count; i++) {
+        ClientInfo *c = client_at(room->rel_dests[i]);
+        if (sender_addr && c->addr.sin_addr.s_addr == sender_addr->sin_addr.s_addr &&
+            c->addr.sin_port == sender_addr->sin_port) continue;
+        int ok = c->binary ? frame_len && send_to_client(room->rel_dests[i], room_index + 1, (char *)frame, frame_len)
+                           : send_to_client(room->rel_dests[i], room_index + 1, forward_msg, len);
+        if (!ok) room->send_errors++;
+    }
+    pthread_mutex_unlock(&room->lock);
+}
 
-    printf("\nFichier %s reçu et sauvegardé (%zu octets)\n", filename, total_received);
-    fclose(file);
+// Message privé de sender vers le client didx, en texte ou en binaire
+// selon ce que le destinataire a demandé au login, journalisé. Retourne 0 si échec
+static int deliver_direct(int didx, const char *sender, const char *content) {
+    if (chat_log) chatlog_append(chat_log, 'D', client_at(didx)->username, sender, content);
+    if (client_at(didx)->binary) {
+        uint8_t frame[WIRE_FRAME_MAX];
+        WireWriter w;
+        wire_begin(&w, frame, sizeof(frame), WOP_DIRECT_MSG);
+        wire_put_str(&w, sender);
+        wire_put_str(&w, content);
+        return !w.overflow && send_to_client(didx, DIRECT_STREAM, (char *)frame, w.len);
+    }
+    char forward[BUFFER_SIZE];
+    snprintf(forward, sizeof(forward), "Message de %s: %s", sender, content);
+    return send_to_client(didx, DIRECT_STREAM, forward, strlen(forward));
+}
 
-    // Envoyer confirmation au client
-    char confirm_msg[] = "FILE_RECEIVED_OK";
-    send(client_socket, confirm_msg, strlen(confirm_msg), 0);
+// Apprend au client binaire uid la poignée de la salle h (dans le flux de
+// la salle : en mode fiable elle arrive avant les messages qui l'utilisent)
+static void send_room_bind(int uid, int h) {
+    if (!client_at(uid)->binary) return;
+    uint8_t frame[WIRE_FRAME_MAX];
+    WireWriter w;
+    wire_begin(&w, frame, sizeof(frame), WOP_ROOM_BIND);
+    wire_put_varint(&w, h);
+    wire_put_varint(&w, room_at(h)->generation);
+    wire_put_str(&w, room_at(h)->name);
+    if (!w.overflow) send_to_client(uid, h + 1, (char *)frame, w.len);
 }
 
-// Fonction pour gérer le téléchargement d'un fichier
-void handle_file_download(int client_socket, const char* filename) {
-    // Enlever les espaces au début du nom de fichier
-    while (*filename == ' ') filename++;
-    
-    // Vérifier que le nom de fichier est valide
-    if (strlen(filename) == 0) {
-        printf("Erreur: Nom de fichier vide\n");
-        char error_msg[] = "FILE_NOT_FOUND";
-        send(client_socket, error_msg, strlen(error_msg), 0);
+// Lignes de texte d'un flux regroupées en blocs de moins de OUTBOX_MTU octets
+typedef struct {
+    int uid;
+    uint32_t stream;
+    size_t len;
+    char bytes[OUTBOX_MTU];
+} TextBlock;
+
+// Envoie le bloc en cours (sans le dernier saut de ligne)
+static void text_block_flush(TextBlock *b) {
+    if (b->len) send_to_client(b->uid, b->stream, b->bytes, b->len - 1);
+    b->len = 0;
+}
+
+static void text_block_add(TextBlock *b, const char *line, size_t len) {
+    if (b->len && b->len + len + 1 > sizeof(b->bytes)) text_block_flush(b);
+    if (len + 1 > sizeof(b->bytes)) {
+        send_to_client(b->uid, b->stream, line, len);
         return;
     }
-    
-    char filepath[512];
-    snprintf(filepath, sizeof(filepath), "uploads/%s", filename);
-    printf("Tentative d'ouverture du fichier : %s\n", filepath);
-    
-    // Vérifier si le fichier existe et est accessible
-    if (access(filepath, F_OK) == -1) {
-        printf("Erreur: Le fichier %s n'existe pas\n", filepath);
-        char error_msg[] = "FILE_NOT_FOUND";
-        send(client_socket, error_msg, strlen(error_msg), 0);
-        return;
+    memcpy(b->bytes + b->len, line, len);
+    b->bytes[b->len + len] = '\n';
+    b->len += len + 1;
+}
+
+// Envoie au client uid la page page (1 = la plus récente) de l'historique en
+// mémoire de la salle h, dans le flux de la salle : trames ROOM_MSG pour un
+// client binaire, sinon lignes de texte regroupées. Retourne le nombre de
+// pages en mémoire (0 si l'historique est vide) et, dans *oldest, le numéro
+// dans le journal du plus ancien message en mémoire ; rien n'est envoyé si
+// la page n'existe pas
+static int send_history(int uid, int h, int page, uint64_t *oldest) {
+    ChatRoom *room = room_at(h);
+    ClientInfo *c = client_at(uid);
+    char record[BUFFER_SIZE], line[BUFFER_SIZE];
+    uint8_t frame[WIRE_FRAME_MAX];
+    TextBlock block = { .uid = uid, .stream = h + 1 };
+    const char *message;
+
+    // Le verrou de la salle fige l'historique et ordonne la relecture
+    // avec les diffusions en cours
+    pthread_mutex_lock(&room->lock);
+    int pages = (room->hist_count + HISTORY_PAGE_SIZE - 1) / HISTORY_PAGE_SIZE;
+    *oldest = chatroom_history_oldest_seq(room);
+    if (page < 1 || page > pages) {
+        pthread_mutex_unlock(&room->lock);
+        return pages;
+    }
+    int end = room->hist_count - (page - 1) * HISTORY_PAGE_SIZE;
+    int start = end > HISTORY_PAGE_SIZE ? end - HISTORY_PAGE_SIZE : 0;
+
+    // Avec le journal, le nombre total de pages n'est pas connu
+    int len = chat_log ? snprintf(line, sizeof(line), "Historique de la salle '%s', page %d :", room->name, page)
+                       : snprintf(line, sizeof(line), "Historique de la salle '%s', page %d/%d :", room->name, page, pages);
+    send_to_client(uid, h + 1, line, len);
+    for (int i = start; i < end; i++) {
+        if (!chatroom_history_get(room, i, record, sizeof(record), &message)) break;
+        if (c->binary) {
+            size_t frame_len = build_room_msg_frame(frame, h, record, message);
+            if (frame_len) send_to_client(uid, h + 1, (char *)frame, frame_len);
+            continue;
+        }
+        len = snprintf(line, sizeof(line), "[%s] %s: %s", room->name, record, message);
+        if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+        text_block_add(&block, line, len);
     }
+    text_block_flush(&block);
+    if (page < pages) {
+        len = snprintf(line, sizeof(line), "Messages précédents : @history %s %d", room->name, page + 1);
+        send_to_client(uid, h + 1, line, len);
+    }
+    pthread_mutex_unlock(&room->lock);
+    return pages;
+}
 
-    // Ouvrir le fichier en lecture
-    FILE* file = fopen(filepath, "rb");
-    if (!file) {
-        printf("Erreur: Impossible d'ouvrir le fichier %s\n", filepath);
-        char error_msg[] = "FILE_OPEN_ERROR";
-        send(client_socket, error_msg, strlen(error_msg), 0);
-        return;
+// Lecture du journal demandée par la commande en cours. Elle n'a lieu
+// qu'après la libération de state_lock (run_archive_request) : parcourir
+// les archives ne bloque ni les autres workers ni les commandes qui
+// modifient l'état
+typedef struct {
+    bool pending;
+    int uid, h, page;
+    int memory_pages;                  // pages de l'historique en mémoire
+    unsigned client_generation, room_generation;
+    uint64_t oldest;                   // seq du plus ancien message en mémoire
+    char room[MAX_ROOM_NAME_LENGTH];
+    bool report;                       // @history : signaler une page absente à reply_to
+    struct sockaddr_in reply_to;
+    socklen_t reply_len;
+} ArchiveRequest;
+
+static __thread ArchiveRequest archive_request;
+
+// Message relu dans le journal, copié pour être envoyé après la lecture
+typedef struct {
+    uint64_t time_us;
+    char sender[50];
+    char text[BUFFER_SIZE];
+} ArchivedMessage;
+
+typedef struct {
+    int count;
+    ArchivedMessage msgs[HISTORY_PAGE_SIZE];
+} ArchivePage;
+
+static void collect_archived(void *ctx, uint64_t time_us, const char *sender,
+                             const char *message, size_t message_len) {
+    ArchivePage *p = ctx;
+    if (!p || p->count == HISTORY_PAGE_SIZE) return;
+    ArchivedMessage *m = &p->msgs[p->count++];
+    m->time_us = time_us;
+    snprintf(m->sender, sizeof(m->sender), "%s", sender);
+    if (message_len >= sizeof(m->text)) message_len = sizeof(m->text) - 1;
+    memcpy(m->text, message, message_len);
+    m->text[message_len] = '\0';
+}
+
+// Exécute la lecture d'archives en attente puis, sous le verrou d'état en
+// lecture, envoie la page si le client et la salle n'ont pas changé entre-temps
+static void run_archive_request(void) {
+    ArchiveRequest *q = &archive_request;
+    if (!q->pending) return;
+    q->pending = false;
+
+    // Page d'archives, ou seulement le compte des messages plus anciens que
+    // la mémoire (sa dernière page : faut-il proposer la suivante ?)
+    int total, skip = 0;
+    ArchivePage *p = NULL;
+    if (q->page > q->memory_pages) {
+        skip = (q->page - q->memory_pages - 1) * HISTORY_PAGE_SIZE;
+        p = malloc(sizeof(ArchivePage));
+        if (!p) return;
+        p->count = 0;
+    }
+    chatlog_read(chat_log, 'R', q->room, q->oldest, skip, p ? HISTORY_PAGE_SIZE : 0, collect_archived, p, &total);
+
+    pthread_rwlock_rdlock(&state_lock);
+    ClientInfo *c = client_at(q->uid);
+    ChatRoom *room = room_at(q->h);
+    if (c->in_use && c->active && c->generation == q->client_generation && room->active &&
+        room->generation == q->room_generation && chatroom_is_member(room, q->uid)) {
+        char line[BUFFER_SIZE];
+        int len;
+        if (p && p->count) {
+            len = snprintf(line, sizeof(line), "Archives de la salle '%s', page %d :", room->name, q->page);
+            send_to_client(q->uid, q->h + 1, line, len);
+            TextBlock block = { .uid = q->uid, .stream = q->h + 1 };
+            for (int i = 0; i < p->count; i++) {
+                ArchivedMessage *m = &p->msgs[i];
+                if (c->binary) {
+                    uint8_t frame[WIRE_FRAME_MAX];
+                    size_t frame_len = build_room_msg_frame(frame, q->h, m->sender, m->text);
+                    if (frame_len) send_to_client(q->uid, q->h + 1, (char *)frame, frame_len);
+                    continue;
+                }
+                char when[32];
+                time_t t = m->time_us / 1000000;
+                struct tm tm;
+                localtime_r(&t, &tm);
+                strftime(when, sizeof(when), "%d/%m %H:%M", &tm);
+                len = snprintf(line, sizeof(line), "[%s] [%s] %s: %s", when, room->name, m->sender, m->text);
+                if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+                text_block_add(&block, line, len);
+            }
+            text_block_flush(&block);
+        }
+        if (p ? p->count && total > skip + HISTORY_PAGE_SIZE : total > 0) {
+            len = snprintf(line, sizeof(line), "Messages précédents : @history %s %d", room->name, q->page + 1);
+            send_to_client(q->uid, q->h + 1, line, len);
+        } else if (p && !p->count && q->report) {
+            int pages = q->memory_pages + (total + HISTORY_PAGE_SIZE - 1) / HISTORY_PAGE_SIZE;
+            if (pages == 0) {
+                len = snprintf(line, sizeof(line), "Aucun message dans l'historique de la salle '%s'.", room->name);
+            } else {
+                len = snprintf(line, sizeof(line), "Erreur: La salle '%s' n'a que %d page(s) d'historique.", room->name, pages);
+            }
+            reply(&q->reply_to, q->reply_len, line, len);
+        }
     }
+    pthread_rwlock_unlock(&state_lock);
+    free(p);
+}
 
-    // Obtenir la taille du fichier
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+// Envoie la page page (1 = la plus récente) de l'historique de la salle h :
+// d'abord l'historique en mémoire, puis, au-delà, les messages plus anciens
+// lus dans le journal après la commande (run_archive_request ; report_to,
+// si non NULL, y reçoit l'erreur d'une page absente). Retourne 1 si la page
+// a été envoyée ou confiée au journal, sinon 0 et *pages : le nombre de
+// pages existantes
+static int send_history_page(int uid, int h, int page, int *pages,
+                             const struct sockaddr_in *report_to, socklen_t report_len) {
+    uint64_t oldest;
+    int memory_pages = send_history(uid, h, page, &oldest);
+    *pages = memory_pages;
+    // Seule la dernière page en mémoire consulte le journal : en a-t-il de plus anciens ?
+    if (page < memory_pages || !chat_log) return page <= memory_pages;
+
+    ArchiveRequest *q = &archive_request;
+    *q = (ArchiveRequest){ .pending = true, .uid = uid, .h = h, .page = page, .memory_pages = memory_pages,
+                           .client_generation = client_at(uid)->generation,
+                           .room_generation = room_at(h)->generation, .oldest = oldest };
+    snprintf(q->room, sizeof(q->room), "%s", room_at(h)->name);
+    if (report_to) {
+        q->report = true;
+        q->reply_to = *report_to;
+        q->reply_len = report_len;
+    }
+    return 1;
+}
 
-    printf("Envoi du fichier %s (taille: %ld octets)\n", filename, file_size);
+// Apprend au client binaire uid la poignée de l'utilisateur target
+static void send_user_bind(int uid, int target) {
+    uint8_t frame[WIRE_FRAME_MAX];
+    WireWriter w;
+    wire_begin(&w, frame, sizeof(frame), WOP_USER_BIND);
+    wire_put_varint(&w, target);
+    wire_put_varint(&w, client_at(target)->generation);
+    wire_put_str(&w, client_at(target)->username);
+    if (!w.overflow) send_to_client(uid, DIRECT_STREAM, (char *)frame, w.len);
+}
 
-    // Envoyer un message de succès avant le contenu du fichier
-    char success_msg[] = "FILE_SEND_START";
-    send(client_socket, success_msg, strlen(success_msg), 0);
+// Réponse binaire (code WST_*, texte) à l'expéditeur d'une trame
+static void send_status(struct sockaddr_in *to, socklen_t lg, int code, const char *text) {
+    uint8_t frame[WIRE_FRAME_MAX];
+    WireWriter w;
+    wire_begin(&w, frame, sizeof(frame), WOP_STATUS);
+    wire_put_varint(&w, code);
+    wire_put_str(&w, text);
+    if (!w.overflow) reply(to, lg, frame, w.len);
+}
 
-    // Petit délai pour s'assurer que le client est prêt
-    usleep(100000);  // 100ms
+// Retourne l'index d'un client à partir de son adresse, ou -1 sinon
+int find_client_index(struct sockaddr_in *addr) {
+    int i = addrindex_get(addr_index, addr);
+    return (i >= 0 && client_at(i)->active) ? i : -1;
+}
 
-    // Envoyer le contenu du fichier
-    char buffer[FILE_BUFFER_SIZE];
-    size_t bytes_read;
-    long total_sent = 0;
+// Attribue une case du registre au compte username (session inactive)
+static int acquire_client_slot(const char *username) {
+    int uid = clients_alloc(clients);
+    if (uid < 0) return -1;
+    strncpy(client_at(uid)->username, username, sizeof(client_at(uid)->username)-1);
+    nameindex_put(name_index, client_at(uid)->username, uid);
+    return uid;
+}
 
-    while ((bytes_read = fread(buffer, 1, FILE_BUFFER_SIZE, file)) > 0) {
-        if (send(client_socket, buffer, bytes_read, 0) < 0) {
-            printf("Erreur lors de l'envoi du fichier\n");
-            break;
-        }
-        total_sent += bytes_read;
-        printf("Progression: %ld/%ld octets envoyés\r", total_sent, file_size);
-        fflush(stdout);
+// Termine la session du client uid ; sa case est recyclée s'il n'est
+// membre d'aucune salle (sinon elle reste réservée à son appartenance)
+static void end_client_session(int uid) {
+    ClientInfo *c = client_at(uid);
+    if (c->active) {
+        addrindex_remove(addr_index, &c->addr);
+        timerwheel_cancel(&c->timer);
+        drop_reliable_peer(c);
+        c->binary = 0;
+        c->batch = 0;
+        c->active = 0;
+        addr_epoch++;
+    }
+    if (c->room_count == 0) {
+        nameindex_remove(name_index, c->username);
+        clients_release(clients, uid);
     }
-
-    printf("\nFichier %s envoyé (%ld octets)\n", filename, total_sent);
-    fclose(file);
 }
 
-// Fonction pour gérer les transferts de fichiers
-void handle_file_transfers(int tcp_socket) {
-    while (running) {
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
+// Attache la session du client uid à l'adresse addr (login ou re-login
+// depuis un nouveau port) en maintenant l'index des adresses à jour
+static void bind_client_session(int uid, struct sockaddr_in *addr) {
+    // Ancienne adresse du client
+    if (client_at(uid)->active) addrindex_remove(addr_index, &client_at(uid)->addr);
+
+    // Un autre compte connecté depuis cette adresse perd sa session
+    int prev = find_client_index(addr);
+    if (prev >= 0 && prev != uid) end_client_session(prev);
+
+    client_at(uid)->addr   = *addr;
+    client_at(uid)->active = 1;
+    addrindex_put(addr_index, addr, uid);
+    addr_epoch++;
+
+    // Un nouveau login repart de zéro côté couche fiable
+    drop_reliable_peer(client_at(uid));
+
+    // (Ré)armement du minuteur d'inactivité
+    client_at(uid)->last_seen = now_tick();
+    client_at(uid)->timer.id = uid;
+    timerwheel_schedule(&session_timers, &client_at(uid)->timer,
+                        client_at(uid)->last_seen + SESSION_TIMEOUT);
+}
 
-        printf("En attente de connexion TCP...\n");
-        int client_socket = accept(tcp_socket, (struct sockaddr*)&client_addr, &client_len);
-        if (client_socket < 0) {
-            perror("accept");
-            continue;
-        }
+// Active la couche fiable pour la session du client uid (option du login),
+// dans une nouvelle époque
+static void enable_reliable_peer(int uid) {
+    ClientInfo *c = client_at(uid);
+    if (++rel_epoch_last == 0) rel_epoch_last = 1;
+    c->rel = rel_create(rel_epoch_last);
+    if (c->rel) c->rel->timer.id = uid;
+}
 
-        char command[BUFFER_SIZE];
-        ssize_t recv_size = recv(client_socket, command, BUFFER_SIZE - 1, 0);
-        if (recv_size > 0) {
-            command[recv_size] = '\0';
-            printf("Commande reçue : %s\n", command);
-            
-            if (strncmp(command, UPLOAD_CMD, strlen(UPLOAD_CMD)) == 0) {
-                handle_file_upload(client_socket, command);
-            } 
-            else if (strncmp(command, DOWNLOAD_CMD, strlen(DOWNLOAD_CMD)) == 0) {
-                char* filename = command + strlen(DOWNLOAD_CMD) + 1;
-                handle_file_download(client_socket, filename);
-            }
-        }
+// Annonce au client son époque fiable (0 : pas de couche fiable), pour qu'il
+// reparte de zéro s'il en avait une autre
+static void announce_rel_epoch(const struct sockaddr_in *to, socklen_t lg, const RelPeer *rel) {
+    char frame[REL_HEADER_MAX];
+    size_t len = rel_epoch_frame(frame, sizeof(frame), rel ? rel->epoch : 0);
+    reply(to, lg, frame, len);
+}
 
-        close(client_socket);
+// Expire une session silencieuse : le client quitte toutes ses salles
+// (les diffusions ne lui sont plus envoyées) et sa case est rendue
+static void expire_client_session(int uid) {
+    ClientInfo *c = client_at(uid);
+    printf("Session de %s expirée (inactivité)\n", c->username);
+    while (c->room_count > 0) {
+        int h = c->joined_rooms[c->room_count - 1];
+        chatroom_remove_member(room_at(h), uid);
+        client_remove_room(c, h);
+        if (state_wal) wal_append(state_wal, "L:%s:%s", room_at(h)->name, c->username);
+
+        char notification[BUFFER_SIZE];
+        snprintf(notification, sizeof(notification), "%s a quitté la salle (inactivité).", c->username);
+        broadcast_to_room(h, notification, "Serveur", &c->addr, false);
     }
+    end_client_session(uid);
 }
 
-// Diffuse un message à tous les membres d'une salle (sauf expéditeur)
-void broadcast_to_room(int room_index, const char *message, const char *sender_username, struct sockaddr_in *sender_addr) {
-    if (room_index < 0 || room_index >= room_count || !rooms[room_index]) return;
-    ChatRoom *room = rooms[room_index];
-    char forward_msg[BUFFER_SIZE];
-    sprintf(forward_msg, "[%s] %s: %s", room->name, sender_username, message);
-
-    for (int i = 0; i < room->member_count; i++) {
-        int member = room->member_indices[i];
-        if (clients[member].active &&
-            (sender_addr == NULL ||
-             clients[member].addr.sin_addr.s_addr != sender_addr->sin_addr.s_addr ||
-             clients[member].addr.sin_port        != sender_addr->sin_port)) {
-            if (sendto(dS_udp, forward_msg, strlen(forward_msg), 0,
-                       (struct sockaddr*)&clients[member].addr,
-                       sizeof(clients[member].addr)) < 0) {
-                perror("Erreur envoi message à un membre");
-            }
-        }
+// Échéance du minuteur d'un client : s'il s'est manifesté depuis
+// l'armement, on reporte l'échéance, sinon la session expire
+static void on_session_timer(TimerNode *node, void *arg) {
+    uint64_t now = *(uint64_t *)arg;
+    ClientInfo *c = client_at(node->id);
+    if (now < c->last_seen + SESSION_TIMEOUT) {
+        timerwheel_schedule(&session_timers, node, c->last_seen + SESSION_TIMEOUT);
+    } else {
+        expire_client_session(node->id);
     }
 }
 
-// Retourne l'index d'un client à partir de son adresse, ou -1 sinon
-int find_client_index(struct sockaddr_in *addr) {
-    for (int i = 0; i < client_count; i++) {
-        if (clients[i].active &&
-            clients[i].addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
-            clients[i].addr.sin_port        == addr->sin_port) {
-            return i;
-        }
+// Fait avancer les minuteurs de session jusqu'à maintenant (worker 0)
+static void expire_idle_sessions(void) {
+    uint64_t now = now_tick();
+    // Seul le worker 0 modifie session_timers.now : lecture sans verrou
+    if (now <= session_timers.now) return;
+    pthread_rwlock_wrlock(&state_lock);
+    timerwheel_advance(&session_timers, now, on_session_timer, &now);
+    pthread_rwlock_unlock(&state_lock);
+}
+
+// Supprime une salle : ses membres la quittent, son nom et son numéro
+// redeviennent disponibles pour de nouvelles salles
+static void delete_room(int h) {
+    ChatRoom *room = room_at(h);
+    for (int i = 0; i < room->member_count; i++) {
+        if (!room_member_is_current(room, i)) continue;
+        int uid = room->member_indices[i];
+        client_remove_room(client_at(uid), h);
+        // Un membre hors ligne qui n'est plus dans aucune salle libère sa case
+        if (!client_at(uid)->active) end_client_session(uid);
     }
-    return -1;
+    nameindex_remove(room_names, room->name);
+    rooms_release(rooms, h);
 }
 
 // Trouve l'index d'une salle par son nom, ou -1 si absente
 int find_room_by_name(const char *room_name) {
-    const char *idx = dict_get(room_dict, room_name);
-    return idx ? atoi(idx) : -1;
+    return nameindex_get(room_names, room_name);
 }
 
 /**
@@ -274,59 +722,57 @@ int find_room_by_name(const char *room_name) {
  * Retourne -1 si introuvable.
  */
 static int find_user_index_by_name(const char *username) {
-    for (int i = 0; i < client_count; i++) {
-        if (strcmp(clients[i].username, username) == 0) {
-            return i;
-        }
-    }
-    return -1;
+    return nameindex_get(name_index, username);
 }
 
 /**
- * Sauvegarde les salles et leurs membres.
- * Format de chaque ligne :
- *   room_id:room_name:max_members:user1,user2,...
+ * Écrit l'instantané binaire de l'état (snapshot.h) : les comptes dans
+ * l'ordre de users_dict, puis les salles avec leurs membres sous forme de
+ * numéros de compte. Retourne 0 si erreur (l'ancien fichier est conservé)
  */
-void save_rooms_to_file(const char* filename) {
-    FILE* f = fopen(filename, "w");
-    if (!f) { perror("Error opening rooms file"); return; }
-
-    for (int id = 0; id < room_count; id++) {
-        ChatRoom *r = rooms[id];
-        if (!r || !r->active) continue;
-
-        // 1) room_id:room_name:max_members:
-        fprintf(f, "%d:%s:%d:", id, r->name, r->max_members);
+int save_state_snapshot(const char *filename) {
+    SnapWriter w;
+    snapwriter_init(&w);
+    snapwriter_reserve(&w, users_dict->count, users_dict->count * (KDF_RECORD_MAX - 32));
+    // Le numéro d'un compte est sa position dans users_dict
+    for (size_t i = 0; i < users_dict->count; i++) {
+        snapwriter_add_user(&w, users_dict->entries[i].key, users_dict->entries[i].value);
+    }
 
-        // 2) liste des membres par username, séparés par des virgules
+    uint32_t *members = NULL;
+    int members_capacity = 0;
+    for (int id = 0; id < rooms->high_water; id++) {
+        ChatRoom *r = room_at(id);
+        if (!r->active) continue;
+        if (r->member_count > members_capacity) {
+            uint32_t *grown = realloc(members, r->member_count * sizeof(uint32_t));
+            if (!grown) {
+                w.error = 1;
+                break;
+            }
+            members = grown;
+            members_capacity = r->member_count;
+        }
+        uint32_t count = 0;
         for (int j = 0; j < r->member_count; j++) {
-            int uid = r->member_indices[j];
-            fprintf(f, "%s", clients[uid].username);
-            if (j + 1 < r->member_count) fputc(',', f);
+            if (!room_member_is_current(r, j)) continue;
+            long user = dict_index_of(users_dict, client_at(r->member_indices[j])->username);
+            if (user >= 0) members[count++] = (uint32_t)user;
         }
-
-        fputc('\n', f);
+        snapwriter_add_room(&w, r->name, r->owner, r->max_members, members, count);
     }
+    free(members);
 
-    fclose(f);
-    printf("Rooms saved to %s\n", filename);
-}
-
-// Sauvegarde les utilisateurs (index:username:password) dans un fichier
-void save_users_to_file(const char* filename) {
-    FILE* f = fopen(filename, "w");
-    if (!f) { perror("Error opening users file"); return; }
-    for (int i = 0; i < client_count; i++) {
-        const char *pwd = dict_get(users_dict, clients[i].username);
-        if (!pwd) pwd = "";  // Sécurité
-        // On écrit id:username:password
-        fprintf(f, "%d:%s:%s\n", i, clients[i].username, pwd);
-    }
-    fclose(f);
-    printf("Users saved to %s\n", filename);
+    int ok = snapwriter_commit(&w, filename);
+    if (ok) printf("État sauvegardé dans %s (%u compte(s), %u salle(s))\n", filename, w.user_count, w.room_count);
+    snapwriter_free(&w);
+    return ok;
 }
 
-// Charge les utilisateurs depuis un fichier (index:username:password)
+// Charge les utilisateurs depuis un fichier texte (index:username:password),
+// ancien format de sauvegarde remplacé par l'instantané binaire
+// Les comptes ne reçoivent une case client qu'à la connexion (ou s'ils
+// sont membres d'une salle restaurée) : l'index du fichier est ignoré
 void load_users_from_file(const char* filename) {
     FILE* f = fopen(filename, "r");
     if (!f) { 
@@ -334,30 +780,51 @@ void load_users_from_file(const char* filename) {
         return; 
     }
     char line[512];
-    int max_id = -1;
+    int loaded = 0;
     while (fgets(line, sizeof(line), f)) {
         int id;
-        char username[50], password[50];
-        // On attend dorénavant trois champs séparés par ':'
-        if (sscanf(line, "%d:%49[^:]:%49s", &id, username, password) == 3 && id < MAX_USERS) {
-            if (id > max_id) max_id = id;
+        char username[50], password[KDF_RECORD_MAX];
+        // On attend dorénavant trois champs séparés par ':' (mot de passe
+        // en clair des anciens fichiers, ou empreinte kdf.h)
+        if (sscanf(line, "%d:%49[^:]:%159s", &id, username, password) == 3) {
             // On stocke username -> password
             dict_insert(users_dict, username, password);
-            // On initialise le client en inactif
-            strncpy(clients[id].username, username, sizeof(clients[id].username)-1);
-            clients[id].active = 0;
-            clients[id].room_count = 0;
+            loaded++;
         }
     }
-    client_count = max_id + 1;
     fclose(f);
-    printf("Loaded %d users from %s\n", client_count, filename);
+    printf("Loaded %d users from %s\n", loaded, filename);
+}
+
+// Recrée la salle name (instantané ou WAL), -1 si elle existe déjà ou si erreur
+static int restore_room(const char *name, int max_members, const char *owner) {
+    if (max_members <= 0 || find_room_by_name(name) >= 0) return -1;
+    if (max_members > MAX_ROOM_MEMBERS) max_members = MAX_ROOM_MEMBERS; // salle d'avant le plafond
+    int h = rooms_alloc(rooms, name, max_members);
+    if (h < 0) return -1;
+    ChatRoom *r = room_at(h);
+    chatroom_history_init(r, ROOM_HISTORY_MESSAGES, ROOM_HISTORY_BYTES);
+    if (owner) strncpy(r->owner, owner, sizeof(r->owner)-1);
+    nameindex_put(room_names, r->name, h);
+    return h;
+}
+
+// Réinscrit le compte username dans la salle h (instantané ou WAL)
+static void restore_member(int h, const char *username) {
+    ChatRoom *r = room_at(h);
+    int uid = find_user_index_by_name(username);
+    if (uid < 0 && dict_get(users_dict, username)) uid = acquire_client_slot(username);
+    if (uid < 0 || chatroom_is_member(r, uid)) return;
+    if (chatroom_add_member(r, uid, client_at(uid)->generation) && !client_add_room(client_at(uid), h)) {
+        chatroom_remove_member(r, uid);
+    }
 }
 
 /**
  * Charge les salles et leurs membres depuis le fichier.
  * S'attend à chaque ligne au format :
- *   room_id:room_name:max_members:user1,user2,...
+ *   room_id:room_name:max_members:user1,user2,...[:owner]
+ * Le room_id du fichier est ignoré : la salle reçoit un numéro du registre
  */
 void load_rooms_from_file(const char* filename) {
     FILE* f = fopen(filename, "r");
@@ -367,13 +834,12 @@ void load_rooms_from_file(const char* filename) {
     }
 
     char line[1024];
-    room_count = 0;
 
     while (fgets(line, sizeof(line), f)) {
         // Découpe des parties
-        // On lit d'abord le room_id
-        int id, maxm;
-        char room_name[MAX_ROOM_NAME_LENGTH];
+        // On saute d'abord le room_id
+        int maxm;
+        char room_name[MAX_ROOM_NAME_LENGTH] = {0};
         char *members_list;
 
         // On supprime le '\n'
@@ -384,7 +850,6 @@ void load_rooms_from_file(const char* filename) {
         char *p1 = strchr(line, ':');
         if (!p1) continue;
         *p1 = '\0';
-        id = atoi(line);
 
         char *p2 = strchr(p1+1, ':');
         if (!p2) continue;
@@ -396,667 +861,1476 @@ void load_rooms_from_file(const char* filename) {
         *p3 = '\0';
         maxm = atoi(p2+1);
 
-        // La suite, après le troisième ':', est la liste des membres
+        // La suite, après le troisième ':', est la liste des membres,
+        // éventuellement suivie de ':' et du créateur
         members_list = p3+1;
+        char *p4 = strchr(members_list, ':');
+        if (p4) *p4 = '\0';
 
-        // Créer la salle à l'index spécifié
-        ChatRoom *r = chatroom_create(room_name, maxm);
-        if (!r) continue;
-        rooms[id] = r;
-        if (id >= room_count) room_count = id + 1;
-
-        // Mettre à jour le dictionnaire
-        char idx_str[16];
-        snprintf(idx_str, sizeof(idx_str), "%d", id);
-        dict_insert(room_dict, room_name, idx_str);
+        // Créer la salle dans le registre
+        int h = restore_room(room_name, maxm, p4 ? p4+1 : NULL);
+        if (h < 0) continue;
 
         // Parcourir les membres listés
         char *tok = strtok(members_list, ",");
         while (tok) {
-            int uid = find_user_index_by_name(tok);
-            if (uid >= 0) {
-                chatroom_add_member(r, uid);
-                clients[uid].joined_rooms[clients[uid].room_count++] = id;
-            }
+            restore_member(h, tok);
             tok = strtok(NULL, ",");
         }
     }
 
     fclose(f);
-    printf("Loaded %d rooms from %s\n", room_count, filename);
+    printf("Loaded %d rooms from %s\n", rooms->used, filename);
+}
+
+/**
+ * Charge l'instantané binaire filename, projeté en mémoire : comptes puis
+ * salles et membres, sans analyse de texte. Retourne 1 si chargé, 0 si le
+ * fichier n'existe pas ; un instantané invalide arrête le serveur plutôt
+ * que de repartir d'un état vide
+ */
+int load_state_snapshot(const char *filename) {
+    Snapshot snap;
+    int status = snapshot_open(&snap, filename);
+    if (status == 0) return 0;
+    if (status < 0) {
+        fprintf(stderr, "Erreur: instantané '%s' illisible, arrêt (déplacez-le pour repartir de users.txt/rooms.txt)\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    const SnapHeader *h = snap.header;
+    dict_reserve(users_dict, users_dict->count + h->user_count);
+    for (uint32_t i = 0; i < h->user_count; i++) {
+        dict_insert(users_dict, snapshot_str(&snap, snap.users[i].name), snapshot_str(&snap, snap.users[i].password));
+    }
+    for (uint32_t i = 0; i < h->room_count; i++) {
+        const SnapRoom *sr = &snap.rooms[i];
+        int room = restore_room(snapshot_str(&snap, sr->name), sr->max_members, snapshot_str(&snap, sr->owner));
+        if (room < 0) continue;
+        for (uint32_t j = 0; j < sr->member_count; j++) {
+            restore_member(room, snapshot_str(&snap, snap.users[snap.members[sr->members + j]].name));
+        }
+    }
+    printf("Loaded %u users and %u rooms from %s\n", h->user_count, h->room_count, filename);
+    snapshot_close(&snap);
+    return 1;
+}
+
+// Nom d'utilisateur ou de salle utilisable dans les enregistrements du WAL
+// et de users.txt/rooms.txt : ni séparateur de champ (':'), ni de liste
+// (','), ni caractère de contrôle (fin de ligne)
+static bool valid_record_name(const char *name) {
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        if (*p == ':' || *p == ',' || *p < 0x20 || *p == 0x7f) return false;
+    }
+    return name[0] != '\0';
+}
+
+/*
+ * Enregistrements du WAL (wal.h), tous idempotents :
+ *   U:utilisateur:mot_de_passe     compte créé
+ *   C:salle:max_membres:créateur   salle créée
+ *   J:salle:utilisateur            membre ajouté
+ *   L:salle:utilisateur            membre retiré
+ *   D:salle                        salle supprimée
+ * Rejoue un enregistrement au démarrage, par-dessus l'instantané
+ */
+static void apply_wal_record(void *ctx, char *record) {
+    (void)ctx;
+    char *field[5] = { NULL };
+    int n = 0;
+    for (char *p = record; p && n < 5; n++) {
+        field[n] = p;
+        p = strchr(p, ':');
+        if (p) *p++ = '\0';
+    }
+
+    // Nombre exact de champs : un enregistrement qui en a trop (nom contenant
+    // ':' écrit par une version antérieure) est ignoré, pas réinterprété
+    int expected = 0;
+    switch (record[0]) {
+    case 'U': case 'J': case 'L': expected = 3; break;
+    case 'C': expected = 4; break;
+    case 'D': expected = 2; break;
+    }
+    if (n != expected || field[0][1] != '\0') {
+        printf("WAL : enregistrement ignoré (%s, %d champs)\n", field[0], n);
+        return;
+    }
+
+    int h = find_room_by_name(field[1]);
+    switch (record[0]) {
+    case 'U':
+        dict_insert(users_dict, field[1], field[2]);
+        break;
+    case 'C':
+        restore_room(field[1], atoi(field[2]), field[3]);
+        break;
+    case 'J':
+        if (h >= 0) restore_member(h, field[2]);
+        break;
+    case 'L':
+        if (h >= 0) {
+            int uid = find_user_index_by_name(field[2]);
+            if (uid >= 0 && chatroom_is_member(room_at(h), uid)) {
+                chatroom_remove_member(room_at(h), uid);
+                client_remove_room(client_at(uid), h);
+                end_client_session(uid);   // libère la case s'il n'est plus dans aucune salle
+            }
+        }
+        break;
+    case 'D':
+        if (h >= 0) delete_room(h);
+        break;
+    }
+}
+
+// Point de reprise (thread d'écriture du WAL, ou main à l'arrêt) : le verrou
+// d'état en lecture empêche toute modification pendant l'écriture de
+// l'instantané, le WAL est vidé une fois l'instantané durable
+static void checkpoint_state(void *ctx) {
+    (void)ctx;
+    pthread_rwlock_rdlock(&state_lock);
+    if (save_state_snapshot(STATE_SNAPSHOT_FILE) && state_wal) {
+        wal_reset(state_wal);
+    }
+    pthread_rwlock_unlock(&state_lock);
 }
 
-// Gestionnaire de signal : sauvegarde et cleanup, puis exit
+// Gestionnaire de signal : demande l'arrêt des workers, main sauvegarde et libère
 void handle_signal(int sig) {
     printf("\nFermeture du serveur (signal %d)...\n", sig);
-    save_users_to_file("users.txt");
-    save_rooms_to_file("rooms.txt");
-    for (int i = 0; i < room_count; i++) chatroom_free(rooms[i]);
-    dict_free(users_dict);
-    dict_free(room_dict);
-    free(clients);
-    close(dS_udp);
-    close(dS_tcp);
-    exit(EXIT_SUCCESS);
+    running = 0;
 }
 
-int main(int argc, char *argv[]) {
-    printf("Début programme serveur\n");
-
-    // Configuration du gestionnaire de signaux
-    signal(SIGINT,  handle_signal);
-    signal(SIGTERM, handle_signal);
+// @heartbeat : maintien de session, pas de réponse (ni de trace) si elle est ouverte
+static void cmd_heartbeat(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    (void)args;
+    if (idx < 0 || !client_at(idx)->active) {
+        const char *err = "Erreur: Session expirée, reconnectez-vous avec @login <username> <password>";
+        reply(&aE, lgA, err, strlen(err));
+    }
+}
 
-    // Création du dossier uploads s'il n'existe pas
-    mkdir("uploads", 0777);
-    mkdir("downloads", 0777);
+// Connexion en cours : copiée hors du datagramme pour que le mot de passe
+// soit vérifié sans verrou (pool d'authentification), puis terminée sous
+// le verrou d'état en écriture
+typedef struct {
+    char user[sizeof(((ClientInfo *)0)->username)];
+    char pass[KDF_PASSWORD_MAX];
+    char stored[KDF_RECORD_MAX];   // Enregistrement lu à la demande ("" : nouveau compte)
+    char fresh[KDF_RECORD_MAX];    // Empreinte à enregistrer ("" : aucune)
+    bool reliable, binary, batch;  // Options du login
+    bool ok;                       // Mot de passe vérifié (ou empreinte calculée)
+    struct sockaddr_in addr;
+    socklen_t addr_len;
+    int sock;                      // Socket du worker qui a reçu la demande
+} LoginJob;
+
+// Partie coûteuse : dérivation PBKDF2 du mot de passe (aucun état partagé)
+static void verify_login(LoginJob *job) {
+    if (job->stored[0]) {
+        job->ok = kdf_verify_password(job->stored, job->pass);
+        // Ancien mot de passe en clair (users.txt) : remplacé par son empreinte
+        if (job->ok && !kdf_is_hashed(job->stored) &&
+            !kdf_hash_password(job->pass, KDF_ITERATIONS, job->fresh, sizeof(job->fresh))) {
+            job->fresh[0] = '\0';
+        }
+    } else {
+        job->ok = kdf_hash_password(job->pass, KDF_ITERATIONS, job->fresh, sizeof(job->fresh));
+    }
+    explicit_bzero(job->pass, sizeof(job->pass));
+}
 
-    // Création de la socket UDP
-    dS_udp = socket(PF_INET, SOCK_DGRAM, 0);
-    if (dS_udp == -1) {
-        perror("Erreur création socket UDP");
-        exit(EXIT_FAILURE);
+// Termine la connexion vérifiée : enregistrement éventuel du compte puis
+// ouverture de la session (l'appelant détient state_lock en écriture)
+static void complete_login(LoginJob *job) {
+    struct sockaddr_in *aE = &job->addr;
+    socklen_t lgA = job->addr_len;
+    bool created = job->stored[0] == '\0';
+
+    if (!job->ok) {
+        if (created) {
+            const char *err = "Erreur: Enregistrement impossible, réessayez plus tard.";
+            reply(aE, lgA, err, strlen(err));
+        } else {
+            const char *err  = "Erreur: Mot de passe incorrect.";
+            reply(aE, lgA, err, strlen(err));
+            const char *hint = "Veuillez retaper : @login <username> <password>";
+            reply(aE, lgA, hint, strlen(hint));
+        }
+        return;
     }
-    printf("Socket UDP Créée\n");
 
-    // Création et configuration de la socket TCP
-    dS_tcp = setup_tcp_socket();
-    if (dS_tcp == -1) {
-        close(dS_udp);
-        exit(EXIT_FAILURE);
+    // Le compte a pu être créé par une autre demande pendant la vérification
+    const char *stored = dict_get(users_dict, job->user);
+    if (created && stored) {
+        const char *err = "Erreur: Ce nom vient d'être enregistré, reconnectez-vous avec @login <username> <password>";
+        reply(aE, lgA, err, strlen(err));
+        return;
     }
-    printf("Socket TCP Créée et configurée sur le port %d\n", TCP_PORT);
 
-    // Configuration de l'adresse locale pour UDP
-    struct sockaddr_in aL;
-    memset(&aL, 0, sizeof(aL));
-    aL.sin_family = AF_INET;
-    aL.sin_addr.s_addr = INADDR_ANY;
-    aL.sin_port = htons(serverPort);
+    int uid = find_user_index_by_name(job->user);
+    if (uid < 0) {
+        // Nouveau compte, ou chargé depuis l'instantané mais pas encore dans le registre
+        uid = acquire_client_slot(job->user);
+        if (uid < 0) {
+            const char *err = "Erreur: Serveur saturé, réessayez plus tard.";
+            reply(aE, lgA, err, strlen(err));
+            return;
+        }
+    }
 
-    // Nommage de la socket UDP uniquement
-    if (bind(dS_udp, (struct sockaddr*) &aL, sizeof(aL)) < 0) {
-        perror("Erreur nommage socket UDP");
-        close(dS_udp);
-        close(dS_tcp);
-        exit(EXIT_FAILURE);
+    // Empreinte du nouveau compte, ou remplaçant un mot de passe en clair
+    // (sauf si une autre connexion l'a déjà remplacé entre-temps)
+    if (job->fresh[0] && (created || (stored && strcmp(stored, job->stored) == 0))) {
+        dict_insert(users_dict, job->user, job->fresh);
+        if (state_wal) wal_append(state_wal, "U:%s:%s", job->user, job->fresh);
     }
-    printf("Socket UDP bindée sur port %d\n", serverPort);
 
-    // Initialisation des structures
-    users_dict = dict_create();
-    dict_insert(users_dict, "admin", "admin");
-    room_dict = dict_create();
-    clients = calloc(MAX_USERS, sizeof(ClientInfo));
-    for (int i = 0; i < MAX_USERS; i++) {
-        clients[i].active = 0;
-        clients[i].room_count = 0;
+    bind_client_session(uid, aE);
+    if (job->reliable) enable_reliable_peer(uid);
+    client_at(uid)->binary = job->binary;
+    client_at(uid)->batch = job->batch;
+    announce_rel_epoch(aE, lgA, client_at(uid)->rel);
+
+    char resp[BUFFER_SIZE];
+    snprintf(resp, sizeof(resp), created ? "Bienvenue %s! Enregistré et connecté." : "Bienvenue %s! Vous êtes connecté.", job->user);
+    reply(aE, lgA, resp, strlen(resp));
+
+    // Un client binaire apprend les poignées des salles dont il est déjà membre
+    for (int i = 0; i < client_at(uid)->room_count; i++) {
+        send_room_bind(uid, client_at(uid)->joined_rooms[i]);
     }
+}
 
-    // Chargement des utilisateurs et des salles
-    load_users_from_file("users.txt");
-    load_rooms_from_file("rooms.txt");
+// Sans pool (-a 0) : connexion à vérifier par le worker lui-même, une fois
+// le verrou d'état (en lecture pour @login) relâché (run_pending_login)
+static __thread LoginJob *pending_login;
+
+// Tâche du pool d'authentification : vérification sans verrou, puis fin de
+// la connexion sous le verrou d'état. Les réponses partent par la socket
+// du worker qui a reçu la demande
+static void run_login_job(void *arg) {
+    LoginJob *job = arg;
+    verify_login(job);
+    dS_udp = job->sock;
+    pthread_rwlock_wrlock(&state_lock);
+    complete_login(job);
+    pthread_rwlock_unlock(&state_lock);
+    free(job);
+}
 
-    // Créer un processus fils pour gérer les transferts de fichiers
-    pid_t pid = fork();
-    if (pid == 0) {
-        // Processus fils : gère les transferts de fichiers
-        close(dS_udp);  // Le fils n'a pas besoin de la socket UDP
-        handle_file_transfers(dS_tcp);
-        exit(0);
+static void run_pending_login(void) {
+    LoginJob *job = pending_login;
+    pending_login = NULL;
+    if (job) run_login_job(job);
+}
+
+// @login : authentifie (ou enregistre) l'utilisateur et ouvre sa session.
+// La vérification du mot de passe est confiée au pool d'authentification,
+// le client reçoit la réponse quand elle est terminée. Le gestionnaire ne
+// fait que lire l'état (verrou en lecture) : seule complete_login le
+// modifie, sous le verrou en écriture
+static void cmd_login(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    (void)idx;
+    // Extraction du nom d'utilisateur et du mot de passe. Plusieurs logins
+    // s'analysent en même temps (verrou en lecture) : strtok_r, dont l'état
+    // reste local, et non strtok et son état global
+    char *save;
+    char *user = strtok_r(args, " ", &save);
+    char *pass = strtok_r(NULL, " ", &save);
+    // Options éventuelles après le mot de passe (+rel, +bin, +batch)
+    bool reliable = false, binary = false, batch = false;
+    for (char *opt = strtok_r(NULL, " ", &save); opt; opt = strtok_r(NULL, " ", &save)) {
+        if (strcmp(opt, RELIABLE_OPT) == 0) reliable = true;
+        else if (strcmp(opt, BINARY_OPT) == 0) binary = true;
+        else if (strcmp(opt, BATCH_OPT) == 0) batch = true;
     }
-    else if (pid < 0) {
-        perror("Erreur fork");
-        close(dS_udp);
-        close(dS_tcp);
-        exit(EXIT_FAILURE);
+    if (!user || !pass) {
+        const char *err = "Erreur: Veuillez fournir nom d'utilisateur et mot de passe.";
+        reply(&aE, lgA, err, strlen(err));
+        return;
+    }
+    if (strlen(user) >= sizeof(((ClientInfo *)0)->username)) {
+        const char *err = "Erreur: Nom d'utilisateur trop long.";
+        reply(&aE, lgA, err, strlen(err));
+        return;
+    }
+    if (!valid_record_name(user)) {
+        const char *err = "Erreur: Le nom d'utilisateur ne doit contenir ni ':' ni ','.";
+        reply(&aE, lgA, err, strlen(err));
+        return;
+    }
+    if (strlen(pass) >= KDF_PASSWORD_MAX) {
+        const char *err = "Erreur: Mot de passe trop long.";
+        reply(&aE, lgA, err, strlen(err));
+        return;
     }
-    
-    printf("Serveur prêt, en attente de messages...\n");
 
-    // Boucle principale
-    char buffer[BUFFER_SIZE];
-    struct sockaddr_in aE;
-    socklen_t lgA = sizeof(aE);
+    LoginJob *job = calloc(1, sizeof(LoginJob));
+    if (!job) {
+        const char *err = "Erreur: Serveur saturé, réessayez plus tard.";
+        reply(&aE, lgA, err, strlen(err));
+        return;
+    }
+    strcpy(job->user, user);
+    strcpy(job->pass, pass);
+    const char *stored = dict_get(users_dict, user);
+    if (stored) snprintf(job->stored, sizeof(job->stored), "%s", stored);
+    job->reliable = reliable;
+    job->binary = binary;
+    job->batch = batch;
+    job->addr = aE;
+    job->addr_len = lgA;
+    job->sock = dS_udp;
+
+    // Sans pool (-a 0) : vérification dans le worker, après la commande
+    if (!auth_pool) {
+        pending_login = job;
+        return;
+    }
+    if (!workpool_submit(auth_pool, run_login_job, job)) {
+        free(job);
+        const char *err = "Erreur: Serveur saturé, réessayez plus tard.";
+        reply(&aE, lgA, err, strlen(err));
+    }
+}
 
-    while (running) {
-        memset(buffer, 0, BUFFER_SIZE);
-        int n = recvfrom(dS_udp, buffer, BUFFER_SIZE-1, 0, (struct sockaddr*)&aE, &lgA);
-        if (n < 0) { perror("recvfrom"); continue; }
-        buffer[n] = '\0';
+// @ping : test de vie
+static void cmd_ping(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    (void)idx; (void)args;
+    const char *pong = "pong\n";
+    reply(&aE, lgA, pong, strlen(pong));
+}
 
-        char client_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &aE.sin_addr, client_ip, sizeof(client_ip));
-        printf("Reçu de %s:%d : %s\n", client_ip, ntohs(aE.sin_port), buffer);
-
-        int idx = find_client_index(&aE);
-        bool is_logged = (idx >= 0 && clients[idx].active);
-
-        // Traitement de la commande @login
-        if (strncmp(buffer, LOGIN_CMD, strlen(LOGIN_CMD)) == 0) {
-            // Extraction du nom d'utilisateur et du mot de passe
-            char *user = strtok(buffer + strlen(LOGIN_CMD) + 1, " ");
-            char *pass = strtok(NULL, " ");
-            if (!user || !pass) {
-                const char *err = "Erreur: Veuillez fournir nom d'utilisateur et mot de passe.";
-                sendto(dS_udp, err, strlen(err), 0, (struct sockaddr*)&aE, lgA);
-                continue;
-            }
+// @shutdown : arrêt du serveur, réservé à l'admin
+static void cmd_shutdown(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    (void)args;
+    // Vérifier si l'utilisateur est admin
+    if (strcmp(client_at(idx)->username, "admin") == 0) {
+        const char *msg = "Serveur éteint!\n";
+        reply(&aE, lgA, msg, strlen(msg));
+        // On déclenche proprement la fermeture
+        raise(SIGINT);
+    } else {
+        const char *err = "Erreur: accès refusé. Cette commande est réservée à l'utilisateur 'admin'.";
+        reply(&aE, lgA, err, strlen(err));
+    }
+}
 
-            // Recherche en mémoire
-            const char *stored = dict_get(users_dict, user);
-            int uid = find_user_index_by_name(user);
-
-            if (stored) {
-                // Utilisateur connu → vérifier le mot de passe
-                if (strcmp(stored, pass) != 0) {
-                    const char *err  = "Erreur: Mot de passe incorrect.";
-                    sendto(dS_udp, err, strlen(err), 0, (struct sockaddr*)&aE, lgA);
-                    const char *hint = "Veuillez retaper : @login <username> <password>";
-                    sendto(dS_udp, hint, strlen(hint), 0, (struct sockaddr*)&aE, lgA);
-                    continue;
+// @message : message privé
+static void cmd_message(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    char dest[BUFFER_SIZE] = {0}, content[BUFFER_SIZE] = {0};
+    char *start = args;
+    char *amp = strchr(start, '&');
+    if (amp) {
+        char *sp = strchr(amp + 1, ' ');
+        if (sp) {
+            // Récupérer le nom du destinataire et le contenu
+            size_t dlen = sp - (amp + 1);
+            strncpy(dest, amp + 1, dlen);
+            dest[dlen] = '\0';
+            strncpy(content, sp + 1, BUFFER_SIZE - 1);
+
+            // Trouver l'index du destinataire
+            int didx = find_user_index_by_name(dest);
+            if (didx >= 0 && client_at(didx)->active) {
+                char sender[50] = "inconnu";
+                if (idx >= 0) {
+                    strncpy(sender, client_at(idx)->username, sizeof(sender)-1);
                 }
-                
-                // Authentification réussie
-                if (uid < 0) {
-                    // Chargé depuis users.txt mais pas encore dans clients[]
-                    uid = client_count++;
-                    strncpy(clients[uid].username, user, sizeof(clients[uid].username)-1);
-                }
-                clients[uid].addr       = aE;
-                clients[uid].active     = 1;
-                clients[uid].room_count = 0;
-
-                char resp[BUFFER_SIZE];
-                is_logged = true;
-                snprintf(resp, sizeof(resp), "Bienvenue %s! Vous êtes connecté.", user);
-                sendto(dS_udp, resp, strlen(resp), 0, (struct sockaddr*)&aE, lgA);
 
+                // Construire et envoyer
+                if (!deliver_direct(didx, sender, content)) {
+                    perror("sendto");
+                } else {
+                    char conf[BUFFER_SIZE];
+                    snprintf(conf, sizeof(conf), "Message envoyé à %s.", dest);
+                    reply(&aE, lgA, conf, strlen(conf));
+                }
             } else {
-                // Nouvel utilisateur
-                dict_insert(users_dict, user, pass);
-                uid = client_count++;
-                strncpy(clients[uid].username, user, sizeof(clients[uid].username)-1);
-                clients[uid].addr       = aE;
-                clients[uid].active     = 1;
-                clients[uid].room_count = 0;
-
-                char resp[BUFFER_SIZE];
-                is_logged = true;
-                snprintf(resp, sizeof(resp), "Bienvenue %s! Enregistré et connecté.", user);
-                sendto(dS_udp, resp, strlen(resp), 0, (struct sockaddr*)&aE, lgA);
+                // Destinataire introuvable ou déconnecté
+                char err[BUFFER_SIZE];
+                if (didx < 0) {
+                    snprintf(err, sizeof(err),
+                            "Erreur: Utilisateur '%s' introuvable.", dest);
+                } else {
+                    snprintf(err, sizeof(err),
+                            "Erreur: Utilisateur '%s' non connecté.", dest);
+                }
+                reply(&aE, lgA, err, strlen(err));
             }
-            continue;
+        } else {
+            const char *e = "Format invalide. Utilisez '@message &destinataire message'.";
+            reply(&aE, lgA, e, strlen(e));
         }
+    } else {
+        const char *e = "Format invalide. Utilisez '@message &destinataire message'.";
+        reply(&aE, lgA, e, strlen(e));
+    }
+}
 
-        if (!is_logged) {
-            const char *err =
-                "Erreur: vous devez d'abord vous connecter avec\n"
-                "@login <username> <password>";
-            sendto(dS_udp, err, strlen(err), 0, (struct sockaddr*)&aE, lgA);
-            continue;
+// @upload : communique le port TCP pour l'envoi de fichier
+static void cmd_upload(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    char *filename = args;
+    while (*filename == ' ') filename++; // Ignorer les espaces
+
+    if (strlen(filename) > 0) {
+        // Chercher l'utilisateur qui fait la demande
+        char sender_username[BUFFER_SIZE] = "inconnu";
+        if (idx >= 0) {
+            strncpy(sender_username, client_at(idx)->username, BUFFER_SIZE - 1);
         }
 
-        // -- PING --
-        if (strncmp(buffer, "@ping", 5) == 0) {
-            const char *pong = "pong\n";
-            sendto(dS_udp, pong, strlen(pong), 0, (struct sockaddr*)&aE, lgA);
+        // Envoyer le port TCP au client via la socket UDP
+        char upload_response[BUFFER_SIZE];
+        sprintf(upload_response, "UPLOAD_PORT %d", TCP_PORT);
+        reply(&aE, lgA, upload_response, strlen(upload_response));
+        
+        printf("Notification d'upload envoyée à %s pour le fichier %s\n", sender_username, filename);
+    } 
+    else {
+        char error_msg[BUFFER_SIZE] = "Format attendu: '@upload filename'";
+        reply(&aE, lgA, error_msg, strlen(error_msg));
+    }
+}
+
+// @createroom : crée une salle
+static void cmd_createroom(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    // Format attendu: "@createroom nom_salle max_membres"
+    char *params = args; // +1 pour l'espace
+    
+    char room_name[MAX_ROOM_NAME_LENGTH] = {0};
+    int max_members = 10; // Valeur par défaut
+    
+    // Extraire le nom de la salle et le nombre max de membres
+    if (sscanf(params, "%49s %d", room_name, &max_members) >= 1) {
+        // Vérifier que max_members est au moins 1
+        if (max_members <= 0) {
+            char response[BUFFER_SIZE] = "Erreur: Le nombre maximum de membres doit être au moins 1.";
+            reply(&aE, lgA, response, strlen(response));
+            return;
         }
-        // -- SHUTDOWN --
-        else if (strncmp(buffer, "@shutdown", 9) == 0) {
-            // Vérifier si l'utilisateur est admin
-            int idx = find_client_index(&aE);
-            if (idx >= 0 && strcmp(clients[idx].username, "admin") == 0) {
-                const char *msg = "Serveur éteint!\n";
-                sendto(dS_udp, msg, strlen(msg), 0, (struct sockaddr*)&aE, lgA);
-                // On déclenche proprement la fermeture
-                raise(SIGINT);
-            } else {
-                const char *err = "Erreur: accès refusé. Cette commande est réservée à l'utilisateur 'admin'.";
-                sendto(dS_udp, err, strlen(err), 0, (struct sockaddr*)&aE, lgA);
-            }
+        if (max_members > MAX_ROOM_MEMBERS) {
+            char response[BUFFER_SIZE];
+            snprintf(response, sizeof(response), "Erreur: Le nombre maximum de membres ne peut pas dépasser %d.", MAX_ROOM_MEMBERS);
+            reply(&aE, lgA, response, strlen(response));
+            return;
         }
-        // -- MESSAGE PRIVÉ --
-        else if (strncmp(buffer, MESSAGE_CMD, strlen(MESSAGE_CMD)) == 0) {
-            char dest[BUFFER_SIZE] = {0}, content[BUFFER_SIZE] = {0};
-            char *start = buffer + strlen(MESSAGE_CMD) + 1;
-            char *amp = strchr(start, '&');
-            if (amp) {
-                char *sp = strchr(amp + 1, ' ');
-                if (sp) {
-                    // Récupérer le nom du destinataire et le contenu
-                    size_t dlen = sp - (amp + 1);
-                    strncpy(dest, amp + 1, dlen);
-                    dest[dlen] = '\0';
-                    strncpy(content, sp + 1, BUFFER_SIZE - 1);
-
-                    // Trouver l'index du destinataire
-                    int didx = find_user_index_by_name(dest);
-                    if (didx >= 0 && clients[didx].active) {
-                        // Identifier l'expéditeur
-                        int sender_idx = find_client_index(&aE);
-                        char sender[50] = "inconnu";
-                        if (sender_idx >= 0) {
-                            strncpy(sender, clients[sender_idx].username, sizeof(sender)-1);
-                        }
-
-                        // Construire et envoyer
-                        char forward[BUFFER_SIZE];
-                        snprintf(forward, sizeof(forward), "Message de %s: %s", sender, content);
-                        if (sendto(dS_udp, forward, strlen(forward), 0,
-                                (struct sockaddr*)&clients[didx].addr,
-                                sizeof(clients[didx].addr)) < 0) {
-                            perror("sendto");
-                        } else {
-                            char conf[BUFFER_SIZE];
-                            snprintf(conf, sizeof(conf), "Message envoyé à %s.", dest);
-                            sendto(dS_udp, conf, strlen(conf), 0, (struct sockaddr*)&aE, lgA);
-                        }
-                    } else {
-                        // Destinataire introuvable ou déconnecté
-                        char err[BUFFER_SIZE];
-                        if (didx < 0) {
-                            snprintf(err, sizeof(err),
-                                    "Erreur: Utilisateur '%s' introuvable.", dest);
-                        } else {
-                            snprintf(err, sizeof(err),
-                                    "Erreur: Utilisateur '%s' non connecté.", dest);
-                        }
-                        sendto(dS_udp, err, strlen(err), 0, (struct sockaddr*)&aE, lgA);
-                    }
-                } else {
-                    const char *e = "Format invalide. Utilisez '@message &destinataire message'.";
-                    sendto(dS_udp, e, strlen(e), 0, (struct sockaddr*)&aE, lgA);
-                }
-            } else {
-                const char *e = "Format invalide. Utilisez '@message &destinataire message'.";
-                sendto(dS_udp, e, strlen(e), 0, (struct sockaddr*)&aE, lgA);
-            }
+        
+        if (!valid_record_name(room_name)) {
+            char response[BUFFER_SIZE] = "Erreur: Le nom de la salle ne doit contenir ni ':' ni ','.";
+            reply(&aE, lgA, response, strlen(response));
+            return;
         }
-        // Traitement de la commande d'upload de fichier
-        else if (strncmp(buffer, UPLOAD_CMD, strlen(UPLOAD_CMD)) == 0) {
-            char *filename = buffer + strlen(UPLOAD_CMD) + 1;
-            while (*filename == ' ') filename++; // Ignorer les espaces
-
-            if (strlen(filename) > 0) {
-                // Chercher l'utilisateur qui fait la demande
-                char sender_username[BUFFER_SIZE] = "inconnu";
-                int sender_idx = find_client_index(&aE);
-                if (sender_idx >= 0) {
-                    strncpy(sender_username, clients[sender_idx].username, BUFFER_SIZE - 1);
+
+        // Vérifier si la salle existe déjà
+        if (find_room_by_name(room_name) >= 0) {
+            char response[BUFFER_SIZE];
+            sprintf(response, "Erreur: Une salle nommée '%s' existe déjà.", room_name);
+            reply(&aE, lgA, response, strlen(response));
+        } else {
+            // Créer la nouvelle salle dans le registre
+            int h = rooms_alloc(rooms, room_name, max_members);
+            if (h < 0) {
+                char response[BUFFER_SIZE] = "Erreur: Impossible de créer la salle.";
+                reply(&aE, lgA, response, strlen(response));
+            } else {
+                ChatRoom *new_room = room_at(h);
+                // Sans mémoire pour l'historique, la salle fonctionne sans
+                chatroom_history_init(new_room, ROOM_HISTORY_MESSAGES, ROOM_HISTORY_BYTES);
+                nameindex_put(room_names, new_room->name, h);
+                strncpy(new_room->owner, client_at(idx)->username, sizeof(new_room->owner)-1);
+
+                if (state_wal) wal_append(state_wal, "C:%s:%d:%s", new_room->name, max_members, new_room->owner);
+
+                // Ajouter le créateur comme premier membre
+                chatroom_add_member(new_room, idx, client_at(idx)->generation);
+                if (!client_add_room(client_at(idx), h)) {
+                    chatroom_remove_member(new_room, idx);
+                } else if (state_wal) {
+                    wal_append(state_wal, "J:%s:%s", new_room->name, client_at(idx)->username);
                 }
 
-                // Envoyer le port TCP au client via la socket UDP
-                char upload_response[BUFFER_SIZE];
-                sprintf(upload_response, "UPLOAD_PORT %d", TCP_PORT);
-                sendto(dS_udp, upload_response, strlen(upload_response), 0, (struct sockaddr*)&aE, lgA);
-                
-                printf("Notification d'upload envoyée à %s pour le fichier %s\n", sender_username, filename);
-            } 
-            else {
-                char error_msg[BUFFER_SIZE] = "Format attendu: '@upload filename'";
-                sendto(dS_udp, error_msg, strlen(error_msg), 0, (struct sockaddr*)&aE, lgA);
+                char response[BUFFER_SIZE];
+                sprintf(response, "Salle '%s' créée avec succès et vous y avez été ajouté.", room_name);
+                reply(&aE, lgA, response, strlen(response));
+                send_room_bind(idx, h);
             }
         }
-        // Commande pour créer une salle
-        else if (strncmp(buffer, CREATEROOM_CMD, strlen(CREATEROOM_CMD)) == 0) {
-            // Format attendu: "@createroom nom_salle max_membres"
-            char *params = buffer + strlen(CREATEROOM_CMD) + 1; // +1 pour l'espace
-            
-            char room_name[MAX_ROOM_NAME_LENGTH] = {0};
-            int max_members = 10; // Valeur par défaut
-            
-            // Extraire le nom de la salle et le nombre max de membres
-            if (sscanf(params, "%s %d", room_name, &max_members) >= 1) {
-                // Vérifier que max_members est au moins 1
-                if (max_members <= 0) {
-                    char response[BUFFER_SIZE] = "Erreur: Le nombre maximum de membres doit être au moins 1.";
-                    sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                    continue;
-                }
-                
-                // Vérifier si la salle existe déjà
-                if (dict_get(room_dict, room_name) != NULL) {
+    } else {
+        // Format invalide
+        char response[BUFFER_SIZE] = "Erreur: Format invalide. Utilisez '@createroom nom_salle max_membres'.";
+        reply(&aE, lgA, response, strlen(response));
+    }
+}
+
+// @joinroom : rejoint une salle
+static void cmd_joinroom(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    // Format attendu: "@joinroom nom_salle"
+    char *room_name = args; // +1 pour l'espace
+    
+    // Chercher la salle
+    int room_index = find_room_by_name(room_name);
+    if (room_index < 0) {
+        char response[BUFFER_SIZE];
+        sprintf(response, "Erreur: Salle '%s' introuvable.", room_name);
+        reply(&aE, lgA, response, strlen(response));
+    } else {
+        if (idx < 0) {
+            char response[BUFFER_SIZE] = "Erreur: Vous n'êtes pas connecté.";
+            reply(&aE, lgA, response, strlen(response));
+        } else {
+            // Vérifier si le client est déjà membre
+            if (chatroom_is_member(room_at(room_index), idx)) {
+                char response[BUFFER_SIZE];
+                sprintf(response, "Vous êtes déjà membre de la salle '%s'.", room_name);
+                reply(&aE, lgA, response, strlen(response));
+            } else if (chatroom_is_full(room_at(room_index))) {
+                char response[BUFFER_SIZE];
+                sprintf(response, "Erreur: La salle '%s' est pleine.", room_name);
+                reply(&aE, lgA, response, strlen(response));
+            } else {
+                // Ajouter le client à la salle
+                chatroom_add_member(room_at(room_index), idx, client_at(idx)->generation);
+                // Ajouter la salle à la liste des salles du client
+                if (client_add_room(client_at(idx), room_index)) {
+                    if (state_wal) wal_append(state_wal, "J:%s:%s", room_at(room_index)->name, client_at(idx)->username);
+
                     char response[BUFFER_SIZE];
-                    sprintf(response, "Erreur: Une salle nommée '%s' existe déjà.", room_name);
-                    sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                } else if (room_count >= MAX_ROOMS) {
-                    // Nombre maximum de salles atteint
-                    char response[BUFFER_SIZE] = "Erreur: Nombre maximum de salles atteint.";
-                    sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
+                    sprintf(response, "Vous avez rejoint la salle '%s'.", room_name);
+                    reply(&aE, lgA, response, strlen(response));
+                    send_room_bind(idx, room_index);
+                    // Rejouer les derniers messages au nouveau membre
+                    int pages;
+                    send_history_page(idx, room_index, 1, &pages, NULL, 0);
+                    
+                    // Notifier les autres membres
+                    char notification[BUFFER_SIZE];
+                    sprintf(notification, "%s a rejoint la salle.", client_at(idx)->username);
+                    broadcast_to_room(room_index, notification, "Serveur", &aE, false);
                 } else {
-                    // Créer la nouvelle salle
-                    ChatRoom *new_room = chatroom_create(room_name, max_members);
-                    if (!new_room) {
-                        char response[BUFFER_SIZE] = "Erreur: Impossible de créer la salle.";
-                        sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                    } else {
-                        // Ajouter la salle au tableau et au dictionnaire
-                        rooms[room_count] = new_room;
-                        
-                        char index_str[10];
-                        sprintf(index_str, "%d", room_count);
-                        dict_insert(room_dict, room_name, index_str);
-                        
-                        // Trouver le client qui a créé la salle
-                        int client_index = find_client_index(&aE);
-                        if (client_index >= 0) {
-                            // Ajouter le créateur comme premier membre
-                            chatroom_add_member(new_room, client_index);
-                            
-                            // Ajouter la salle à la liste des salles du client
-                            if (clients[client_index].room_count < MAX_ROOMS) {
-                                clients[client_index].joined_rooms[clients[client_index].room_count++] = room_count;
-                            }
-                            
-                            char response[BUFFER_SIZE];
-                            sprintf(response, "Salle '%s' créée avec succès et vous y avez été ajouté.", room_name);
-                            sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                        } else {
-                            char response[BUFFER_SIZE];
-                            sprintf(response, "Salle '%s' créée avec succès.", room_name);
-                            sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                        }
-                        room_count++;
-                    }
+                    chatroom_remove_member(room_at(room_index), idx);
+                    
+                    char response[BUFFER_SIZE] = "Erreur: Impossible de rejoindre la salle.";
+                    reply(&aE, lgA, response, strlen(response));
                 }
-            } else {
-                // Format invalide
-                char response[BUFFER_SIZE] = "Erreur: Format invalide. Utilisez '@createroom nom_salle max_membres'.";
-                sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
             }
         }
-        // Commande pour rejoindre une salle
-        else if (strncmp(buffer, JOINROOM_CMD, strlen(JOINROOM_CMD)) == 0) {
-            // Format attendu: "@joinroom nom_salle"
-            char *room_name = buffer + strlen(JOINROOM_CMD) + 1; // +1 pour l'espace
-            
-            // Chercher la salle
-            int room_index = find_room_by_name(room_name);
-            if (room_index < 0) {
+    }
+}
+
+// @leaveroom : quitte une salle
+static void cmd_leaveroom(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    // Format attendu: "@leaveroom nom_salle"
+    char *room_name = args; // +1 pour l'espace
+    
+    // Chercher la salle
+    int room_index = find_room_by_name(room_name);
+    if (room_index < 0) {
+        char response[BUFFER_SIZE];
+        sprintf(response, "Erreur: Salle '%s' introuvable.", room_name);
+        reply(&aE, lgA, response, strlen(response));
+    } else {
+        if (idx < 0) {
+            char response[BUFFER_SIZE] = "Erreur: Vous n'êtes pas connecté.";
+            reply(&aE, lgA, response, strlen(response));
+        } else {
+            // Vérifier si le client est membre
+            if (!chatroom_is_member(room_at(room_index), idx)) {
                 char response[BUFFER_SIZE];
-                sprintf(response, "Erreur: Salle '%s' introuvable.", room_name);
-                sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
+                sprintf(response, "Erreur: Vous n'êtes pas membre de la salle '%s'.", room_name);
+                reply(&aE, lgA, response, strlen(response));
             } else {
-                // Trouver le client qui souhaite rejoindre
-                int client_index = find_client_index(&aE);
-                if (client_index < 0) {
-                    char response[BUFFER_SIZE] = "Erreur: Vous n'êtes pas connecté.";
-                    sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                } else {
-                    // Vérifier si le client est déjà membre
-                    if (chatroom_is_member(rooms[room_index], client_index)) {
-                        char response[BUFFER_SIZE];
-                        sprintf(response, "Vous êtes déjà membre de la salle '%s'.", room_name);
-                        sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                    } else if (chatroom_is_full(rooms[room_index])) {
-                        char response[BUFFER_SIZE];
-                        sprintf(response, "Erreur: La salle '%s' est pleine.", room_name);
-                        sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                    } else {
-                        // Ajouter le client à la salle
-                        chatroom_add_member(rooms[room_index], client_index);                  
-                        // Ajouter la salle à la liste des salles du client
-                        if (clients[client_index].room_count < MAX_ROOMS) {
-                            clients[client_index].joined_rooms[clients[client_index].room_count++] = room_index;
-                            
-                            char response[BUFFER_SIZE];
-                            sprintf(response, "Vous avez rejoint la salle '%s'.", room_name);
-                            sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                            
-                            // Notifier les autres membres
-                            char notification[BUFFER_SIZE];
-                            sprintf(notification, "%s a rejoint la salle.", clients[client_index].username);
-                            broadcast_to_room(room_index, notification, "Serveur", &aE);
-                        } else {
-                            chatroom_remove_member(rooms[room_index], client_index);
-                            
-                            char response[BUFFER_SIZE] = "Erreur: Vous avez rejoint trop de salles.";
-                            sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                        }
-                    }
+                // Retirer le client de la salle
+                chatroom_remove_member(room_at(room_index), idx);          
+                // Retirer la salle de la liste des salles du client
+                client_remove_room(client_at(idx), room_index);
+                if (state_wal) wal_append(state_wal, "L:%s:%s", room_at(room_index)->name, client_at(idx)->username);
+                
+                char response[BUFFER_SIZE];
+                sprintf(response, "Vous avez quitté la salle '%s'.", room_name);
+                reply(&aE, lgA, response, strlen(response));
+                
+                // Notifier les autres membres
+                char notification[BUFFER_SIZE];
+                sprintf(notification, "%s a quitté la salle.", client_at(idx)->username);
+                broadcast_to_room(room_index, notification, "Serveur", &aE, false);
+            }
+        }
+    }
+}
+
+// @deleteroom : supprime une salle (réservé à son créateur et à l'admin)
+static void cmd_deleteroom(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    // Format attendu: "@deleteroom nom_salle"
+    char *room_name = args; // +1 pour l'espace
+
+    int room_index = find_room_by_name(room_name);
+    if (room_index < 0) {
+        char response[BUFFER_SIZE];
+        snprintf(response, sizeof(response), "Erreur: Salle '%s' introuvable.", room_name);
+        reply(&aE, lgA, response, strlen(response));
+    } else if (strcmp(room_at(room_index)->owner, client_at(idx)->username) != 0 &&
+               strcmp(client_at(idx)->username, "admin") != 0) {
+        char response[BUFFER_SIZE];
+        snprintf(response, sizeof(response),
+                 "Erreur: Seul le créateur de la salle '%s' peut la supprimer.", room_name);
+        reply(&aE, lgA, response, strlen(response));
+    } else {
+        // Prévenir les membres avant la suppression
+        char notification[BUFFER_SIZE];
+        snprintf(notification, sizeof(notification), "La salle a été supprimée par %s.", client_at(idx)->username);
+        broadcast_to_room(room_index, notification, "Serveur", &aE, false);
+
+        char response[BUFFER_SIZE];
+        snprintf(response, sizeof(response), "Salle '%s' supprimée.", room_name);
+        if (state_wal) wal_append(state_wal, "D:%s", room_at(room_index)->name);
+        // Une salle recréée sous ce nom ne relira pas ces archives
+        if (chat_log) chatlog_append(chat_log, 'X', room_at(room_index)->name, "", "");
+        delete_room(room_index);
+        reply(&aE, lgA, response, strlen(response));
+    }
+}
+
+// @listrooms : liste les salles
+static void cmd_listrooms(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    (void)idx; (void)args;
+    if (rooms->used == 0) {
+        char response[BUFFER_SIZE] = "Aucune salle n'existe actuellement.";
+        reply(&aE, lgA, response, strlen(response));
+    } else {
+        char response[BUFFER_SIZE] = "Liste des salles disponibles:\n";
+        
+        for (int i = 0; i < rooms->high_water; i++) {
+            if (room_at(i)->active) {
+                char room_info[100];
+                sprintf(room_info, "%s (%d/%d membres)\n", 
+                        room_at(i)->name, 
+                        chatroom_get_member_count(room_at(i)), 
+                        chatroom_get_max_members(room_at(i)));
+                
+                // S'assurer qu'il y a assez d'espace dans la réponse
+                if (strlen(response) + strlen(room_info) < BUFFER_SIZE - 1) {
+                    strcat(response, room_info);
                 }
             }
         }
-        // Commande pour quitter une salle
-        else if (strncmp(buffer, LEAVEROOM_CMD, strlen(LEAVEROOM_CMD)) == 0) {
-            // Format attendu: "@leaveroom nom_salle"
-            char *room_name = buffer + strlen(LEAVEROOM_CMD) + 1; // +1 pour l'espace
+        
+        reply(&aE, lgA, response, strlen(response));
+    }
+}
+
+// @listmembers : liste les membres d'une salle
+static void cmd_listmembers(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    (void)idx;
+    // Format attendu: "@listmembers nom_salle"
+    char *room_name = args; // +1 pour l'espace
+    
+    // Chercher la salle
+    int room_index = find_room_by_name(room_name);
+    if (room_index < 0) {
+        char response[BUFFER_SIZE];
+        sprintf(response, "Erreur: Salle '%s' introuvable.", room_name);
+        reply(&aE, lgA, response, strlen(response));
+    } else {
+        ChatRoom *room = room_at(room_index);
+        
+        if (chatroom_get_member_count(room) == 0) {
+            char response[BUFFER_SIZE];
+            sprintf(response, "La salle '%s' ne contient aucun membre.", room_name);
+            reply(&aE, lgA, response, strlen(response));
+        } else {
+            char response[BUFFER_SIZE];
+            sprintf(response, "Membres de la salle '%s':\n", room_name);
+            
+            for (int i = 0; i < room->member_count; i++) {
+                if (!room_member_is_current(room, i)) continue;
+                int member_index = room->member_indices[i];
+                
+                char member_info[100];
+                sprintf(member_info, "- %s\n", client_at(member_index)->username);
+                // S'assurer qu'il y a assez d'espace dans la réponse
+                if (strlen(response) + strlen(member_info) < BUFFER_SIZE - 1) {
+                    strcat(response, member_info);
+                }
+            }
+            
+            reply(&aE, lgA, response, strlen(response));
+        }
+    }
+}
+
+// @roomsg : message à une salle
+static void cmd_roomsg(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    // Format attendu: "@roomsg nom_salle message"
+    char *params = args; // +1 pour l'espace
+    
+    // Extraire le nom de la salle et le message
+    char room_name[MAX_ROOM_NAME_LENGTH] = {0};
+    char *message_content = NULL;
+    
+    // Trouver le premier espace après le nom de la salle
+    char *space_after_room = strchr(params, ' ');
+    if (space_after_room) {
+        size_t room_name_len = space_after_room - params;
+        
+        if (room_name_len > 0 && room_name_len < MAX_ROOM_NAME_LENGTH) {
+            // Extraire le nom de la salle
+            strncpy(room_name, params, room_name_len);
+            room_name[room_name_len] = '\0';
+            
+            // Extraire le contenu du message
+            message_content = space_after_room + 1;
             
             // Chercher la salle
             int room_index = find_room_by_name(room_name);
             if (room_index < 0) {
                 char response[BUFFER_SIZE];
                 sprintf(response, "Erreur: Salle '%s' introuvable.", room_name);
-                sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
+                reply(&aE, lgA, response, strlen(response));
             } else {
-                // Trouver le client qui souhaite quitter
-                int client_index = find_client_index(&aE);
-                if (client_index < 0) {
+                if (idx < 0) {
                     char response[BUFFER_SIZE] = "Erreur: Vous n'êtes pas connecté.";
-                    sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
+                    reply(&aE, lgA, response, strlen(response));
                 } else {
-                    // Vérifier si le client est membre
-                    if (!chatroom_is_member(rooms[room_index], client_index)) {
+                    // Vérifier si le client est membre de la salle
+                    if (!chatroom_is_member(room_at(room_index), idx)) {
                         char response[BUFFER_SIZE];
                         sprintf(response, "Erreur: Vous n'êtes pas membre de la salle '%s'.", room_name);
-                        sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
+                        reply(&aE, lgA, response, strlen(response));
                     } else {
-                        // Retirer le client de la salle
-                        chatroom_remove_member(rooms[room_index], client_index);          
-                        // Retirer la salle de la liste des salles du client
-                        for (int i = 0; i < clients[client_index].room_count; i++) {
-                            if (clients[client_index].joined_rooms[i] == room_index) {
-                                // Décaler les éléments suivants
-                                for (int j = i; j < clients[client_index].room_count - 1; j++) {
-                                    clients[client_index].joined_rooms[j] = clients[client_index].joined_rooms[j + 1];
-                                }
-                                clients[client_index].room_count--;
-                                break;
-                            }
-                        }
-                        
-                        char response[BUFFER_SIZE];
-                        sprintf(response, "Vous avez quitté la salle '%s'.", room_name);
-                        sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
+                        // Diffuser le message à tous les membres de la salle
+                        broadcast_to_room(room_index, message_content, client_at(idx)->username, &aE, true);
                         
-                        // Notifier les autres membres
-                        char notification[BUFFER_SIZE];
-                        sprintf(notification, "%s a quitté la salle.", clients[client_index].username);
-                        broadcast_to_room(room_index, notification, "Serveur", &aE);
+                        // Confirmer l'envoi
+                        char confirm_msg[BUFFER_SIZE];
+                        sprintf(confirm_msg, "Message envoyé à la salle '%s'.", room_name);
+                        reply(&aE, lgA, confirm_msg, strlen(confirm_msg));
                     }
                 }
             }
+        } else {
+            // Nom de salle invalide
+            char response[BUFFER_SIZE] = "Erreur: Nom de salle invalide.";
+            reply(&aE, lgA, response, strlen(response));
         }
-        // Commande pour lister les salles
-        else if (strncmp(buffer, LISTROOMS_CMD, strlen(LISTROOMS_CMD)) == 0) {
-            if (room_count == 0) {
-                char response[BUFFER_SIZE] = "Aucune salle n'existe actuellement.";
-                sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
+    } else {
+        // Format invalide
+        char response[BUFFER_SIZE] = "Erreur: Format invalide. Utilisez '@roomsg nom_salle message'.";
+        reply(&aE, lgA, response, strlen(response));
+    }
+}
+
+// @history : page de l'historique d'une salle dont on est membre
+static void cmd_history(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    char room_name[MAX_ROOM_NAME_LENGTH] = {0};
+    char response[BUFFER_SIZE];
+    int page = 1;
+
+    if (sscanf(args, "%49s %d", room_name, &page) < 1 || page < 1) {
+        snprintf(response, sizeof(response), "Erreur: Format invalide. Utilisez '@history nom_salle [page]'.");
+    } else {
+        int room_index = find_room_by_name(room_name);
+        if (room_index < 0) {
+            snprintf(response, sizeof(response), "Erreur: Salle '%s' introuvable.", room_name);
+        } else if (!chatroom_is_member(room_at(room_index), idx)) {
+            snprintf(response, sizeof(response), "Erreur: Vous n'êtes pas membre de la salle '%s'.", room_name);
+        } else {
+            int pages;
+            if (send_history_page(idx, room_index, page, &pages, &aE, lgA)) return;
+            if (pages == 0) {
+                snprintf(response, sizeof(response), "Aucun message dans l'historique de la salle '%s'.", room_name);
             } else {
-                char response[BUFFER_SIZE] = "Liste des salles disponibles:\n";
-                
-                for (int i = 0; i < room_count; i++) {
-                    if (rooms[i] && rooms[i]->active) {
-                        char room_info[100];
-                        sprintf(room_info, "%s (%d/%d membres)\n", 
-                                rooms[i]->name, 
-                                chatroom_get_member_count(rooms[i]), 
-                                chatroom_get_max_members(rooms[i]));
-                        
-                        // S'assurer qu'il y a assez d'espace dans la réponse
-                        if (strlen(response) + strlen(room_info) < BUFFER_SIZE - 1) {
-                            strcat(response, room_info);
-                        }
-                    }
-                }
-                
-                sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
+                snprintf(response, sizeof(response), "Erreur: La salle '%s' n'a que %d page(s) d'historique.", room_name, pages);
             }
         }
-        // Commande pour lister les membres d'une salle
-        else if (strncmp(buffer, LISTMEMBERS_CMD, strlen(LISTMEMBERS_CMD)) == 0) {
-            // Format attendu: "@listmembers nom_salle"
-            char *room_name = buffer + strlen(LISTMEMBERS_CMD) + 1; // +1 pour l'espace
-            
-            // Chercher la salle
-            int room_index = find_room_by_name(room_name);
-            if (room_index < 0) {
-                char response[BUFFER_SIZE];
-                sprintf(response, "Erreur: Salle '%s' introuvable.", room_name);
-                sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
+    }
+    reply(&aE, lgA, response, strlen(response));
+}
+
+// Envoie un fichier texte ligne par ligne (@help, @credits)
+static void send_text_file(const char *filename, struct sockaddr_in aE, socklen_t lgA) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        char error_msg[BUFFER_SIZE];
+        snprintf(error_msg, sizeof(error_msg), "Erreur : impossible d'ouvrir le fichier %s\n", filename);
+        reply(&aE, lgA, error_msg, strlen(error_msg));
+    } 
+    else {
+        char line[512];
+        // Lire et envoyer ligne par ligne
+        while (fgets(line, sizeof(line), file)) {
+            reply(&aE, lgA, line, strlen(line));
+        }
+        fclose(file);
+    }
+}
+
+// @help : liste de toutes les commandes
+static void cmd_help(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    (void)idx; (void)args;
+    send_text_file("commandes.txt", aE, lgA);
+}
+
+// @credits : crédits du projet
+static void cmd_credits(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    (void)idx; (void)args;
+    send_text_file("credits.txt", aE, lgA);
+}
+
+// Commande absente de la table : message standard, format non reconnu
+static void cmd_unknown(int idx, char *args, struct sockaddr_in aE, socklen_t lgA) {
+    (void)idx; (void)args;
+    // Message standard, format non reconnu
+    printf("Message standard reçu\n");
+    
+    // Informer l'expéditeur que le format du message n'est pas reconnu
+    char help_msg[BUFFER_SIZE] = 
+        "Format non reconnu. Commandes disponibles:\n"
+        "@message &destinataire message - Envoyer un message privé\n"
+        "@createroom nom_salle max_membres - Créer une salle\n"
+        "@joinroom nom_salle - Rejoindre une salle\n"
+        "@leaveroom nom_salle - Quitter une salle\n"
+        "@deleteroom nom_salle - Supprimer une salle que vous avez créée\n"
+        "@listrooms - Lister les salles disponibles\n"
+        "@listmembers nom_salle - Lister les membres d'une salle\n"
+        "@roomsg nom_salle message - Envoyer un message à une salle\n"
+        "@history nom_salle [page] - Relire les messages précédents d'une salle\n"
+        "@upload nom_fichier - Envoyer un fichier au serveur\n"
+        "@download nom_fichier - Télécharger un fichier du serveur\n"
+        "@help - Liste de toutes les commandes\n";
+    
+    reply(&aE, lgA, help_msg, strlen(help_msg));
+}
+
+// Drapeaux de la table des commandes (SERVER_COMMANDS, globalVariables.h)
+#define CMD_PUBLIC  1   // utilisable sans session
+#define CMD_MUTATES 2   // modifie l'état partagé : verrou d'état en écriture
+#define CMD_QUIET   4   // pas de trace à la réception
+#define CMD_SECRET  8   // trace limitée au premier argument (mot de passe masqué)
+
+// Gestionnaire d'une commande : session de l'expéditeur (-1 si aucune),
+// arguments après le jeton, adresse de réponse
+typedef void (*CommandHandler)(int idx, char *args, struct sockaddr_in aE, socklen_t lgA);
+
+typedef struct {
+    const char *token;
+    CommandHandler handler;
+    unsigned flags;
+} ServerCommand;
+
+#define COMMAND_ENTRY(token, name, flags) { token, cmd_##name, flags },
+#define COMMAND_TOKEN(token, name, flags) token,
+static const ServerCommand commands[] = { SERVER_COMMANDS(COMMAND_ENTRY) };
+static const char *const command_tokens[] = { SERVER_COMMANDS(COMMAND_TOKEN) };
+#define COMMAND_COUNT ((int)(sizeof(commands) / sizeof(commands[0])))
+
+static const ServerCommand unknown_command = { NULL, cmd_unknown, 0 };
+static CmdHash command_hash;  // Construite par main avant le lancement des workers
+
+// Commande désignée par le jeton en tête du datagramme : un hachage et une
+// comparaison, le jeton doit être exact ("@messages" n'est pas "@message")
+static const ServerCommand *find_command(const char *buffer, size_t *token_len) {
+    int i = cmdhash_lookup(&command_hash, buffer, token_len);
+    return i >= 0 ? &commands[i] : &unknown_command;
+}
+
+// Traite un datagramme texte reçu de aE (l'appelant détient state_lock)
+static void handle_datagram(const ServerCommand *cmd, char *buffer, size_t token_len,
+                            struct sockaddr_in aE, socklen_t lgA) {
+    // Session de l'expéditeur, cherchée une seule fois pour tout le traitement
+    int idx = find_client_index(&aE);
+    bool is_logged = (idx >= 0 && client_at(idx)->active);
+
+    // Tout datagramme d'un client connecté prouve qu'il est vivant ; le
+    // minuteur n'est pas touché ici, il relit last_seen à son échéance
+    if (is_logged) client_at(idx)->last_seen = now_tick();
+    reply_coalesce = is_logged && client_at(idx)->batch;
+
+    if (!(cmd->flags & CMD_QUIET)) {
+        char client_ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &aE.sin_addr, client_ip, sizeof(client_ip));
+        if (cmd->flags & CMD_SECRET) {
+            size_t shown = token_len;
+            if (buffer[token_len]) shown += 1 + strcspn(buffer + token_len + 1, " ");
+            printf("Reçu de %s:%d : %.*s ***\n", client_ip, ntohs(aE.sin_port), (int)shown, buffer);
+        } else {
+            printf("Reçu de %s:%d : %s\n", client_ip, ntohs(aE.sin_port), buffer);
+        }
+    }
+
+    if (!is_logged && !(cmd->flags & CMD_PUBLIC)) {
+        const char *err =
+            "Erreur: vous devez d'abord vous connecter avec\n"
+            "@login <username> <password>";
+        reply(&aE, lgA, err, strlen(err));
+        return;
+    }
+
+    // Arguments : après le jeton et l'espace qui le suit (le tampon se
+    // termine par deux '\0', args vaut "" pour une commande sans argument)
+    cmd->handler(idx, buffer + token_len + (buffer[token_len] != '\0'), aE, lgA);
+}
+
+
+// Trame du protocole binaire (wire.h), sous le verrou d'état en lecture :
+// pas de strncmp ni de sprintf, salles et destinataires par poignée
+static void handle_binary_frame(const uint8_t *buf, size_t len, struct sockaddr_in aE, socklen_t lgA) {
+    int idx = find_client_index(&aE);
+    reply_coalesce = idx >= 0 && client_at(idx)->batch;
+    if (idx < 0) {
+        send_status(&aE, lgA, WST_ERROR, "Erreur: vous devez d'abord vous connecter avec\n@login <username> <password>");
+        return;
+    }
+    client_at(idx)->last_seen = now_tick();
+
+    WireReader r;
+    uint8_t op = wire_open(&r, buf, len);
+    char name[MAX_ROOM_NAME_LENGTH], text[BUFFER_SIZE], response[BUFFER_SIZE];
+
+    switch (op) {
+    case WOP_ROOMSG:
+    case WOP_ROOMSG_NAMED: {
+        int h;
+        if (op == WOP_ROOMSG) {
+            uint64_t handle = wire_get_varint(&r);
+            uint64_t gen = wire_get_varint(&r);
+            h = (handle < (uint64_t)rooms->high_water && room_at(handle)->active &&
+                 room_at(handle)->generation == gen) ? (int)handle : -1;
+        } else {
+            wire_get_str(&r, name, sizeof(name));
+            h = find_room_by_name(name);
+        }
+        wire_get_str(&r, text, sizeof(text));
+        if (r.error) {
+            send_status(&aE, lgA, WST_ERROR, "Erreur: Trame invalide.");
+        } else if (h < 0) {
+            if (op == WOP_ROOMSG) {
+                send_status(&aE, lgA, WST_STALE_HANDLE, "Erreur: Salle inconnue (poignée périmée).");
             } else {
-                ChatRoom *room = rooms[room_index];
-                
-                if (chatroom_get_member_count(room) == 0) {
-                    char response[BUFFER_SIZE];
-                    sprintf(response, "La salle '%s' ne contient aucun membre.", room_name);
-                    sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                } else {
-                    char response[BUFFER_SIZE];
-                    sprintf(response, "Membres de la salle '%s':\n", room_name);
-                    
-                    for (int i = 0; i < room->member_count; i++) {
-                        int member_index = room->member_indices[i];
-                        
-                        char member_info[100];
-                        sprintf(member_info, "- %s\n", clients[member_index].username);
-                        // S'assurer qu'il y a assez d'espace dans la réponse
-                        if (strlen(response) + strlen(member_info) < BUFFER_SIZE - 1) {
-                            strcat(response, member_info);
-                        }
-                    }
-                    
-                    sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                }
+                snprintf(response, sizeof(response), "Erreur: Salle '%s' introuvable.", name);
+                send_status(&aE, lgA, WST_ERROR, response);
             }
+        } else if (!chatroom_is_member(room_at(h), idx)) {
+            snprintf(response, sizeof(response), "Erreur: Vous n'êtes pas membre de la salle '%s'.", room_at(h)->name);
+            send_status(&aE, lgA, WST_ERROR, response);
+        } else {
+            broadcast_to_room(h, text, client_at(idx)->username, &aE, true);
+            if (op == WOP_ROOMSG_NAMED) send_room_bind(idx, h);
+            snprintf(response, sizeof(response), "Message envoyé à la salle '%s'.", room_at(h)->name);
+            send_status(&aE, lgA, WST_OK, response);
         }
-        // Commande pour envoyer un message à une salle
-        else if (strncmp(buffer, ROOMSG_CMD, strlen(ROOMSG_CMD)) == 0) {
-            // Format attendu: "@roomsg nom_salle message"
-            char *params = buffer + strlen(ROOMSG_CMD) + 1; // +1 pour l'espace
-            
-            // Extraire le nom de la salle et le message
-            char room_name[MAX_ROOM_NAME_LENGTH] = {0};
-            char *message_content = NULL;
-            
-            // Trouver le premier espace après le nom de la salle
-            char *space_after_room = strchr(params, ' ');
-            if (space_after_room) {
-                size_t room_name_len = space_after_room - params;
-                
-                if (room_name_len > 0 && room_name_len < MAX_ROOM_NAME_LENGTH) {
-                    // Extraire le nom de la salle
-                    strncpy(room_name, params, room_name_len);
-                    room_name[room_name_len] = '\0';
-                    
-                    // Extraire le contenu du message
-                    message_content = space_after_room + 1;
-                    
-                    // Chercher la salle
-                    int room_index = find_room_by_name(room_name);
-                    if (room_index < 0) {
-                        char response[BUFFER_SIZE];
-                        sprintf(response, "Erreur: Salle '%s' introuvable.", room_name);
-                        sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                    } else {
-                        // Trouver le client qui envoie le message
-                        int client_index = find_client_index(&aE);
-                        if (client_index < 0) {
-                            char response[BUFFER_SIZE] = "Erreur: Vous n'êtes pas connecté.";
-                            sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                        } else {
-                            // Vérifier si le client est membre de la salle
-                            if (!chatroom_is_member(rooms[room_index], client_index)) {
-                                char response[BUFFER_SIZE];
-                                sprintf(response, "Erreur: Vous n'êtes pas membre de la salle '%s'.", room_name);
-                                sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                            } else {
-                                // Diffuser le message à tous les membres de la salle
-                                broadcast_to_room(room_index, message_content, clients[client_index].username, &aE);
-                                
-                                // Confirmer l'envoi
-                                char confirm_msg[BUFFER_SIZE];
-                                sprintf(confirm_msg, "Message envoyé à la salle '%s'.", room_name);
-                                sendto(dS_udp, confirm_msg, strlen(confirm_msg), 0, (struct sockaddr*)&aE, lgA);
-                            }
-                        }
-                    }
-                } else {
-                    // Nom de salle invalide
-                    char response[BUFFER_SIZE] = "Erreur: Nom de salle invalide.";
-                    sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
-                }
+        break;
+    }
+    case WOP_MESSAGE:
+    case WOP_MESSAGE_NAMED: {
+        int didx;
+        if (op == WOP_MESSAGE) {
+            uint64_t handle = wire_get_varint(&r);
+            uint64_t gen = wire_get_varint(&r);
+            didx = (handle < (uint64_t)clients->high_water && client_at(handle)->in_use &&
+                    client_at(handle)->generation == gen) ? (int)handle : -1;
+        } else {
+            wire_get_str(&r, name, sizeof(name));
+            didx = find_user_index_by_name(name);
+        }
+        wire_get_str(&r, text, sizeof(text));
+        if (r.error) {
+            send_status(&aE, lgA, WST_ERROR, "Erreur: Trame invalide.");
+        } else if (didx < 0) {
+            if (op == WOP_MESSAGE) {
+                send_status(&aE, lgA, WST_STALE_HANDLE, "Erreur: Utilisateur inconnu (poignée périmée).");
             } else {
-                // Format invalide
-                char response[BUFFER_SIZE] = "Erreur: Format invalide. Utilisez '@roomsg nom_salle message'.";
-                sendto(dS_udp, response, strlen(response), 0, (struct sockaddr*)&aE, lgA);
+                snprintf(response, sizeof(response), "Erreur: Utilisateur '%s' introuvable.", name);
+                send_status(&aE, lgA, WST_ERROR, response);
             }
-        } 
-        else if (strncmp(buffer, HELP_CMD, strlen(HELP_CMD)) == 0) {
-            FILE *file = fopen("commandes.txt", "r");
-            if (file == NULL) {
-                char error_msg[] = "Erreur : impossible d'ouvrir le fichier commandes.txt\n";
-                sendto(dS_udp, error_msg, strlen(error_msg), 0, (struct sockaddr*)&aE, lgA);
-            } 
-            else {
-                char line[512];
-                // Lire et envoyer ligne par ligne
-                while (fgets(line, sizeof(line), file)) {
-                    sendto(dS_udp, line, strlen(line), 0, (struct sockaddr*)&aE, lgA);
-                }
-                fclose(file);
+        } else if (!client_at(didx)->active) {
+            snprintf(response, sizeof(response), "Erreur: Utilisateur '%s' non connecté.", client_at(didx)->username);
+            send_status(&aE, lgA, WST_ERROR, response);
+        } else if (!deliver_direct(didx, client_at(idx)->username, text)) {
+            send_status(&aE, lgA, WST_ERROR, "Erreur: Envoi impossible.");
+        } else {
+            if (op == WOP_MESSAGE_NAMED) send_user_bind(idx, didx);
+            snprintf(response, sizeof(response), "Message envoyé à %s.", client_at(didx)->username);
+            send_status(&aE, lgA, WST_OK, response);
+        }
+        break;
+    }
+    default:
+        send_status(&aE, lgA, WST_ERROR, "Erreur: Opcode inconnu.");
+    }
+}
+
+// Crée une socket UDP SO_REUSEPORT liée à serverPort (une par worker)
+static int setup_udp_socket(void) {
+    int udp_socket = socket(PF_INET, SOCK_DGRAM, 0);
+    if (udp_socket == -1) {
+        perror("Erreur création socket UDP");
+        return -1;
+    }
+
+    // Toutes les sockets des workers partagent le même port : le noyau
+    // répartit les datagrammes par hachage de l'adresse source, donc un
+    // client donné est toujours servi par le même worker
+    int opt = 1;
+    if (setsockopt(udp_socket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("Erreur SO_REUSEPORT");
+        close(udp_socket);
+        return -1;
+    }
+
+    // Timeout de réception pour que les workers vérifient régulièrement `running`
+    struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(udp_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_in aL;
+    memset(&aL, 0, sizeof(aL));
+    aL.sin_family = AF_INET;
+    aL.sin_addr.s_addr = INADDR_ANY;
+    aL.sin_port = htons(serverPort);
+
+    if (bind(udp_socket, (struct sockaddr*) &aL, sizeof(aL)) < 0) {
+        perror("Erreur nommage socket UDP");
+        close(udp_socket);
+        return -1;
+    }
+    return udp_socket;
+}
+
+// Traite un datagramme sous le verrou d'état (écriture si la commande modifie l'état)
+static void dispatch_datagram(char *buffer, size_t len, struct sockaddr_in aE, socklen_t lgA) {
+    if (wire_is_frame(buffer, len)) {
+        // Les opérations binaires ne modifient pas l'état partagé
+        pthread_rwlock_rdlock(&state_lock);
+        handle_binary_frame((const uint8_t *)buffer, len, aE, lgA);
+        pthread_rwlock_unlock(&state_lock);
+        return;
+    }
+    size_t token_len;
+    const ServerCommand *cmd = find_command(buffer, &token_len);
+    if (cmd->flags & CMD_MUTATES) pthread_rwlock_wrlock(&state_lock);
+    else pthread_rwlock_rdlock(&state_lock);
+    handle_datagram(cmd, buffer, token_len, aE, lgA);
+    pthread_rwlock_unlock(&state_lock);
+    run_archive_request();
+    run_pending_login();
+}
+
+// Trame de la couche fiable : acquittements et remise en ordre sous le
+// verrou du pair, puis chaque message délivré est traité comme un datagramme
+// ordinaire. Une trame d'une autre époque (session fiable précédente,
+// serveur redémarré, login sans la couche) est ignorée, et le client
+// apprend l'époque en cours plutôt que de réémettre sans fin
+static void handle_reliable_frame(const char *frame, size_t len, struct sockaddr_in aE, socklen_t lgA) {
+    RelMsg msgs[REL_MAX_DELIVER];
+    int n = 0;
+    uint32_t epoch;
+    if (frame[1] == 'E' || !rel_frame_epoch(frame, len, &epoch)) return;
+    pthread_rwlock_rdlock(&state_lock);
+    int idx = find_client_index(&aE);
+    ClientInfo *c = idx >= 0 ? client_at(idx) : NULL;
+    reply_coalesce = c && c->batch;
+    if (c && c->rel && c->rel->epoch == epoch) {
+        c->last_seen = now_tick();  // un simple acquittement prouve aussi que le client est là
+        pthread_mutex_lock(&c->rel->lock);
+        n = rel_receive(c->rel, frame, len, now_ms(), msgs, rel_sendto, c);
+        uint64_t deadline = rel_deadline(c->rel);
+        pthread_mutex_unlock(&c->rel->lock);
+        arm_rel_timer(c, deadline);
+    } else {
+        announce_rel_epoch(&aE, lgA, c ? c->rel : NULL);
+    }
+    pthread_rwlock_unlock(&state_lock);
+
+    for (int i = 0; i < n; i++) {
+        dispatch_datagram(msgs[i].data, msgs[i].len, aE, lgA);
+        free(msgs[i].data);
+    }
+}
+
+// Liste des clients dont l'échéance fiable est passée (worker 0 uniquement)
+static int *rel_due = NULL;
+static int rel_due_count = 0, rel_due_capacity = 0;
+
+static void collect_rel_due(TimerNode *node, void *arg) {
+    (void)arg;
+    if (rel_due_count == rel_due_capacity) {
+        int capacity = rel_due_capacity ? rel_due_capacity * 2 : 64;
+        int *due = realloc(rel_due, capacity * sizeof(int));
+        if (!due) return;
+        rel_due = due;
+        rel_due_capacity = capacity;
+    }
+    rel_due[rel_due_count++] = node->id;
+}
+
+// Retransmissions et acquittements différés échus (worker 0). Les clients
+// concernés sont d'abord relevés sous rel_timers_lock, puis traités un par
+// un sous leur propre verrou
+static void pump_reliable_timers(void) {
+    uint64_t now = now_ms();
+    // Seul le worker 0 modifie rel_timers.now : lecture sans verrou
+    if (now / REL_TICK_MS <= rel_timers.now) return;
+
+    pthread_rwlock_rdlock(&state_lock);
+    pthread_mutex_lock(&rel_timers_lock);
+    rel_due_count = 0;
+    timerwheel_advance(&rel_timers, now / REL_TICK_MS, collect_rel_due, NULL);
+    pthread_mutex_unlock(&rel_timers_lock);
+
+    for (int i = 0; i < rel_due_count; i++) {
+        ClientInfo *c = client_at(rel_due[i]);
+        if (!c->rel) continue;
+        pthread_mutex_lock(&c->rel->lock);
+        uint64_t deadline = rel_tick(c->rel, now, rel_sendto, c);
+        pthread_mutex_unlock(&c->rel->lock);
+        arm_rel_timer(c, deadline);
+    }
+    pthread_rwlock_unlock(&state_lock);
+}
+
+// Boucle d'un worker UDP : réception sur sa propre socket puis traitement
+static void *udp_worker_main(void *arg) {
+    UdpWorker *w = (UdpWorker *)arg;
+    dS_udp = w->sock;
+
+    // Épinglage du worker sur un cœur
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu > 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->id % ncpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    // Anneau de réception préalloué : RECV_BATCH tampons et adresses,
+    // remplis par un seul appel recvmmsg puis tous traités avant le suivant
+    char (*bufs)[BUFFER_SIZE] = malloc(RECV_BATCH * sizeof(*bufs));
+    struct sockaddr_in addrs[RECV_BATCH];
+    struct iovec iovs[RECV_BATCH];
+    struct mmsghdr msgs[RECV_BATCH];
+    if (!bufs) {
+        perror("malloc tampons de réception");
+        return NULL;
+    }
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < RECV_BATCH; i++) {
+        iovs[i].iov_base = bufs[i];
+        iovs[i].iov_len  = BUFFER_SIZE - 2;
+        msgs[i].msg_hdr.msg_iov    = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name   = &addrs[i];
+    }
+
+    // Messages sortants regroupés par destinataire pendant un tour de boucle
+    Outbox ob;
+    if (!outbox_init(&ob, dS_udp)) {
+        perror("malloc outbox");
+        free(bufs);
+        return NULL;
+    }
+    outbox = &ob;
+
+    while (running) {
+        // Fenêtre de regroupement : tant qu'elle n'est pas écoulée, on attend
+        // d'autres datagrammes au plus jusqu'à son terme, puis on envoie
+        if (outbox_pending(&ob)) {
+            uint64_t waited = now_us() - ob.first_at;
+            struct pollfd pfd = { .fd = dS_udp, .events = POLLIN };
+            struct timespec left = { 0, 0 };
+            if (waited < (uint64_t)COALESCE_WINDOW_US) {
+                uint64_t us = COALESCE_WINDOW_US - waited;
+                left.tv_sec = us / 1000000;
+                left.tv_nsec = (us % 1000000) * 1000;
+            }
+            if (ppoll(&pfd, 1, &left, NULL) <= 0) {
+                outbox_flush(&ob);
+                continue;
             }
         }
-        else if (strncmp(buffer, CREDITS_CMD, strlen(CREDITS_CMD)) == 0) {
-            FILE *file = fopen("credits.txt", "r");
-            if (file == NULL) {
-                char error_msg[] = "Erreur : impossible d'ouvrir le fichier credits.txt\n";
-                sendto(dS_udp, error_msg, strlen(error_msg), 0, (struct sockaddr*)&aE, lgA);
-            } 
-            else {
-                char line[512];
-                // Lire et envoyer ligne par ligne
-                while (fgets(line, sizeof(line), file)) {
-                    sendto(dS_udp, line, strlen(line), 0, (struct sockaddr*)&aE, lgA);
-                }
-                fclose(file);
+
+        for (int i = 0; i < RECV_BATCH; i++) {
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        }
+        // MSG_WAITFORONE : bloque pour le premier datagramme seulement
+        int n = recvmmsg(dS_udp, msgs, RECV_BATCH, MSG_WAITFORONE, NULL);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("recvmmsg");
+            n = 0;  // rien reçu : on passe quand même aux minuteurs
+        }
+
+        for (int i = 0; i < n; i++) {
+            char *buffer = bufs[i];
+            // Datagramme plus long que le tampon : tronqué, il n'est ni traité
+            // ni acquitté (la couche fiable le croirait reçu en entier)
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) continue;
+            // Double terminaison : "commande + strlen(commande) + 1" reste
+            // une chaîne vide quand la commande arrive sans argument
+            buffer[msgs[i].msg_len] = '\0';
+            buffer[msgs[i].msg_len + 1] = '\0';
+
+            if (rel_is_frame(buffer, msgs[i].msg_len)) {
+                handle_reliable_frame(buffer, msgs[i].msg_len, addrs[i], msgs[i].msg_hdr.msg_namelen);
+            } else {
+                dispatch_datagram(buffer, msgs[i].msg_len, addrs[i], msgs[i].msg_hdr.msg_namelen);
             }
         }
-        else {
-            // Message standard, format non reconnu
-            printf("Message standard reçu\n");
-            
-            // Informer l'expéditeur que le format du message n'est pas reconnu
-            char help_msg[BUFFER_SIZE] = 
-                "Format non reconnu. Commandes disponibles:\n"
-                "@message &destinataire message - Envoyer un message privé\n"
-                "@createroom nom_salle max_membres - Créer une salle\n"
-                "@joinroom nom_salle - Rejoindre une salle\n"
-                "@leaveroom nom_salle - Quitter une salle\n"
-                "@listrooms - Lister les salles disponibles\n"
-                "@listmembers nom_salle - Lister les membres d'une salle\n"
-                "@roomsg nom_salle message - Envoyer un message à une salle\n"
-                "@upload nom_fichier - Envoyer un fichier au serveur\n"
-                "@download nom_fichier - Télécharger un fichier du serveur\n"
-                "@help - Liste de toutes les commandes\n";
-            
-            sendto(dS_udp, help_msg, strlen(help_msg), 0, (struct sockaddr*)&aE, lgA);
+
+        // Le timeout de réception (REL_TICK_MS pour le worker 0) garantit
+        // des passages réguliers même sans trafic
+        if (w->id == 0) {
+            pump_reliable_timers();
+            expire_idle_sessions();
+        }
+
+        // Sans fenêtre, tout part à la fin du tour de boucle
+        if (outbox_pending(&ob) && now_us() - ob.first_at >= (uint64_t)COALESCE_WINDOW_US) {
+            outbox_flush(&ob);
         }
     }
-    
-    // Cette partie ne sera jamais atteinte en raison de la boucle infinie
-    // mais elle est incluse pour compléter le code
-    
-    // Libération des ressources
-    for (int i = 0; i < room_count; i++) {
-        chatroom_free(rooms[i]);
+
+    outbox_flush(&ob);
+    outbox = NULL;
+    pthread_mutex_lock(&batch_stats_lock);
+    batch_messages += ob.messages;
+    batch_datagrams += ob.datagrams;
+    pthread_mutex_unlock(&batch_stats_lock);
+    outbox_destroy(&ob);
+    free(bufs);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    printf("Début programme serveur\n");
+
+    // Options : -w nb_workers (0 = un par cœur), -t délai d'inactivité (s),
+    // -b fenêtre de regroupement des messages (µs), -n et -m : messages et
+    // octets d'historique conservés par salle, -l dossier du journal ("-"
+    // le désactive), -s taille d'un segment (Mo), -r rétention (heures),
+    // -c intervalle entre deux points de reprise du WAL d'état (s), -a threads
+    // de vérification des mots de passe (0 = dans le worker), -k itérations PBKDF2,
+    // -x réacteurs du serveur de fichiers
+    const char *log_dir = CHATLOG_DIR;
+    int opt;
+    while ((opt = getopt(argc, argv, "w:t:b:n:m:l:s:r:c:a:k:x:f:")) != -1) {
+        switch (opt) {
+            case 'w': UDP_WORKERS = atoi(optarg); break;
+            case 't': SESSION_TIMEOUT = atoi(optarg); break;
+            case 'b': COALESCE_WINDOW_US = atoi(optarg); break;
+            case 'n': ROOM_HISTORY_MESSAGES = atoi(optarg); break;
+            case 'm': ROOM_HISTORY_BYTES = atoi(optarg); break;
+            case 'l': log_dir = optarg; break;
+            case 's': LOG_SEGMENT_MB = atoi(optarg); break;
+            case 'r': LOG_RETENTION_HOURS = atoi(optarg); break;
+            case 'c': CHECKPOINT_INTERVAL = atoi(optarg); break;
+            case 'a': AUTH_THREADS = atoi(optarg); break;
+            case 'k': KDF_ITERATIONS = atoi(optarg); break;
+            case 'x': XFER_THREADS = atoi(optarg); break;
+            case 'f': XFER_MAX_FILE_MB = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-w nb_workers] [-t timeout_session] [-b fenetre_us] [-n messages_historique] [-m octets_historique] [-l dossier_journal|-] [-s segment_mo] [-r retention_heures] [-c reprise_s] [-a threads_auth] [-k iterations_kdf] [-x reacteurs_fichiers] [-f fichier_max_mio]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (UDP_WORKERS <= 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        UDP_WORKERS = ncpu > 0 ? (int)ncpu : 1;
+    }
+    if (SESSION_TIMEOUT <= 0) SESSION_TIMEOUT = 90;
+    if (COALESCE_WINDOW_US < 0) COALESCE_WINDOW_US = 0;
+    if (ROOM_HISTORY_MESSAGES < 0 || ROOM_HISTORY_BYTES <= 0) ROOM_HISTORY_MESSAGES = 0;
+    if (LOG_SEGMENT_MB <= 0) LOG_SEGMENT_MB = 16;
+    if (LOG_RETENTION_HOURS < 0) LOG_RETENTION_HOURS = 0;
+    if (CHECKPOINT_INTERVAL < 0) CHECKPOINT_INTERVAL = 0;
+    if (AUTH_THREADS < 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        AUTH_THREADS = ncpu > 0 ? (int)ncpu : 1;
+    }
+    if (KDF_ITERATIONS <= 0) KDF_ITERATIONS = 100000;
+    if (XFER_THREADS <= 0) XFER_THREADS = 1;
+    if (XFER_MAX_FILE_MB <= 0) XFER_MAX_FILE_MB = 4096;
+
+    // Configuration du gestionnaire de signaux
+    signal(SIGINT,  handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    // Création du dossier uploads s'il n'existe pas
+    mkdir("uploads", 0777);
+    mkdir("downloads", 0777);
+
+    // Création et configuration de la socket TCP
+    dS_tcp = setup_tcp_socket();
+    if (dS_tcp == -1) {
+        exit(EXIT_FAILURE);
+    }
+    printf("Socket TCP Créée et configurée sur le port %d\n", TCP_PORT);
+
+    // Création des sockets UDP des workers, toutes liées à serverPort
+    UdpWorker *workers = calloc(UDP_WORKERS, sizeof(UdpWorker));
+    for (int i = 0; i < UDP_WORKERS; i++) {
+        workers[i].id = i;
+        workers[i].sock = setup_udp_socket();
+        if (workers[i].sock == -1) {
+            for (int j = 0; j < i; j++) close(workers[j].sock);
+            close(dS_tcp);
+            exit(EXIT_FAILURE);
+        }
+    }
+    printf("%d socket(s) UDP bindée(s) sur port %d\n", UDP_WORKERS, serverPort);
+
+    // Le worker 0 fait avancer les minuteurs de la couche fiable : il doit
+    // se réveiller à chaque tick même sans trafic
+    struct timeval rel_tv = { .tv_sec = 0, .tv_usec = REL_TICK_MS * 1000 };
+    setsockopt(workers[0].sock, SOL_SOCKET, SO_RCVTIMEO, &rel_tv, sizeof(rel_tv));
+
+    // Initialisation des structures
+    users_dict = dict_create_arena();
+    dict_insert(users_dict, "admin", "admin");   // en clair : remplacé par son empreinte au premier login
+    rooms = rooms_create();
+    room_names = nameindex_create();
+    addr_index = addrindex_create();
+    name_index = nameindex_create();
+    clients = clients_create();
+    timerwheel_init(&session_timers, now_tick());
+    timerwheel_init(&rel_timers, now_ms() / REL_TICK_MS);
+    rel_epoch_last = (uint32_t)time(NULL);
+    if (!cmdhash_build(&command_hash, command_tokens, COMMAND_COUNT)) {
+        fprintf(stderr, "Erreur: table des commandes invalide (jeton en double ?)\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Chargement des utilisateurs et des salles : instantané binaire (ou,
+    // à défaut, anciens fichiers texte) puis WAL
+    uint64_t load_start = now_us();
+    if (!load_state_snapshot(STATE_SNAPSHOT_FILE)) {
+        load_users_from_file("users.txt");
+        load_rooms_from_file("rooms.txt");
+    }
+    int replayed = wal_replay(STATE_WAL_FILE, apply_wal_record, NULL);
+    if (replayed) printf("WAL : %d modification(s) rejouée(s) depuis %s\n", replayed, STATE_WAL_FILE);
+    printf("État chargé en %.1f ms (%zu compte(s), %d salle(s))\n",
+           (now_us() - load_start) / 1000.0, users_dict->count, rooms->used);
+
+    // Créer un processus fils pour gérer les transferts de fichiers
+    // (avant la création des threads : fork ne duplique que le thread appelant)
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Processus fils : gère les transferts de fichiers
+        signal(SIGINT,  SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        for (int i = 0; i < UDP_WORKERS; i++) close(workers[i].sock);  // Le fils n'a pas besoin des sockets UDP
+        xfer_serve(dS_tcp, XFER_THREADS);
+        exit(0);
+    }
+    else if (pid < 0) {
+        perror("Erreur fork");
+        for (int i = 0; i < UDP_WORKERS; i++) close(workers[i].sock);
+        close(dS_tcp);
+        exit(EXIT_FAILURE);
+    }
+
+    // WAL d'état (après le fork : le fils n'en a pas besoin). Un premier
+    // point de reprise intègre les modifications rejouées à l'instantané et
+    // repart d'un WAL vide (sans une éventuelle dernière ligne déchirée)
+    state_wal = wal_open(STATE_WAL_FILE);
+    if (state_wal) {
+        if (state_wal->size) checkpoint_state(NULL);
+        if (!wal_start(state_wal, checkpoint_state, NULL, CHECKPOINT_INTERVAL, WAL_CHECKPOINT_BYTES)) {
+            wal_close(state_wal);
+            state_wal = NULL;
+        }
+    }
+    if (!state_wal) fprintf(stderr, "Erreur: WAL '%s' inutilisable, état sauvegardé à l'arrêt seulement\n", STATE_WAL_FILE);
+
+    // Journal des messages (après le fork : le fils n'en a pas besoin)
+    if (strcmp(log_dir, "-") != 0) {
+        chat_log = chatlog_open(log_dir, (size_t)LOG_SEGMENT_MB << 20, LOG_RETENTION_HOURS);
+        if (!chat_log) {
+            fprintf(stderr, "Erreur: journal '%s' inutilisable, messages non journalisés\n", log_dir);
+        } else {
+            printf("Journal des messages dans '%s' (%d segment(s))\n", log_dir, chat_log->seg_count);
+        }
+    }
+
+    // Pool de vérification des mots de passe (après le fork, comme les workers)
+    if (AUTH_THREADS > 0) {
+        auth_pool = workpool_create(AUTH_THREADS, AUTH_QUEUE_MAX, AUTH_NICE);
+        if (!auth_pool) fprintf(stderr, "Erreur: pool d'authentification indisponible, vérification dans les workers\n");
     }
+
+    // Lancement des workers UDP
+    for (int i = 0; i < UDP_WORKERS; i++) {
+        if (pthread_create(&workers[i].tid, NULL, udp_worker_main, &workers[i]) != 0) {
+            perror("pthread_create worker UDP");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    printf("Serveur prêt (%d worker(s), %d thread(s) d'authentification), en attente de messages...\n",
+           UDP_WORKERS, auth_pool ? auth_pool->thread_count : 0);
+    fflush(stdout);
+
+    // Attente de l'arrêt (signal ou @shutdown)
+    for (int i = 0; i < UDP_WORKERS; i++) {
+        pthread_join(workers[i].tid, NULL);
+    }
+
+    // Les connexions en cours de vérification se terminent, celles en file sont abandonnées
+    if (auth_pool) {
+        workpool_stop(auth_pool);
+        printf("Authentification : %lu connexion(s) vérifiée(s), %lu refusée(s) (file pleine), %lu abandonnée(s), file max %d\n",
+               auth_pool->done, auth_pool->rejected, auth_pool->discarded, auth_pool->peak);
+        workpool_free(auth_pool);
+        auth_pool = NULL;
+    }
+
+    // Arrêt du processus de transfert de fichiers
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+
+    // Dernier point de reprise puis libération des ressources
+    if (state_wal) {
+        wal_stop(state_wal);
+        checkpoint_state(NULL);
+        printf("WAL : %lu modification(s) en %lu écriture(s) groupée(s), %lu point(s) de reprise, %lu erreur(s)\n",
+               state_wal->records, state_wal->commits, state_wal->checkpoints, state_wal->write_errors);
+        wal_close(state_wal);
+        state_wal = NULL;
+    } else {
+        save_state_snapshot(STATE_SNAPSHOT_FILE);
+    }
+    unsigned long send_errors = 0;
+    for (int i = 0; i < rooms->high_water; i++) {
+        if (room_at(i)->active) send_errors += room_at(i)->send_errors;
+    }
+    printf("Envois en échec lors des diffusions : %lu\n", send_errors);
+    for (int i = 0; i < clients->high_water; i++) {
+        if (client_at(i)->in_use && client_at(i)->active) drop_reliable_peer(client_at(i));
+    }
+    printf("Couche fiable : %lu retransmission(s), %lu doublon(s) écarté(s), %lu message(s) abandonné(s)\n",
+           rel_retransmits, rel_duplicates, rel_dropped);
+    printf("Regroupement : %lu message(s) en %lu datagramme(s)\n", batch_messages, batch_datagrams);
+    if (chat_log) {
+        // L'arrêt écrit les derniers messages en attente
+        ChatLog *log = chat_log;
+        chat_log = NULL;
+        chatlog_stop(log);
+        printf("Journal : %lu message(s) en %lu écriture(s) groupée(s), %lu perdu(s), %lu erreur(s)\n",
+               log->appended, log->commits, log->dropped, log->write_errors);
+        chatlog_close(log);
+    }
+    free(rel_due);
     dict_free(users_dict);
-    dict_free(room_dict);
-    free(clients);
-    close(dS_udp);
+    rooms_free(rooms);
+    nameindex_free(room_names);
+    addrindex_free(addr_index);
+    nameindex_free(name_index);
+    clients_free(clients);
+    for (int i = 0; i < UDP_WORKERS; i++) close(workers[i].sock);
+    free(workers);
     close(dS_tcp);
-    
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,122 @@
+/**
+ * Conversion entre les anciens fichiers texte de sauvegarde (users.txt,
+ * rooms.txt) et l'instantané binaire du serveur (snapshot.h).
+ * Usage : ./snapconv users.txt rooms.txt state.snap      texte → binaire
+ *         ./snapconv -d state.snap users.txt rooms.txt   binaire → texte
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "dict.h"
+#include "snapshot.h"
+#include "kdf.h"
+
+#define MAX_NAME 50
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s users.txt rooms.txt state.snap\n"
+                    "       %s -d state.snap users.txt rooms.txt\n", prog, prog);
+    exit(EXIT_FAILURE);
+}
+
+/* Texte → binaire : mêmes formats et mêmes règles que le chargement du serveur */
+static int to_snapshot(const char *users_file, const char *rooms_file, const char *snap_file) {
+    SimpleDict *users = dict_create_arena();
+    SnapWriter w;
+    snapwriter_init(&w);
+    char line[4096];
+
+    // Comptes : id:username:password (l'id est ignoré, un doublon remplace)
+    FILE *f = fopen(users_file, "r");
+    if (!f) {
+        perror(users_file);
+        dict_free(users);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        int id;
+        char username[MAX_NAME], password[KDF_RECORD_MAX];
+        if (sscanf(line, "%d:%49[^:]:%159s", &id, username, password) == 3) dict_insert(users, username, password);
+    }
+    fclose(f);
+    // Numéro de compte = position dans le dictionnaire
+    for (size_t i = 0; i < users->count; i++) snapwriter_add_user(&w, users->entries[i].key, users->entries[i].value);
+
+    // Salles : id:nom:max_membres:membre1,membre2,...[:créateur]
+    uint32_t *members = malloc(sizeof(line) / 2 * sizeof(uint32_t));
+    f = fopen(rooms_file, "r");
+    if (f && members) {
+        while (fgets(line, sizeof(line), f)) {
+            line[strcspn(line, "\n")] = '\0';
+            char *name = strchr(line, ':');
+            char *max = name ? strchr(name + 1, ':') : NULL;
+            char *list = max ? strchr(max + 1, ':') : NULL;
+            if (!list) continue;
+            *name++ = *max++ = *list++ = '\0';
+            char *owner = strchr(list, ':');
+            if (owner) *owner++ = '\0';
+            int max_members = atoi(max);
+            if (max_members <= 0) continue;
+
+            uint32_t count = 0;
+            for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+                long user = dict_index_of(users, tok);
+                if (user >= 0) members[count++] = (uint32_t)user;
+            }
+            snapwriter_add_room(&w, name, owner ? owner : "", max_members, members, count);
+        }
+        fclose(f);
+    } else if (!f) {
+        printf("%s absent : aucune salle\n", rooms_file);
+    }
+
+    int ok = snapwriter_commit(&w, snap_file);
+    if (ok) printf("%u compte(s), %u salle(s) écrits dans %s\n", w.user_count, w.room_count, snap_file);
+    free(members);
+    snapwriter_free(&w);
+    dict_free(users);
+    return ok;
+}
+
+/* Binaire → texte, pour relire ou éditer un instantané */
+static int to_text(const char *snap_file, const char *users_file, const char *rooms_file) {
+    Snapshot snap;
+    if (snapshot_open(&snap, snap_file) != 1) {
+        fprintf(stderr, "%s : instantané absent ou invalide\n", snap_file);
+        return 0;
+    }
+    FILE *u = fopen(users_file, "w");
+    FILE *r = fopen(rooms_file, "w");
+    if (!u || !r) {
+        perror("fopen");
+        if (u) fclose(u);
+        if (r) fclose(r);
+        snapshot_close(&snap);
+        return 0;
+    }
+    for (uint32_t i = 0; i < snap.header->user_count; i++) {
+        fprintf(u, "%u:%s:%s\n", i, snapshot_str(&snap, snap.users[i].name), snapshot_str(&snap, snap.users[i].password));
+    }
+    for (uint32_t i = 0; i < snap.header->room_count; i++) {
+        const SnapRoom *room = &snap.rooms[i];
+        fprintf(r, "%u:%s:%u:", i, snapshot_str(&snap, room->name), room->max_members);
+        for (uint32_t j = 0; j < room->member_count; j++) {
+            fprintf(r, "%s%s", j ? "," : "", snapshot_str(&snap, snap.users[snap.members[room->members + j]].name));
+        }
+        fprintf(r, ":%s\n", snapshot_str(&snap, room->owner));
+    }
+    printf("%u compte(s) dans %s, %u salle(s) dans %s\n",
+           snap.header->user_count, users_file, snap.header->room_count, rooms_file);
+    fclose(u);
+    fclose(r);
+    snapshot_close(&snap);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 5 && strcmp(argv[1], "-d") == 0) return to_text(argv[2], argv[3], argv[4]) ? 0 : 1;
+    if (argc == 4 && argv[1][0] != '-') return to_snapshot(argv[1], argv[2], argv[3]) ? 0 : 1;
+    usage(argv[0]);
+    return 1;
+}
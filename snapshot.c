@@ -0,0 +1,242 @@
+#define _GNU_SOURCE
+#include "snapshot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ALIGN8(x) (((x) + 7) & ~(uint64_t)7)
+
+/* Une chaîne de la table est-elle entière (terminée avant la fin) ? */
+static int valid_str(const Snapshot *s, uint32_t off) {
+    return off < s->header->strings_len &&
+           memchr(s->strings + off, '\0', s->header->strings_len - off) != NULL;
+}
+
+static int section_fits(uint64_t off, uint64_t count, uint64_t size, uint64_t file_size) {
+    return off % 8 == 0 && off <= file_size && (size == 0 || count <= (file_size - off) / size);
+}
+
+int snapshot_open(Snapshot *s, const char *path) {
+    memset(s, 0, sizeof(*s));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return errno == ENOENT ? 0 : (perror(path), -1);
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(SnapHeader)) {
+        fprintf(stderr, "Instantané %s : fichier tronqué\n", path);
+        close(fd);
+        return -1;
+    }
+    s->len = st.st_size;
+    s->map = mmap(NULL, s->len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (s->map == MAP_FAILED) {
+        perror(path);
+        s->map = NULL;
+        return -1;
+    }
+
+    const SnapHeader *h = s->header = (const SnapHeader *)s->map;
+    const char *problem = NULL;
+    if (memcmp(h->magic, SNAP_MAGIC, sizeof(h->magic)) != 0) problem = "format inconnu";
+    else if (h->version != SNAP_VERSION) problem = "version non prise en charge";
+    else if (h->header_size != sizeof(SnapHeader) || h->file_size != s->len) problem = "taille incohérente";
+    else if (!section_fits(h->strings_off, h->strings_len, 1, s->len) ||
+             !section_fits(h->users_off, h->user_count, sizeof(SnapUser), s->len) ||
+             !section_fits(h->rooms_off, h->room_count, sizeof(SnapRoom), s->len) ||
+             !section_fits(h->members_off, h->member_total, sizeof(uint32_t), s->len)) problem = "section hors du fichier";
+    if (!problem) {
+        s->strings = s->map + h->strings_off;
+        s->users = (const SnapUser *)(s->map + h->users_off);
+        s->rooms = (const SnapRoom *)(s->map + h->rooms_off);
+        s->members = (const uint32_t *)(s->map + h->members_off);
+        if (h->strings_len == 0 || s->strings[h->strings_len - 1] != '\0') problem = "table des chaînes invalide";
+    }
+    for (uint32_t i = 0; !problem && i < h->user_count; i++) {
+        if (!valid_str(s, s->users[i].name) || !valid_str(s, s->users[i].password)) problem = "compte invalide";
+    }
+    for (uint32_t i = 0; !problem && i < h->room_count; i++) {
+        const SnapRoom *r = &s->rooms[i];
+        if (!valid_str(s, r->name) || !valid_str(s, r->owner) ||
+            r->members > h->member_total || r->member_count > h->member_total - r->members) {
+            problem = "salle invalide";
+            break;
+        }
+        for (uint32_t j = 0; j < r->member_count; j++) {
+            if (s->members[r->members + j] >= h->user_count) {
+                problem = "membre invalide";
+                break;
+            }
+        }
+    }
+    if (problem) {
+        fprintf(stderr, "Instantané %s : %s\n", path, problem);
+        snapshot_close(s);
+        return -1;
+    }
+    return 1;
+}
+
+void snapshot_close(Snapshot *s) {
+    if (s->map) munmap((void *)s->map, s->len);
+    memset(s, 0, sizeof(*s));
+}
+
+void snapwriter_init(SnapWriter *w) {
+    memset(w, 0, sizeof(*w));
+}
+
+void snapwriter_free(SnapWriter *w) {
+    free(w->strings);
+    free(w->users);
+    free(w->rooms);
+    free(w->members);
+    memset(w, 0, sizeof(*w));
+}
+
+/* Agrandit *buf pour au moins need éléments de size octets, 0 si erreur */
+static int grow(void **buf, uint64_t *capacity, uint64_t need, size_t size) {
+    if (need <= *capacity) return 1;
+    uint64_t c = *capacity ? *capacity : 64;
+    while (c < need) c *= 2;
+    void *p = realloc(*buf, c * size);
+    if (!p) return 0;
+    *buf = p;
+    *capacity = c;
+    return 1;
+}
+
+static int grow32(void **buf, uint32_t *capacity, uint64_t need, size_t size) {
+    uint64_t c = *capacity;
+    if (need > UINT32_MAX || !grow(buf, &c, need, size)) return 0;
+    *capacity = (uint32_t)c;
+    return 1;
+}
+
+void snapwriter_reserve(SnapWriter *w, uint32_t users, size_t string_bytes) {
+    uint64_t capacity = w->strings_capacity;
+    if (!grow((void **)&w->strings, &capacity, w->strings_len + string_bytes, 1) ||
+        !grow32((void **)&w->users, &w->user_capacity, (uint64_t)w->user_count + users, sizeof(SnapUser))) {
+        w->error = 1;
+    }
+    w->strings_capacity = capacity;
+}
+
+/* Copie str dans la table des chaînes, retourne son décalage */
+static uint32_t add_string(SnapWriter *w, const char *str) {
+    size_t n = strlen(str) + 1;
+    uint64_t capacity = w->strings_capacity;
+    if (w->strings_len + n > UINT32_MAX || !grow((void **)&w->strings, &capacity, w->strings_len + n, 1)) {
+        w->error = 1;
+        return 0;
+    }
+    w->strings_capacity = capacity;
+    memcpy(w->strings + w->strings_len, str, n);
+    uint32_t off = (uint32_t)w->strings_len;
+    w->strings_len += n;
+    return off;
+}
+
+uint32_t snapwriter_add_user(SnapWriter *w, const char *name, const char *password) {
+    if (!grow32((void **)&w->users, &w->user_capacity, (uint64_t)w->user_count + 1, sizeof(SnapUser))) {
+        w->error = 1;
+        return 0;
+    }
+    SnapUser *u = &w->users[w->user_count];
+    u->name = add_string(w, name);
+    u->password = add_string(w, password);
+    return w->user_count++;
+}
+
+void snapwriter_add_room(SnapWriter *w, const char *name, const char *owner, uint32_t max_members,
+                         const uint32_t *members, uint32_t member_count) {
+    if (!grow32((void **)&w->rooms, &w->room_capacity, (uint64_t)w->room_count + 1, sizeof(SnapRoom)) ||
+        !grow((void **)&w->members, &w->member_capacity, w->member_total + member_count, sizeof(uint32_t))) {
+        w->error = 1;
+        return;
+    }
+    SnapRoom *r = &w->rooms[w->room_count++];
+    r->name = add_string(w, name);
+    r->owner = add_string(w, owner);
+    r->max_members = max_members;
+    r->member_count = member_count;
+    r->members = w->member_total;
+    memcpy(w->members + w->member_total, members, member_count * sizeof(uint32_t));
+    w->member_total += member_count;
+}
+
+/* Écrit n octets puis des zéros jusqu'au multiple de 8 suivant, 0 si erreur */
+static int write_section(FILE *f, const void *data, size_t n) {
+    static const char zeros[8];
+    if (n && fwrite(data, 1, n, f) != n) return 0;
+    size_t pad = ALIGN8(n) - n;
+    return pad == 0 || fwrite(zeros, 1, pad, f) == pad;
+}
+
+/*
+ * Rend le renommage durable : tant que le dossier n'est pas synchronisé, une
+ * coupure peut ramener l'ancien instantané alors que l'appelant a déjà vidé
+ * le journal (wal_reset). 0 si erreur.
+ */
+static int sync_parent_dir(const char *path) {
+    char dir[512];
+    const char *slash = strrchr(path, '/');
+    if (slash) snprintf(dir, sizeof(dir), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+    else strcpy(dir, ".");
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0 || fsync(fd) < 0) {
+        perror(dir);
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    close(fd);
+    return 1;
+}
+
+int snapwriter_commit(SnapWriter *w, const char *path) {
+    if (w->error) {
+        fprintf(stderr, "Instantané %s : mémoire insuffisante, non écrit\n", path);
+        return 0;
+    }
+    if (w->strings_len == 0) add_string(w, "");   // table jamais vide
+
+    SnapHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAP_MAGIC, sizeof(h.magic));
+    h.version = SNAP_VERSION;
+    h.header_size = sizeof(SnapHeader);
+    h.user_count = w->user_count;
+    h.room_count = w->room_count;
+    h.strings_off = ALIGN8(sizeof(SnapHeader));
+    h.strings_len = w->strings_len;
+    h.users_off = h.strings_off + ALIGN8(h.strings_len);
+    h.rooms_off = h.users_off + ALIGN8((uint64_t)w->user_count * sizeof(SnapUser));
+    h.members_off = h.rooms_off + ALIGN8((uint64_t)w->room_count * sizeof(SnapRoom));
+    h.member_total = w->member_total;
+    h.file_size = h.members_off + ALIGN8(w->member_total * sizeof(uint32_t));
+
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        perror(tmp);
+        return 0;
+    }
+    int ok = write_section(f, &h, sizeof(h)) &&
+             write_section(f, w->strings, w->strings_len) &&
+             write_section(f, w->users, (size_t)w->user_count * sizeof(SnapUser)) &&
+             write_section(f, w->rooms, (size_t)w->room_count * sizeof(SnapRoom)) &&
+             write_section(f, w->members, w->member_total * sizeof(uint32_t)) &&
+             fflush(f) == 0 && fsync(fileno(f)) == 0;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp, path) < 0) {
+        perror(path);
+        unlink(tmp);
+        return 0;
+    }
+    return sync_parent_dir(path);
+}
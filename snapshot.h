@@ -0,0 +1,105 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Instantané binaire de l'état persistant (comptes et salles), projeté en
+ * mémoire au démarrage : aucune analyse de texte, chaque enregistrement est
+ * lu directement dans la projection.
+ *
+ * Fichier (boutisme de la machine, sections alignées sur 8 octets) :
+ *   SnapHeader
+ *   table des chaînes   noms et mots de passe, chacun terminé par '\0'
+ *   SnapUser[user_count]
+ *   SnapRoom[room_count]
+ *   uint32_t[member_total]  membres de chaque salle : numéros de SnapUser
+ *
+ * Le fichier est écrit à côté puis renommé : il est toujours complet.
+ * snapshot_open vérifie la version et que tous les décalages restent dans
+ * le fichier ; l'appelant peut ensuite tout lire sans contrôle.
+ */
+
+#define SNAP_MAGIC "FARSNAP"     /* 7 caractères + '\0' */
+#define SNAP_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;        /* sizeof(SnapHeader) à l'écriture */
+    uint64_t file_size;
+    uint32_t user_count;
+    uint32_t room_count;
+    uint64_t strings_off, strings_len;
+    uint64_t users_off;
+    uint64_t rooms_off;
+    uint64_t members_off, member_total;
+} SnapHeader;
+
+typedef struct {
+    uint32_t name;               /* décalage dans la table des chaînes */
+    uint32_t password;
+} SnapUser;
+
+typedef struct {
+    uint32_t name;
+    uint32_t owner;
+    uint32_t max_members;
+    uint32_t member_count;
+    uint64_t members;            /* premier membre dans le tableau des membres */
+} SnapRoom;
+
+/* Instantané projeté en lecture seule */
+typedef struct {
+    const char *map;
+    size_t len;
+    const SnapHeader *header;
+    const char *strings;
+    const SnapUser *users;
+    const SnapRoom *rooms;
+    const uint32_t *members;
+} Snapshot;
+
+/*
+ * Projette l'instantané path. Retourne 1 si succès, 0 si le fichier
+ * n'existe pas, -1 s'il est invalide (message sur stderr).
+ */
+int snapshot_open(Snapshot *s, const char *path);
+
+void snapshot_close(Snapshot *s);
+
+static inline const char *snapshot_str(const Snapshot *s, uint32_t off) {
+    return s->strings + off;
+}
+
+/* Construction d'un instantané en mémoire, puis écriture en une fois */
+typedef struct {
+    char *strings;
+    size_t strings_len, strings_capacity;
+    SnapUser *users;
+    uint32_t user_count, user_capacity;
+    SnapRoom *rooms;
+    uint32_t room_count, room_capacity;
+    uint32_t *members;
+    uint64_t member_total, member_capacity;
+    int error;                   /* une allocation a échoué : snapwriter_commit refusera */
+} SnapWriter;
+
+void snapwriter_init(SnapWriter *w);
+void snapwriter_free(SnapWriter *w);
+
+/* Prévoit la place pour users comptes (évite les réallocations) */
+void snapwriter_reserve(SnapWriter *w, uint32_t users, size_t string_bytes);
+
+/* Ajoute un compte, retourne son numéro (utilisé dans les listes de membres) */
+uint32_t snapwriter_add_user(SnapWriter *w, const char *name, const char *password);
+
+/* Ajoute une salle et ses membres (numéros de comptes déjà ajoutés) */
+void snapwriter_add_room(SnapWriter *w, const char *name, const char *owner, uint32_t max_members,
+                         const uint32_t *members, uint32_t member_count);
+
+/* Écrit l'instantané dans path (fichier temporaire, fsync, renommage, fsync du dossier), 0 si erreur */
+int snapwriter_commit(SnapWriter *w, const char *path);
+
+#endif
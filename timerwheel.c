@@ -0,0 +1,93 @@
+#include "timerwheel.h"
+
+static void list_init(TimerNode *head) {
+    head->next = head->prev = head;
+}
+
+static void list_push(TimerNode *head, TimerNode *node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static void list_unlink(TimerNode *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = node->prev = node;
+}
+
+void timerwheel_init(TimerWheel *tw, uint64_t now) {
+    for (int i = 0; i < TW_L0_SIZE; i++) list_init(&tw->l0[i]);
+    for (int i = 0; i < TW_L1_SIZE; i++) list_init(&tw->l1[i]);
+    tw->now = now;
+}
+
+/* Range node dans la case correspondant à son échéance */
+static void timerwheel_place(TimerWheel *tw, TimerNode *node) {
+    // Une échéance passée est traitée au prochain tick
+    uint64_t at = node->expires > tw->now ? node->expires : tw->now + 1;
+    uint64_t delta = at - tw->now;
+    if (delta < TW_L0_SIZE) {
+        list_push(&tw->l0[at & (TW_L0_SIZE - 1)], node);
+    } else {
+        // Au-delà de l'horizon, on vise la dernière case atteignable :
+        // le minuteur sera reclassé à la redescente
+        if (delta >= TW_SPAN) at = tw->now + TW_SPAN - 1;
+        list_push(&tw->l1[(at >> TW_L0_BITS) & (TW_L1_SIZE - 1)], node);
+    }
+}
+
+void timerwheel_schedule(TimerWheel *tw, TimerNode *node, uint64_t expires) {
+    if (node->armed) list_unlink(node);
+    node->expires = expires;
+    node->armed = 1;
+    timerwheel_place(tw, node);
+}
+
+void timerwheel_cancel(TimerNode *node) {
+    if (!node->armed) return;
+    list_unlink(node);
+    node->armed = 0;
+}
+
+/* Redescend au niveau 0 les minuteurs d'une case du niveau 1 */
+static void timerwheel_cascade(TimerWheel *tw, TimerNode *head) {
+    TimerNode pending;
+    list_init(&pending);
+    // On détache toute la liste d'abord : place() peut réinsérer dans la même case
+    if (head->next != head) {
+        pending.next = head->next;
+        pending.prev = head->prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        list_init(head);
+    }
+    while (pending.next != &pending) {
+        TimerNode *node = pending.next;
+        list_unlink(node);
+        // Échu à ce tick : la case courante est traitée juste après
+        if (node->expires <= tw->now) list_push(&tw->l0[tw->now & (TW_L0_SIZE - 1)], node);
+        else timerwheel_place(tw, node);
+    }
+}
+
+int timerwheel_advance(TimerWheel *tw, uint64_t now,
+                       void (*fire)(TimerNode *node, void *arg), void *arg) {
+    int fired = 0;
+    while (tw->now < now) {
+        tw->now++;
+        if ((tw->now & (TW_L0_SIZE - 1)) == 0) {
+            timerwheel_cascade(tw, &tw->l1[(tw->now >> TW_L0_BITS) & (TW_L1_SIZE - 1)]);
+        }
+        TimerNode *head = &tw->l0[tw->now & (TW_L0_SIZE - 1)];
+        while (head->next != head) {
+            TimerNode *node = head->next;
+            list_unlink(node);
+            node->armed = 0;
+            fire(node, arg);
+            fired++;
+        }
+    }
+    return fired;
+}
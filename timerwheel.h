@@ -0,0 +1,52 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdint.h>
+
+#define TW_L0_BITS 8                       /* niveau 0 : 256 cases d'un tick */
+#define TW_L1_BITS 6                       /* niveau 1 : 64 cases de 256 ticks */
+#define TW_L0_SIZE (1 << TW_L0_BITS)
+#define TW_L1_SIZE (1 << TW_L1_BITS)
+#define TW_SPAN    ((uint64_t)TW_L0_SIZE * TW_L1_SIZE)  /* délai max sans recyclage */
+
+/**
+ * Minuteur intrusif : à placer dans la structure surveillée, qui ne doit
+ * pas être déplacée en mémoire tant que le minuteur est armé
+ */
+typedef struct TimerNode {
+    struct TimerNode *next, *prev;  /* chaînage dans une case de la roue */
+    uint64_t expires;               /* tick d'échéance */
+    int id;                         /* identifiant libre pour le propriétaire */
+    int armed;                      /* 1 si le minuteur est dans la roue */
+} TimerNode;
+
+/**
+ * Roue de minuteurs hiérarchique à deux niveaux : armer, désarmer et
+ * déclencher coûtent O(1) par minuteur, chaque tick ne parcourt que la case
+ * courante (et, tous les 256 ticks, une case du niveau 1 redescendue au
+ * niveau 0). Les délais au-delà de TW_SPAN sont reportés de tour en tour.
+ */
+typedef struct {
+    TimerNode l0[TW_L0_SIZE];       /* têtes de liste (sentinelles) du niveau 0 */
+    TimerNode l1[TW_L1_SIZE];       /* têtes de liste (sentinelles) du niveau 1 */
+    uint64_t now;                   /* dernier tick traité */
+} TimerWheel;
+
+/* Initialise une roue vide dont le tick courant est now */
+void timerwheel_init(TimerWheel *tw, uint64_t now);
+
+/* Arme (ou réarme) node pour le tick expires */
+void timerwheel_schedule(TimerWheel *tw, TimerNode *node, uint64_t expires);
+
+/* Désarme node s'il est armé */
+void timerwheel_cancel(TimerNode *node);
+
+/*
+ * Avance la roue jusqu'au tick now et appelle fire(node, arg) pour chaque
+ * minuteur échu (désarmé avant l'appel, fire peut le réarmer).
+ * Retourne le nombre de minuteurs déclenchés.
+ */
+int timerwheel_advance(TimerWheel *tw, uint64_t now,
+                       void (*fire)(TimerNode *node, void *arg), void *arg);
+
+#endif
@@ -0,0 +1,196 @@
+#define _GNU_SOURCE
+#include "wal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define WAL_INITIAL_BUFFER (64 * 1024)
+
+static int write_full(int fd, const void *buf, size_t n) {
+    const char *p = buf;
+    while (n) {
+        ssize_t k = write(fd, p, n);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += k;
+        n -= k;
+    }
+    return 1;
+}
+
+Wal *wal_open(const char *path) {
+    Wal *w = calloc(1, sizeof(Wal));
+    if (!w) return NULL;
+    w->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    w->pending_capacity = w->writing_capacity = WAL_INITIAL_BUFFER;
+    w->pending = malloc(w->pending_capacity);
+    w->writing = malloc(w->writing_capacity);
+    struct stat st;
+    if (w->fd < 0 || !w->pending || !w->writing || fstat(w->fd, &st) < 0) {
+        if (w->fd >= 0) close(w->fd);
+        free(w->pending);
+        free(w->writing);
+        free(w);
+        return NULL;
+    }
+    w->size = st.st_size;
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->wake, NULL);
+    return w;
+}
+
+void wal_append(Wal *w, const char *fmt, ...) {
+    char line[WAL_LINE_MAX];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+    va_end(ap);
+    if (len < 0) return;
+    if (len > (int)sizeof(line) - 2) len = sizeof(line) - 2;
+    line[len++] = '\n';
+
+    pthread_mutex_lock(&w->lock);
+    if (w->pending_len + len > w->pending_capacity) {
+        size_t capacity = w->pending_capacity * 2;
+        while (w->pending_len + len > capacity) capacity *= 2;
+        char *grown = realloc(w->pending, capacity);
+        if (!grown) {
+            // Plus de mémoire : écriture directe plutôt que perte
+            if (!write_full(w->fd, line, len)) w->write_errors++;
+            w->records++;
+            pthread_mutex_unlock(&w->lock);
+            return;
+        }
+        w->pending = grown;
+        w->pending_capacity = capacity;
+    }
+    memcpy(w->pending + w->pending_len, line, len);
+    // Le thread d'écriture n'attend que si le tampon était vide
+    if (w->pending_len == 0) pthread_cond_signal(&w->wake);
+    w->pending_len += len;
+    w->records++;
+    pthread_mutex_unlock(&w->lock);
+}
+
+void wal_reset(Wal *w) {
+    pthread_mutex_lock(&w->lock);
+    // L'instantané contient déjà les enregistrements en attente
+    w->pending_len = 0;
+    if (ftruncate(w->fd, 0) < 0) {
+        perror("ftruncate WAL");
+        w->write_errors++;
+    } else {
+        fdatasync(w->fd);
+        w->size = 0;
+        w->checkpoints++;
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+static uint64_t now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+static void *writer_main(void *arg) {
+    Wal *w = arg;
+    uint64_t last_checkpoint = now_sec();
+    for (;;) {
+        pthread_mutex_lock(&w->lock);
+        if (!w->pending_len && !w->stop) {
+            // Réveil au moins une fois par seconde pour les points de reprise
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += 1;
+            pthread_cond_timedwait(&w->wake, &w->lock, &deadline);
+        }
+        if (!w->pending_len && w->stop) {
+            pthread_mutex_unlock(&w->lock);
+            break;
+        }
+        // Les producteurs continuent dans l'autre tampon pendant l'écriture
+        char *batch = w->pending;
+        size_t n = w->pending_len, capacity = w->pending_capacity;
+        w->pending = w->writing;
+        w->pending_capacity = w->writing_capacity;
+        w->writing = batch;
+        w->writing_capacity = capacity;
+        w->pending_len = 0;
+        pthread_mutex_unlock(&w->lock);
+
+        if (n) {
+            if (!write_full(w->fd, batch, n) || fdatasync(w->fd) < 0) {
+                perror("Écriture WAL");
+                w->write_errors++;
+            } else {
+                w->size += n;
+                w->commits++;
+            }
+        }
+
+        uint64_t now = now_sec();
+        if (w->checkpoint && w->size &&
+            (w->size >= w->max_bytes || (w->interval_s && now - last_checkpoint >= w->interval_s))) {
+            w->checkpoint(w->checkpoint_ctx);
+            last_checkpoint = now;
+        }
+    }
+    return NULL;
+}
+
+int wal_start(Wal *w, WalCheckpoint checkpoint, void *ctx, unsigned interval_s, size_t max_bytes) {
+    w->checkpoint = checkpoint;
+    w->checkpoint_ctx = ctx;
+    w->interval_s = interval_s;
+    w->max_bytes = max_bytes;
+    if (pthread_create(&w->writer, NULL, writer_main, w) != 0) return 0;
+    w->writer_started = 1;
+    return 1;
+}
+
+void wal_stop(Wal *w) {
+    if (!w->writer_started) return;
+    pthread_mutex_lock(&w->lock);
+    w->stop = 1;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->writer, NULL);
+    w->writer_started = 0;
+}
+
+void wal_close(Wal *w) {
+    if (!w) return;
+    wal_stop(w);
+    close(w->fd);
+    free(w->pending);
+    free(w->writing);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->wake);
+    free(w);
+}
+
+int wal_replay(const char *path, void (*apply)(void *ctx, char *record), void *ctx) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    char line[WAL_LINE_MAX + 1];
+    int replayed = 0;
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strlen(line);
+        // Sans '\n' : dernière ligne déchirée par un arrêt brutal
+        if (len == 0 || line[len - 1] != '\n') break;
+        line[len - 1] = '\0';
+        apply(ctx, line);
+        replayed++;
+    }
+    fclose(f);
+    return replayed;
+}
@@ -0,0 +1,87 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/**
+ * Journal d'écriture anticipée (WAL) de l'état persistant du serveur :
+ * comptes et salles. Chaque modification y est ajoutée sous forme d'une
+ * ligne de texte (un enregistrement) ; l'instantané de l'état (snapshot.h)
+ * n'est réécrit qu'aux points de reprise.
+ *
+ * Comme pour le journal des messages (chatlog.h), wal_append ne fait que
+ * copier la ligne dans un tampon : un thread d'écriture l'envoie avec les
+ * autres lignes en attente d'un seul write puis d'un seul fdatasync. Le
+ * tampon grandit au lieu de perdre un enregistrement.
+ *
+ * Point de reprise : quand le WAL dépasse max_bytes octets ou que
+ * interval_s secondes se sont écoulées depuis le précédent, le thread
+ * d'écriture appelle checkpoint(ctx). Celle-ci écrit l'instantané en
+ * empêchant toute modification, puis appelle wal_reset pour vider le WAL.
+ *
+ * Reprise au démarrage : chargement de l'instantané puis wal_replay. Les
+ * enregistrements doivent être idempotents (« l'utilisateur X a le mot de
+ * passe Y », « X est membre de S »...) : un arrêt brutal entre l'écriture
+ * de l'instantané et la remise à zéro du WAL est alors sans effet. Une
+ * dernière ligne incomplète (écriture déchirée) est ignorée.
+ */
+
+#define WAL_LINE_MAX 512     /* taille max d'un enregistrement, '\n' compris */
+
+typedef void (*WalCheckpoint)(void *ctx);
+
+typedef struct {
+    int fd;
+    size_t size;              /* octets écrits dans le fichier */
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    char *pending, *writing;  /* tampon des producteurs, tampon en cours d'écriture */
+    size_t pending_len, pending_capacity, writing_capacity;
+    int stop;
+    pthread_t writer;
+    int writer_started;
+
+    WalCheckpoint checkpoint;
+    void *checkpoint_ctx;
+    unsigned interval_s;
+    size_t max_bytes;
+
+    /* Statistiques */
+    unsigned long records, commits, checkpoints, write_errors;
+} Wal;
+
+/* Ouvre (ou crée) le WAL de chemin path en ajout, NULL si erreur */
+Wal *wal_open(const char *path);
+
+/*
+ * Lance le thread d'écriture et ses points de reprise (interval_s = 0 :
+ * seulement sur la taille). checkpoint est appelée depuis ce thread.
+ */
+int wal_start(Wal *w, WalCheckpoint checkpoint, void *ctx, unsigned interval_s, size_t max_bytes);
+
+/* Ajoute un enregistrement (format printf, sans '\n') sans attendre le disque */
+void wal_append(Wal *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/*
+ * Vide le WAL : à appeler dans checkpoint (ou avant wal_start) une fois
+ * l'instantané durable, tant que plus aucun enregistrement ne peut arriver
+ */
+void wal_reset(Wal *w);
+
+/* Écrit les enregistrements en attente puis arrête le thread d'écriture */
+void wal_stop(Wal *w);
+
+/* Arrête le WAL s'il ne l'est pas et le libère */
+void wal_close(Wal *w);
+
+/*
+ * Rejoue les enregistrements complets du fichier path dans l'ordre :
+ * apply reçoit chaque ligne sans '\n' (modifiable). Retourne le nombre de
+ * lignes rejouées, 0 si le fichier n'existe pas.
+ */
+int wal_replay(const char *path, void (*apply)(void *ctx, char *record), void *ctx);
+
+#endif
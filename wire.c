@@ -0,0 +1,143 @@
+#include "wire.h"
+#include <string.h>
+
+int wire_is_frame(const void *buf, size_t len) {
+    return len >= 2 && ((const uint8_t *)buf)[0] == WIRE_VERSION;
+}
+
+void wire_begin(WireWriter *w, void *buf, size_t cap, uint8_t op) {
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->overflow = cap < 2;
+    if (!w->overflow) {
+        w->buf[w->len++] = WIRE_VERSION;
+        w->buf[w->len++] = op;
+    }
+}
+
+void wire_put_varint(WireWriter *w, uint64_t v) {
+    do {
+        if (w->len == w->cap) {
+            w->overflow = 1;
+            return;
+        }
+        uint8_t byte = v & 0x7f;
+        v >>= 7;
+        w->buf[w->len++] = byte | (v ? 0x80 : 0);
+    } while (v);
+}
+
+void wire_put_bytes(WireWriter *w, const void *data, size_t len) {
+    wire_put_varint(w, len);
+    if (w->overflow || w->cap - w->len < len) {
+        w->overflow = 1;
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+void wire_put_str(WireWriter *w, const char *s) {
+    wire_put_bytes(w, s, strlen(s));
+}
+
+uint8_t wire_open(WireReader *r, const void *buf, size_t len) {
+    r->buf = buf;
+    r->len = len;
+    r->pos = 2;
+    r->error = len < 2;
+    return r->error ? 0 : r->buf[1];
+}
+
+uint64_t wire_get_varint(WireReader *r) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (r->pos >= r->len) break;
+        uint8_t byte = r->buf[r->pos++];
+        v |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return v;
+    }
+    r->error = 1;
+    return 0;
+}
+
+void wire_get_str(WireReader *r, char *out, size_t cap) {
+    uint64_t len = wire_get_varint(r);
+    if (r->error || len >= cap || len > r->len - r->pos) {
+        r->error = 1;
+        if (cap) out[0] = '\0';
+        return;
+    }
+    memcpy(out, r->buf + r->pos, len);
+    out[len] = '\0';
+    r->pos += len;
+}
+
+static void put_u64(uint8_t *out, uint64_t v) {
+    for (int i = 0; i < 8; i++) out[i] = v >> (56 - 8 * i);
+}
+
+static uint64_t get_u64(const uint8_t *in) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v = v << 8 | in[i];
+    return v;
+}
+
+void wire_xfer_pack(uint8_t out[WIRE_XFER_HEADER], const WireXferHeader *h) {
+    memset(out, 0, WIRE_XFER_HEADER);
+    out[0] = WIRE_XFER_VERSION;
+    out[1] = h->op;
+    out[2] = h->status;
+    out[4] = h->name_len >> 8;
+    out[5] = h->name_len & 0xff;
+    put_u64(out + 8, h->offset);
+    put_u64(out + 16, h->length);
+    put_u64(out + 24, h->total);
+    put_u64(out + 32, h->digest);
+}
+
+int wire_xfer_unpack(const uint8_t in[WIRE_XFER_HEADER], WireXferHeader *h) {
+    if (in[0] != WIRE_XFER_VERSION) return 0;
+    h->op = in[1];
+    h->status = in[2];
+    h->name_len = (uint16_t)(in[4] << 8 | in[5]);
+    h->offset = get_u64(in + 8);
+    h->length = get_u64(in + 16);
+    h->total = get_u64(in + 24);
+    h->digest = get_u64(in + 32);
+    return h->name_len <= WIRE_XFER_NAME_MAX;
+}
+
+const char *wire_xfer_status(uint8_t op, uint8_t status) {
+    switch (status) {
+    case XST_OK:          return op == XOP_FILE ? "FILE_SEND_START" : "FILE_RECEIVED_OK";
+    case XST_NOT_FOUND:   return "FILE_NOT_FOUND";
+    case XST_OPEN_ERROR:  return "FILE_OPEN_ERROR";
+    case XST_WRITE_ERROR: return "FILE_WRITE_ERROR";
+    case XST_INCOMPLETE:  return "FILE_INCOMPLETE";
+    case XST_BAD_REQUEST: return "BAD_REQUEST";
+    case XST_BAD_RANGE:   return "BAD_RANGE";
+    case XST_TOO_LARGE:   return "FILE_TOO_LARGE";
+    case XST_BAD_DIGEST:  return "BAD_DIGEST";
+    default:              return "UNKNOWN_STATUS";
+    }
+}
+
+uint64_t wire_xfer_digest(uint64_t h, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    // Blocs de 32 octets : quatre produits indépendants, puis un seul
+    // mélange dans l'état
+    for (; len >= 32; p += 32, len -= 32) {
+        uint64_t w[4];
+        memcpy(w, p, sizeof(w));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        for (int i = 0; i < 4; i++) w[i] = __builtin_bswap64(w[i]);
+#endif
+        h ^= (w[0] * 0x9E3779B97F4A7C15ULL) ^ (w[1] * 0xC2B2AE3D27D4EB4FULL) ^
+             (w[2] * 0x165667B19E3779F9ULL) ^ (w[3] * 0x27D4EB2F165667C5ULL);
+        h = (h ^ (h >> 29)) * 1099511628211ULL;
+    }
+    for (; len; p++, len--) h = (h ^ *p) * 1099511628211ULL;
+    return h;
+}
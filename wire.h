@@ -0,0 +1,159 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Protocole binaire, négocié au login ("@login username password +bin"),
+ * utilisé à côté des commandes texte (qui restent disponibles).
+ *
+ * Trame : [WIRE_VERSION][opcode][champs...]
+ *  - entiers : varint (LEB128 non signé) ;
+ *  - chaînes : longueur en varint puis octets (sans '\0') ;
+ *  - salle ou utilisateur déjà connu : poignée = numéro de case + génération
+ *    (deux varints), appris par WOP_ROOM_BIND / WOP_USER_BIND.
+ * Le premier octet (>= 0x80) ne peut pas commencer une commande texte
+ * ('@') ni une trame de la couche fiable ('~').
+ */
+
+#define WIRE_VERSION 0xB1            /* 0xB0 | version 1 */
+#define WIRE_FRAME_MAX 2048
+
+/* Client → serveur */
+#define WOP_ROOMSG        0x01       /* salle(poignée), texte */
+#define WOP_ROOMSG_NAMED  0x02       /* nom de salle, texte (première utilisation) */
+#define WOP_MESSAGE       0x03       /* destinataire(poignée), texte */
+#define WOP_MESSAGE_NAMED 0x04       /* nom du destinataire, texte */
+
+/* Serveur → client */
+#define WOP_ROOM_BIND     0x81       /* salle(poignée), nom */
+#define WOP_USER_BIND     0x82       /* utilisateur(poignée), nom */
+#define WOP_ROOM_MSG      0x83       /* salle(poignée), nom de l'expéditeur, texte */
+#define WOP_DIRECT_MSG    0x84       /* nom de l'expéditeur, texte */
+#define WOP_STATUS        0x85       /* code, texte */
+
+/* Codes de WOP_STATUS */
+#define WST_OK            0
+#define WST_ERROR         1
+#define WST_STALE_HANDLE  2          /* poignée inconnue ou périmée : renvoyer par le nom */
+
+/**
+ * Transferts de fichiers (connexion TCP, xfer.h). Chaque message commence
+ * par un en-tête fixe de WIRE_XFER_HEADER octets (entiers gros-boutistes) :
+ *
+ *   [WIRE_XFER_VERSION][opcode][statut][0][longueur du nom : 16][0 0]
+ *   [début : 64][longueur : 64][taille totale : 64][empreinte : 64]
+ *
+ * suivi du nom (sans '\0'), puis du contenu s'il y en a un (longueur octets,
+ * qui sont les octets [début, début + longueur) du fichier) :
+ *   upload   client → XOP_UPLOAD(nom, début, longueur, taille, empreinte
+ *                      du contenu) + contenu
+ *            serveur → XOP_ACK(statut, octets reçus, taille = octets
+ *                      du fichier reçus au total, toutes plages confondues,
+ *                      empreinte des octets écrits) ; une plage dont
+ *                      l'empreinte diffère n'est pas conservée (XST_BAD_DIGEST)
+ *   reprise  client → XOP_RESUME(nom, début, taille)
+ *            serveur → XOP_OFFSET(statut, début = fin des octets déjà reçus
+ *                      d'un seul tenant à partir du début demandé, ce
+ *                      début si aucun, longueur = octets du fichier reçus
+ *                      au total, taille = fin des octets provisoires qui
+ *                      suivent, écrits par un envoi interrompu mais pas
+ *                      vérifiés (début si aucun), empreinte de ces octets
+ *                      provisoires) ; si XST_OK, la connexion attend
+ *                      ensuite un XOP_UPLOAD. S'il commence à la fin des
+ *                      octets provisoires, le client leur a trouvé la même
+ *                      empreinte : le serveur les compte comme reçus
+ *   download client → XOP_DOWNLOAD(nom, début, longueur ou WIRE_XFER_ALL)
+ *            serveur → XOP_FILE(statut, début, longueur, taille) + contenu si XST_OK
+ *            client → XOP_ACK(statut, octets reçus)
+ * La fin du contenu se déduit de la longueur annoncée : ni pause, ni
+ * fermeture de la connexion pour la signaler. Un upload ou un download
+ * réussi laisse la connexion ouverte pour une nouvelle commande : un gros
+ * fichier peut passer en plusieurs plages sur plusieurs connexions.
+ */
+
+#define WIRE_XFER_VERSION 0xC3
+#define WIRE_XFER_HEADER  40
+#define WIRE_XFER_NAME_MAX 255       /* sans '/' : le fichier reste dans uploads/ */
+#define WIRE_XFER_ALL     UINT64_MAX /* longueur d'un XOP_DOWNLOAD : jusqu'à la fin */
+
+#define XOP_UPLOAD        0x01       /* nom, début, longueur du contenu qui suit, taille, empreinte */
+#define XOP_DOWNLOAD      0x02       /* nom, début, longueur */
+#define XOP_RESUME        0x03       /* nom, début, taille : où reprendre l'upload ? */
+#define XOP_FILE          0x81       /* statut, début, longueur du contenu qui suit, taille */
+#define XOP_ACK           0x82       /* statut, octets reçus, octets du fichier reçus au total, empreinte */
+#define XOP_OFFSET        0x83       /* statut, début de la reprise, octets reçus au total, fin et empreinte des octets provisoires */
+
+/* Statuts d'un transfert */
+#define XST_OK            0          /* FILE_RECEIVED_OK (XOP_ACK), FILE_SEND_START (XOP_FILE) */
+#define XST_NOT_FOUND     1
+#define XST_OPEN_ERROR    2
+#define XST_WRITE_ERROR   3
+#define XST_INCOMPLETE    4          /* flux fermé avant la longueur annoncée */
+#define XST_BAD_REQUEST   5          /* en-tête invalide ou nom refusé */
+#define XST_BAD_RANGE     6          /* début ou longueur hors du fichier, ou autre taille en cours */
+#define XST_TOO_LARGE     7          /* taille au-delà du maximum du serveur ou de son disque */
+#define XST_BAD_DIGEST    8          /* octets écrits différents de ceux envoyés */
+
+typedef struct {
+    uint8_t op;
+    uint8_t status;
+    uint16_t name_len;
+    uint64_t offset;
+    uint64_t length;
+    uint64_t total;
+    uint64_t digest;
+} WireXferHeader;
+
+void wire_xfer_pack(uint8_t out[WIRE_XFER_HEADER], const WireXferHeader *h);
+
+/* Décode un en-tête, 0 si la version ou la longueur du nom est invalide */
+int wire_xfer_unpack(const uint8_t in[WIRE_XFER_HEADER], WireXferHeader *h);
+
+/* Nom du statut pour les traces ("FILE_RECEIVED_OK", "FILE_NOT_FOUND"...) */
+const char *wire_xfer_status(uint8_t op, uint8_t status);
+
+/* Empreinte d'un contenu transféré, à partir de WIRE_XFER_DIGEST_INIT
+ * (produits de mots de 64 bits petit-boutistes par blocs de 32 octets, puis
+ * FNV-1a sur les derniers octets). Par morceaux : chacun, sauf le dernier,
+ * fait un multiple de 32 octets */
+#define WIRE_XFER_DIGEST_INIT 14695981039346656037ULL
+uint64_t wire_xfer_digest(uint64_t h, const void *buf, size_t len);
+
+/* Écriture d'une trame dans un tampon fourni */
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    int overflow;                    /* 1 si un champ n'a pas tenu dans buf */
+} WireWriter;
+
+/* Lecture d'une trame reçue */
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    int error;                       /* 1 si la trame est tronquée ou malformée */
+} WireReader;
+
+/* Retourne 1 si buf est une trame binaire de cette version */
+int wire_is_frame(const void *buf, size_t len);
+
+/* Commence une trame d'opcode op dans buf */
+void wire_begin(WireWriter *w, void *buf, size_t cap, uint8_t op);
+void wire_put_varint(WireWriter *w, uint64_t v);
+void wire_put_bytes(WireWriter *w, const void *data, size_t len);
+void wire_put_str(WireWriter *w, const char *s);
+
+/* Commence la lecture d'une trame (wire_is_frame vérifié), retourne l'opcode */
+uint8_t wire_open(WireReader *r, const void *buf, size_t len);
+uint64_t wire_get_varint(WireReader *r);
+
+/*
+ * Copie une chaîne dans out (terminée par '\0', au plus cap - 1 octets).
+ * Une chaîne plus longue que cap - 1 est une erreur.
+ */
+void wire_get_str(WireReader *r, char *out, size_t cap);
+
+#endif
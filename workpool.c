@@ -0,0 +1,104 @@
+#define _GNU_SOURCE
+#include "workpool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+static void *workpool_thread(void *arg) {
+    WorkPool *p = arg;
+    // Priorité propre à ce thread (sous Linux, setpriority vise un tid)
+    if (p->nice) setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), p->nice);
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (!p->stop && p->count == 0) pthread_cond_wait(&p->wake, &p->lock);
+        if (p->stop) break;
+        WorkItem item = p->queue[p->head];
+        p->head = (p->head + 1) % p->capacity;
+        p->count--;
+        pthread_mutex_unlock(&p->lock);
+
+        item.fn(item.arg);
+
+        pthread_mutex_lock(&p->lock);
+        p->done++;
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+WorkPool *workpool_create(int threads, int capacity, int nice) {
+    if (threads <= 0 || capacity <= 0) return NULL;
+    WorkPool *p = calloc(1, sizeof(WorkPool));
+    if (!p) return NULL;
+    p->queue = malloc(capacity * sizeof(WorkItem));
+    p->threads = calloc(threads, sizeof(pthread_t));
+    if (!p->queue || !p->threads) {
+        free(p->queue);
+        free(p->threads);
+        free(p);
+        return NULL;
+    }
+    p->capacity = capacity;
+    p->nice = nice;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wake, NULL);
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&p->threads[i], NULL, workpool_thread, p) != 0) {
+            perror("pthread_create pool");
+            break;
+        }
+        p->thread_count++;
+    }
+    if (p->thread_count == 0) {
+        workpool_free(p);
+        return NULL;
+    }
+    return p;
+}
+
+int workpool_submit(WorkPool *p, WorkFn fn, void *arg) {
+    pthread_mutex_lock(&p->lock);
+    if (p->stop || p->count == p->capacity) {
+        p->rejected++;
+        pthread_mutex_unlock(&p->lock);
+        return 0;
+    }
+    p->queue[(p->head + p->count) % p->capacity] = (WorkItem){ fn, arg };
+    p->count++;
+    if (p->count > p->peak) p->peak = p->count;
+    pthread_cond_signal(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+    return 1;
+}
+
+void workpool_stop(WorkPool *p) {
+    pthread_mutex_lock(&p->lock);
+    if (p->stop) {
+        pthread_mutex_unlock(&p->lock);
+        return;
+    }
+    p->stop = 1;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+    for (int i = 0; i < p->thread_count; i++) pthread_join(p->threads[i], NULL);
+
+    // Plus aucun thread : la file se vide sans verrou
+    for (; p->count > 0; p->count--) {
+        free(p->queue[p->head].arg);
+        p->head = (p->head + 1) % p->capacity;
+        p->discarded++;
+    }
+}
+
+void workpool_free(WorkPool *p) {
+    if (!p) return;
+    workpool_stop(p);
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->wake);
+    free(p->queue);
+    free(p->threads);
+    free(p);
+}
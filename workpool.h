@@ -0,0 +1,53 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <pthread.h>
+
+/**
+ * Pool de threads à file bornée pour les calculs longs qui ne doivent pas
+ * bloquer les workers UDP (vérification des mots de passe, kdf.h).
+ *
+ * workpool_submit ne bloque jamais : si la file est pleine, la tâche est
+ * refusée et l'appelant répond au client de réessayer. Les threads du
+ * pool tournent avec une priorité réduite (nice) : pendant une rafale de
+ * connexions, le CPU va d'abord aux messages.
+ */
+
+typedef void (*WorkFn)(void *arg);
+
+typedef struct {
+    WorkFn fn;
+    void *arg;
+} WorkItem;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    WorkItem *queue;              /* file circulaire de capacity tâches */
+    int capacity, head, count;
+    int stop;
+    pthread_t *threads;
+    int thread_count;
+    int nice;
+
+    /* Statistiques */
+    unsigned long done, rejected, discarded;
+    int peak;                     /* plus longue file observée */
+} WorkPool;
+
+/* Lance threads threads de priorité nice (0 = inchangée), file de capacity tâches */
+WorkPool *workpool_create(int threads, int capacity, int nice);
+
+/* Confie fn(arg) au pool, 0 si la file est pleine ou le pool arrêté */
+int workpool_submit(WorkPool *p, WorkFn fn, void *arg);
+
+/*
+ * Attend la fin des tâches en cours et arrête les threads ; les tâches
+ * encore en file ne sont pas exécutées, leur arg est libéré par free
+ */
+void workpool_stop(WorkPool *p);
+
+/* Arrête le pool s'il ne l'est pas et le libère */
+void workpool_free(WorkPool *p);
+
+#endif
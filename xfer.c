@@ -0,0 +1,1021 @@
+#define _GNU_SOURCE
+#include "xfer.h"
+#include "globalVariables.h"
+#include "wire.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+#define XFER_EVENTS 64
+#define XFER_PATH_MAX (sizeof("uploads/" XFER_PARTIAL_DIR "/") + WIRE_XFER_NAME_MAX + 8)
+
+typedef enum {
+    XFER_COMMAND,      // En attente d'un en-tête et du nom (XOP_UPLOAD, XOP_DOWNLOAD ou XOP_RESUME)
+    XFER_UPLOAD,       // Réception des octets annoncés
+    XFER_DOWNLOAD,     // Envoi des octets annoncés
+    XFER_TRAILER       // Contenu envoyé, en attente de l'accusé du client
+} XferState;
+
+typedef struct XferConn {
+    int fd;
+    int file;                    // Fichier reçu ou envoyé, -1 sinon
+    XferState state;
+    uint8_t head[WIRE_XFER_HEADER + WIRE_XFER_NAME_MAX];   // En-tête (et nom) en cours de lecture
+    size_t head_len;
+    char name[WIRE_XFER_NAME_MAX + 1];                     // Nom du fichier
+    int copy;                    // Repli sur la copie par tampon (splice/sendfile refusés)
+    char *buf;                   // Bloc en cours d'envoi (téléchargement par copie)
+    size_t buf_len, buf_off;
+    uint64_t offset;             // Position du contenu dans le fichier
+    uint64_t size;               // Longueur annoncée du contenu
+    uint64_t file_size;          // Taille totale du fichier
+    uint64_t total;              // Octets reçus ou envoyés
+    uint64_t digest;             // Upload : empreinte annoncée, puis celle des octets écrits
+    uint64_t offered_start, offered_end;   // Reprise : octets provisoires proposés au client (XOP_OFFSET)
+    struct Staging *staging;     // Upload : fichier partiel partagé (plages reçues)
+    uint8_t out[2 * WIRE_XFER_HEADER];   // En-têtes de réponse pas encore acceptés par la socket
+    size_t out_len;
+    bool out_more;               // Le contenu suit le dernier en-tête (MSG_MORE)
+    int queued;                  // Dans la file des connexions prêtes
+    struct XferConn *next;
+} XferConn;
+
+// File simple de connexions prêtes
+typedef struct {
+    XferConn *head, *tail;
+} XferQueue;
+
+typedef struct {
+    int id;
+    int epfd;
+    int listen_fd;
+    XferQueue ready;             // Budget épuisé ou commande suivante : à reprendre sans attendre d'événement
+    int pipe[2];                 // Tube des uploads par splice, vide entre deux appels
+    char chunk[XFER_CHUNK];      // Bloc de réception des uploads par copie
+    pthread_t tid;
+} Reactor;
+
+static void queue_push(XferQueue *q, XferConn *c) {
+    c->next = NULL;
+    c->queued = 1;
+    if (q->tail) q->tail->next = c;
+    else q->head = c;
+    q->tail = c;
+}
+
+static int pwrite_full(int fd, const char *p, size_t n, uint64_t pos) {
+    while (n) {
+        ssize_t k = pwrite(fd, p, n, pos);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += k;
+        n -= k;
+        pos += k;
+    }
+    return 1;
+}
+
+// Envoie ce qui reste des en-têtes de réponse. 1 si tout est parti, 0 si
+// la socket est pleine (la suite au prochain front EPOLLOUT), -1 en cas d'erreur
+static int header_flush(XferConn *c) {
+    while (c->out_len) {
+        ssize_t n = send(c->fd, c->out, c->out_len, MSG_NOSIGNAL | MSG_DONTWAIT | (c->out_more ? MSG_MORE : 0));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        memmove(c->out, c->out + n, c->out_len - n);
+        c->out_len -= n;
+    }
+    return 1;
+}
+
+// En-tête de réponse (XOP_FILE, XOP_ACK ou XOP_OFFSET), mis à la suite de
+// ceux que la socket n'a pas encore acceptés : un envoi partiel ne décale
+// jamais le flux. more : le contenu suit, l'en-tête partira dans le même
+// segment. false si la connexion est à fermer (erreur, ou client qui ne lit
+// plus ses réponses)
+static bool send_header(XferConn *c, const WireXferHeader *h, bool more) {
+    if (c->out_len + WIRE_XFER_HEADER > sizeof(c->out)) return false;
+    wire_xfer_pack(c->out + c->out_len, h);
+    c->out_len += WIRE_XFER_HEADER;
+    c->out_more = more;
+    return header_flush(c) >= 0;
+}
+
+static bool send_ack(XferConn *c, uint8_t status, uint64_t kept) {
+    return send_header(c, &(WireXferHeader){ .op = XOP_ACK, .status = status, .offset = c->offset, .length = c->total,
+                                             .total = kept, .digest = c->digest }, false);
+}
+
+static void staging_release(struct Staging *s);
+
+static void conn_close(XferConn *c) {
+    if (c->staging) staging_release(c->staging);
+    close(c->fd);
+    if (c->file >= 0) close(c->file);
+    free(c->buf);
+    free(c);
+}
+
+// Complète c->head jusqu'à want octets, sans lire au-delà (la suite est le
+// contenu). 1 si les want octets sont là, 0 s'il faut attendre le prochain
+// front, -1 si la connexion est fermée ou en erreur
+static int read_head(XferConn *c, size_t want) {
+    while (c->head_len < want) {
+        ssize_t n = recv(c->fd, c->head + c->head_len, want - c->head_len, 0);
+        if (n > 0) {
+            c->head_len += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        return -1;
+    }
+    return 1;
+}
+
+/* ---- Uploads en attente : uploads/.partial/<nom>.part et <nom>.meta ----
+ *
+ * Un upload peut arriver en morceaux, sur plusieurs connexions à la fois
+ * (et donc plusieurs réacteurs) : chacune écrit ses octets à leur place
+ * dans le fichier partiel, préalloué à la taille totale. Les plages sont
+ * partagées (staging_lock) et notées dans <nom>.meta, en deux ensembles :
+ *   - reçues : octets dont l'empreinte a été vérifiée (plage complète, ou
+ *     octets provisoires confirmés par le client à la reprise) ;
+ *   - provisoires : octets écrits mais pas encore vérifiés (points de
+ *     reprise, upload interrompu). Jamais comptés comme reçus : une
+ *     reprise les propose au client avec leur empreinte (XOP_OFFSET).
+ * Le fichier n'est renommé dans uploads/ qu'une fois toutes les plages
+ * reçues.
+ */
+
+typedef struct {
+    uint64_t start, end;
+} Range;
+
+// Plages triées et disjointes
+typedef struct {
+    Range *ranges;
+    int count, cap;
+} RangeSet;
+
+typedef struct Staging {
+    char name[WIRE_XFER_NAME_MAX + 1];
+    uint64_t file_size;
+    int fd;                      // Fichier partiel, écrit par pwrite/splice à position explicite
+    int refs;                    // Connexions en train d'y écrire
+    bool done;                   // Renommé dans uploads/ : plus réutilisable
+    RangeSet received;           // Plages vérifiées
+    RangeSet pending;            // Plages écrites, pas encore vérifiées
+    struct Staging *next;
+} Staging;
+
+static pthread_mutex_t staging_lock = PTHREAD_MUTEX_INITIALIZER;
+static Staging *stagings;
+
+static void partial_path(char *out, size_t cap, const char *name, const char *suffix) {
+    snprintf(out, cap, "uploads/" XFER_PARTIAL_DIR "/%s%s", name, suffix);
+}
+
+// Ajoute [start, end) à l'ensemble, en fusionnant les voisines
+static void range_add(RangeSet *set, uint64_t start, uint64_t end) {
+    if (start >= end) return;
+    int i = 0;
+    while (i < set->count && set->ranges[i].end < start) i++;
+    int j = i;
+    while (j < set->count && set->ranges[j].start <= end) {
+        if (set->ranges[j].start < start) start = set->ranges[j].start;
+        if (set->ranges[j].end > end) end = set->ranges[j].end;
+        j++;
+    }
+    if (i == j) {
+        if (set->count == set->cap) {
+            int cap = set->cap ? set->cap * 2 : 8;
+            Range *ranges = realloc(set->ranges, cap * sizeof(Range));
+            if (!ranges) return;   // plage non notée : elle sera renvoyée
+            set->ranges = ranges;
+            set->cap = cap;
+        }
+        memmove(&set->ranges[i + 1], &set->ranges[i], (set->count - i) * sizeof(Range));
+        set->count++;
+    } else {
+        memmove(&set->ranges[i + 1], &set->ranges[j], (set->count - j) * sizeof(Range));
+        set->count -= j - i - 1;
+    }
+    set->ranges[i] = (Range){ start, end };
+}
+
+// Retire [start, end) de l'ensemble (une plage à cheval est raccourcie ou coupée en deux)
+static void range_remove(RangeSet *set, uint64_t start, uint64_t end) {
+    for (int i = 0; i < set->count && start < end; i++) {
+        Range *g = &set->ranges[i];
+        if (g->end <= start || g->start >= end) continue;
+        if (g->start < start && g->end > end) {
+            uint64_t tail = g->end;
+            g->end = start;
+            range_add(set, end, tail);
+            return;
+        }
+        if (g->start < start) {
+            g->end = start;
+        } else if (g->end > end) {
+            g->start = end;
+        } else {
+            memmove(g, g + 1, (set->count - i - 1) * sizeof(Range));
+            set->count--;
+            i--;
+        }
+    }
+}
+
+static uint64_t range_covered(const RangeSet *set) {
+    uint64_t covered = 0;
+    for (int i = 0; i < set->count; i++) covered += set->ranges[i].end - set->ranges[i].start;
+    return covered;
+}
+
+// Fin de la plage de l'ensemble qui contient from (from si aucune)
+static uint64_t range_run_end(const RangeSet *set, uint64_t from) {
+    for (int i = 0; i < set->count; i++) {
+        if (set->ranges[i].start <= from && from < set->ranges[i].end) return set->ranges[i].end;
+    }
+    return from;
+}
+
+static void range_clear(RangeSet *set) {
+    free(set->ranges);
+    *set = (RangeSet){ 0 };
+}
+
+// Note la taille totale, les plages reçues ("début fin") et les plages
+// provisoires ("? début fin") : fichier temporaire puis rename
+static void staging_save(const Staging *s) {
+    char path[XFER_PATH_MAX], tmp[XFER_PATH_MAX];
+    partial_path(path, sizeof(path), s->name, ".meta");
+    partial_path(tmp, sizeof(tmp), s->name, ".meta.tmp");
+    FILE *meta = fopen(tmp, "w");
+    if (!meta) {
+        printf("Erreur: écriture de %s\n", tmp);
+        return;
+    }
+    fprintf(meta, "%lu\n", (unsigned long)s->file_size);
+    for (int i = 0; i < s->received.count; i++) {
+        fprintf(meta, "%lu %lu\n", (unsigned long)s->received.ranges[i].start, (unsigned long)s->received.ranges[i].end);
+    }
+    for (int i = 0; i < s->pending.count; i++) {
+        fprintf(meta, "? %lu %lu\n", (unsigned long)s->pending.ranges[i].start, (unsigned long)s->pending.ranges[i].end);
+    }
+    if (fclose(meta) != 0 || rename(tmp, path) < 0) printf("Erreur: écriture de %s\n", path);
+}
+
+// Relit la note d'un upload interrompu : 1 si elle est pour cette taille,
+// 0 si absente ou illisible, -1 si elle est pour une autre taille
+static int staging_load(Staging *s) {
+    char path[XFER_PATH_MAX];
+    partial_path(path, sizeof(path), s->name, ".meta");
+    FILE *meta = fopen(path, "r");
+    if (!meta) return 0;
+    char line[64];
+    unsigned long noted_size, start, end;
+    int ok = fgets(line, sizeof(line), meta) && sscanf(line, "%lu", &noted_size) == 1;
+    if (ok && noted_size != s->file_size) ok = -1;
+    while (ok > 0 && fgets(line, sizeof(line), meta)) {
+        bool pending = line[0] == '?';
+        if (sscanf(line + pending, "%lu %lu", &start, &end) == 2 && start < end && end <= s->file_size) {
+            range_add(pending ? &s->pending : &s->received, start, end);
+        }
+    }
+    fclose(meta);
+    return ok;
+}
+
+// Taille refusée d'emblée : au-delà du maximum du serveur (option -f)
+static bool too_large(uint64_t file_size) {
+    return file_size > (uint64_t)XFER_MAX_FILE_MB << 20;
+}
+
+static Staging *staging_find(const char *name) {
+    for (Staging *s = stagings; s; s = s->next) {
+        if (!s->done && strcmp(s->name, name) == 0) return s;
+    }
+    return NULL;
+}
+
+// Upload de name (file_size octets) à compléter : reprend la note s'il y en
+// a une pour cette taille, sinon part d'un fichier préalloué vide. NULL et
+// *status si le fichier ne s'ouvre pas (XST_OPEN_ERROR), ne tient pas sur
+// le disque (XST_TOO_LARGE), ou si un autre upload de ce nom, d'une autre
+// taille, est en cours ou en attente de reprise (XST_BAD_RANGE)
+static Staging *staging_open(const char *name, uint64_t file_size, uint8_t *status) {
+    *status = XST_OPEN_ERROR;
+    pthread_mutex_lock(&staging_lock);
+    Staging *s = staging_find(name);
+    if (s && s->file_size != file_size) {
+        *status = XST_BAD_RANGE;
+        pthread_mutex_unlock(&staging_lock);
+        return NULL;
+    }
+    if (!s) {
+        s = calloc(1, sizeof(Staging));
+        if (!s) {
+            pthread_mutex_unlock(&staging_lock);
+            return NULL;
+        }
+        snprintf(s->name, sizeof(s->name), "%s", name);
+        s->file_size = file_size;
+        int noted = staging_load(s);
+        char path[XFER_PATH_MAX];
+        partial_path(path, sizeof(path), name, ".part");
+        s->fd = noted < 0 ? -1 : open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (noted < 0) *status = XST_BAD_RANGE;
+        // La note ne vaut que si le fichier partiel est bien là, à sa taille
+        struct stat st;
+        bool resumed = s->fd >= 0 && noted && fstat(s->fd, &st) == 0 && (uint64_t)st.st_size == file_size;
+        if (s->fd >= 0 && !resumed) {
+            // Nouveau fichier : place réservée d'un bloc (repli : fichier
+            // creux), s'il reste la place sur le disque
+            struct statvfs vfs;
+            s->received.count = s->pending.count = 0;
+            if (fstatvfs(s->fd, &vfs) == 0 && (uint64_t)vfs.f_bavail * vfs.f_frsize < file_size) {
+                *status = XST_TOO_LARGE;
+                unlink(path);
+                close(s->fd);
+                s->fd = -1;
+            } else if (ftruncate(s->fd, 0) < 0 ||
+                       (file_size && fallocate(s->fd, 0, 0, file_size) < 0 && ftruncate(s->fd, file_size) < 0)) {
+                close(s->fd);
+                s->fd = -1;
+            }
+        }
+        if (s->fd < 0) {
+            range_clear(&s->received);
+            range_clear(&s->pending);
+            free(s);
+            pthread_mutex_unlock(&staging_lock);
+            return NULL;
+        }
+        if (!resumed) staging_save(s);
+        s->next = stagings;
+        stagings = s;
+    }
+    s->refs++;
+    pthread_mutex_unlock(&staging_lock);
+    return s;
+}
+
+// Octets reçus d'un seul tenant à partir de from (*end), octets
+// provisoires qui les suivent (jusqu'à *pending_end) et octets reçus au
+// total (*kept), pour XOP_RESUME. XST_BAD_RANGE si l'upload en cours ou
+// noté de ce nom a une autre taille
+static uint8_t staging_progress(const char *name, uint64_t file_size, uint64_t from, uint64_t *end,
+                                uint64_t *pending_end, uint64_t *kept) {
+    pthread_mutex_lock(&staging_lock);
+    Staging *s = staging_find(name);
+    Staging noted = { .file_size = file_size };
+    uint8_t status = XST_OK;
+    *end = *pending_end = from;
+    *kept = 0;
+    if (!s) {
+        snprintf(noted.name, sizeof(noted.name), "%s", name);
+        int loaded = staging_load(&noted);
+        if (loaded > 0) s = &noted;
+        else if (loaded < 0) status = XST_BAD_RANGE;
+    }
+    if (s && s->file_size != file_size) {
+        status = XST_BAD_RANGE;
+    } else if (s) {
+        *end = range_run_end(&s->received, from);
+        *pending_end = range_run_end(&s->pending, *end);
+        *kept = range_covered(&s->received);
+    }
+    range_clear(&noted.received);
+    range_clear(&noted.pending);
+    pthread_mutex_unlock(&staging_lock);
+    return status;
+}
+
+// Après un changement des plages reçues (staging_lock tenu) : si tout le
+// fichier l'est, il prend sa place dans uploads/ (*finished), sinon la
+// note est mise à jour. Retourne les octets reçus au total
+static uint64_t staging_publish(Staging *s, bool *finished) {
+    uint64_t covered = range_covered(&s->received);
+    *finished = false;
+    if (s->done) {
+        *finished = true;
+    } else if (covered == s->file_size) {
+        char partial[XFER_PATH_MAX], filepath[XFER_PATH_MAX];
+        partial_path(partial, sizeof(partial), s->name, ".part");
+        snprintf(filepath, sizeof(filepath), "uploads/%s", s->name);
+        if (rename(partial, filepath) == 0) {
+            partial_path(partial, sizeof(partial), s->name, ".meta");
+            unlink(partial);
+            s->done = true;
+            *finished = true;
+        } else {
+            printf("Erreur: renommage de %s : %s\n", partial, strerror(errno));
+            staging_save(s);
+        }
+    } else {
+        staging_save(s);
+    }
+    return covered;
+}
+
+// Note [start, end) comme reçu (empreinte vérifiée). Retourne les octets
+// reçus au total ; *finished si le fichier est complet
+static uint64_t staging_commit(Staging *s, uint64_t start, uint64_t end, bool *finished) {
+    pthread_mutex_lock(&staging_lock);
+    range_remove(&s->pending, start, end);
+    range_add(&s->received, start, end);
+    uint64_t covered = staging_publish(s, finished);
+    pthread_mutex_unlock(&staging_lock);
+    return covered;
+}
+
+// Note [start, end) comme écrit mais pas vérifié (point de reprise, upload
+// interrompu) : proposé au client à la reprise, jamais compté comme reçu.
+// Retourne les octets reçus au total
+static uint64_t staging_checkpoint(Staging *s, uint64_t start, uint64_t end) {
+    pthread_mutex_lock(&staging_lock);
+    range_add(&s->pending, start, end);
+    uint64_t covered = range_covered(&s->received);
+    if (!s->done) staging_save(s);
+    pthread_mutex_unlock(&staging_lock);
+    return covered;
+}
+
+// Oublie les octets provisoires de [start, end) (empreinte différente)
+static uint64_t staging_discard(Staging *s, uint64_t start, uint64_t end) {
+    pthread_mutex_lock(&staging_lock);
+    range_remove(&s->pending, start, end);
+    uint64_t covered = range_covered(&s->received);
+    if (!s->done) staging_save(s);
+    pthread_mutex_unlock(&staging_lock);
+    return covered;
+}
+
+// Le client a retrouvé son empreinte sur les octets provisoires
+// [start, end) proposés à la reprise : ils passent dans les plages reçues,
+// s'ils sont toujours notés comme provisoires. false sinon
+static bool staging_confirm(Staging *s, uint64_t start, uint64_t end, bool *finished) {
+    pthread_mutex_lock(&staging_lock);
+    bool held = range_run_end(&s->pending, start) >= end;
+    *finished = false;
+    if (held) {
+        range_remove(&s->pending, start, end);
+        range_add(&s->received, start, end);
+        staging_publish(s, finished);
+    }
+    pthread_mutex_unlock(&staging_lock);
+    return held;
+}
+
+static void staging_release(Staging *s) {
+    pthread_mutex_lock(&staging_lock);
+    if (--s->refs == 0) {
+        Staging **p = &stagings;
+        while (*p != s) p = &(*p)->next;
+        *p = s->next;
+        close(s->fd);
+        range_clear(&s->received);
+        range_clear(&s->pending);
+        free(s);
+    }
+    pthread_mutex_unlock(&staging_lock);
+}
+
+// Vide le tube du réacteur dans le fichier, à partir de *pos (splice tube → fichier)
+static int drain_pipe(Reactor *r, int file, loff_t *pos, size_t len) {
+    while (len) {
+        ssize_t k = splice(r->pipe[0], NULL, file, pos, len, SPLICE_F_MOVE);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return 0;
+        len -= k;
+    }
+    return 1;
+}
+
+// Après un échec d'écriture, des octets de l'upload abandonné peuvent rester
+// dans le tube : on le remplace pour ne pas les mêler à l'upload suivant
+static void reset_pipe(Reactor *r) {
+    close(r->pipe[0]);
+    close(r->pipe[1]);
+    r->pipe[0] = r->pipe[1] = -1;
+    if (pipe2(r->pipe, O_CLOEXEC) == 0) {
+        fcntl(r->pipe[1], F_SETPIPE_SZ, XFER_ZEROCOPY_CHUNK);
+    }
+}
+
+// La connexion attend une nouvelle commande (plusieurs morceaux ou plages
+// peuvent se suivre sur une même connexion). Elle est reprise au prochain
+// tour du réacteur et non ici : des commandes enchaînées ne s'empilent pas
+// sur la pile et n'accaparent pas le réacteur
+static void conn_rearm(Reactor *r, XferConn *c) {
+    if (c->staging) staging_release(c->staging);
+    c->staging = NULL;
+    if (c->file >= 0) close(c->file);
+    c->file = -1;
+    c->buf_len = c->buf_off = 0;
+    c->total = 0;
+    c->offered_start = c->offered_end = 0;
+    c->head_len = 0;
+    c->state = XFER_COMMAND;
+    queue_push(&r->ready, c);
+}
+
+// Upload interrompu : ce qui est arrivé reste noté comme provisoire pour
+// une reprise (sans empreinte, il n'est pas vérifié), le client reçoit le
+// statut et le nombre d'octets conservés
+static void upload_abort(XferConn *c, uint8_t status) {
+    c->digest = 0;   // plage incomplète : pas d'empreinte à comparer
+    uint64_t kept = staging_checkpoint(c->staging, c->offset, c->offset + c->total);
+    printf("Upload de %s en attente de reprise (%lu/%lu octets vérifiés, %lu provisoires)\n", c->name, (unsigned long)kept,
+           (unsigned long)c->file_size, (unsigned long)c->total);
+    send_ack(c, status, kept);
+    conn_close(c);
+}
+
+// Empreinte des octets [offset, offset + len) du fichier partiel, relus
+// (depuis le cache de pages) par blocs du réacteur. 0 si la lecture échoue
+static int staging_digest(Reactor *r, int fd, uint64_t offset, uint64_t len, uint64_t *digest) {
+    uint64_t h = WIRE_XFER_DIGEST_INIT;
+    while (len) {
+        ssize_t n = pread(fd, r->chunk, len < sizeof(r->chunk) ? len : sizeof(r->chunk), offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        h = wire_xfer_digest(h, r->chunk, n);
+        offset += n;
+        len -= n;
+    }
+    *digest = h;
+    return 1;
+}
+
+// Tous les octets annoncés sont arrivés : la plage n'est notée que si les
+// octets écrits ont l'empreinte annoncée par le client, puis le fichier
+// prend sa place dans uploads/ si c'était la dernière plage manquante
+static void upload_done(Reactor *r, XferConn *c) {
+    bool finished;
+    uint64_t expected = c->digest;
+    if (!staging_digest(r, c->staging->fd, c->offset, c->size, &c->digest) || c->digest != expected) {
+        printf("Erreur: octets %lu à %lu de %s altérés (empreinte différente), plage non conservée\n",
+               (unsigned long)c->offset, (unsigned long)(c->offset + c->size), c->name);
+        uint64_t kept = staging_discard(c->staging, c->offset, c->offset + c->size);
+        if (!send_ack(c, XST_BAD_DIGEST, kept)) {
+            conn_close(c);
+            return;
+        }
+        conn_rearm(r, c);
+        return;
+    }
+    uint64_t kept = staging_commit(c->staging, c->offset, c->offset + c->size, &finished);
+    if (finished) {
+        printf("Fichier %s reçu et sauvegardé (%lu octets)\n", c->name, (unsigned long)kept);
+    } else if (c->size < c->file_size) {
+        printf("Partie de %s reçue (octets %lu à %lu, %lu/%lu au total)\n", c->name, (unsigned long)c->offset,
+               (unsigned long)(c->offset + c->size), (unsigned long)kept, (unsigned long)c->file_size);
+    }
+    if (!send_ack(c, finished || kept < c->file_size ? XST_OK : XST_WRITE_ERROR, kept)) {
+        conn_close(c);
+        return;
+    }
+    conn_rearm(r, c);
+}
+
+// Réception du contenu d'un upload (au plus XFER_BUDGET appels), écrit à
+// sa place dans le fichier partiel. Sans copie : socket → tube → fichier par
+// splice, les pages ne traversent pas l'espace utilisateur ; recv + pwrite
+// si le noyau refuse splice sur ce couple
+static void upload_readable(Reactor *r, XferConn *c) {
+    int file = c->staging->fd;
+    for (int i = 0; i < XFER_BUDGET; i++) {
+        if (c->total == c->size) {
+            upload_done(r, c);
+            return;
+        }
+        uint64_t left = c->size - c->total;
+        loff_t pos = c->offset + c->total;
+        ssize_t n;
+        bool written;
+        if (!c->copy && r->pipe[0] >= 0) {
+            size_t want = left < XFER_ZEROCOPY_CHUNK ? left : XFER_ZEROCOPY_CHUNK;
+            n = splice(c->fd, NULL, r->pipe[1], NULL, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n < 0 && errno == EINVAL) {
+                c->copy = 1;
+                continue;
+            }
+            written = n <= 0 || drain_pipe(r, file, &pos, n);
+            if (!written) reset_pipe(r);
+        } else {
+            size_t want = left < sizeof(r->chunk) ? left : sizeof(r->chunk);
+            n = recv(c->fd, r->chunk, want, 0);
+            written = n <= 0 || pwrite_full(file, r->chunk, n, pos);
+        }
+        if (!written) {
+            printf("Erreur: écriture de %s : %s\n", c->name, strerror(errno));
+            upload_abort(c, XST_WRITE_ERROR);
+            return;
+        }
+        if (n > 0) {
+            // Point de reprise noté régulièrement (arrêt brutal du serveur),
+            // provisoire tant que l'empreinte de la plage n'est pas vérifiée
+            if ((c->total + n) / XFER_CHECKPOINT != c->total / XFER_CHECKPOINT) {
+                staging_checkpoint(c->staging, c->offset, c->offset + c->total + n);
+            }
+            c->total += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;   // prochain front EPOLLIN
+        if (n < 0 && errno == EINTR) continue;
+        // Flux fermé ou coupé avant la longueur annoncée
+        printf("Upload de %s interrompu (%lu/%lu octets reçus)%s%s\n", c->name, (unsigned long)c->total,
+               (unsigned long)c->size, n < 0 ? " : " : "", n < 0 ? strerror(errno) : "");
+        upload_abort(c, XST_INCOMPLETE);
+        return;
+    }
+    queue_push(&r->ready, c);
+}
+
+// Tout le contenu est parti : reste à lire l'accusé du client, puis la
+// connexion attend une nouvelle commande
+static void trailer_readable(Reactor *r, XferConn *c) {
+    int got = read_head(c, WIRE_XFER_HEADER);
+    if (got == 0) return;
+    WireXferHeader h;
+    if (got < 0 || !wire_xfer_unpack(c->head, &h) || h.op != XOP_ACK) {
+        printf("Fichier %s envoyé (%lu octets), sans accusé du client\n", c->name, (unsigned long)c->total);
+        conn_close(c);
+        return;
+    }
+    printf("Fichier %s envoyé (%lu octets), client : %s\n", c->name, (unsigned long)c->total, wire_xfer_status(h.op, h.status));
+    conn_rearm(r, c);
+}
+
+static void download_sent(Reactor *r, XferConn *c) {
+    c->state = XFER_TRAILER;
+    c->head_len = 0;
+    trailer_readable(r, c);
+}
+
+// Envoi par copie (repli) : read dans un bloc puis send
+static void download_copy(Reactor *r, XferConn *c) {
+    if (!c->buf && !(c->buf = malloc(XFER_CHUNK))) {
+        conn_close(c);
+        return;
+    }
+    for (int i = 0; i < XFER_BUDGET; i++) {
+        if (c->buf_off == c->buf_len) {
+            if (c->total == c->size) {
+                download_sent(r, c);
+                return;
+            }
+            uint64_t left = c->size - c->total;
+            ssize_t n = read(c->file, c->buf, left < XFER_CHUNK ? left : XFER_CHUNK);
+            if (n <= 0) {
+                printf("Erreur: lecture de uploads/%s : %s\n", c->name, n == 0 ? "fichier raccourci" : strerror(errno));
+                conn_close(c);
+                return;
+            }
+            c->buf_len = n;
+            c->buf_off = 0;
+        }
+        ssize_t n = send(c->fd, c->buf + c->buf_off, c->buf_len - c->buf_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;   // prochain front EPOLLOUT
+            if (errno == EINTR) continue;
+            printf("Erreur lors de l'envoi de %s (%lu octets envoyés) : %s\n", c->name, (unsigned long)c->total, strerror(errno));
+            conn_close(c);
+            return;
+        }
+        c->buf_off += n;
+        c->total += n;
+    }
+    queue_push(&r->ready, c);
+}
+
+// Envoi du contenu d'un téléchargement (au plus XFER_BUDGET appels). sendfile
+// passe les pages du cache directement à la socket ; le repli par copie ne
+// sert que si le noyau le refuse pour ce fichier
+static void download_writable(Reactor *r, XferConn *c) {
+    if (c->copy) {
+        download_copy(r, c);
+        return;
+    }
+    for (int i = 0; i < XFER_BUDGET; i++) {
+        if (c->total == c->size) {
+            download_sent(r, c);
+            return;
+        }
+        uint64_t left = c->size - c->total;
+        ssize_t n = sendfile(c->fd, c->file, NULL, left < XFER_ZEROCOPY_CHUNK ? left : XFER_ZEROCOPY_CHUNK);
+        if (n > 0) {
+            c->total += n;
+            continue;
+        }
+        if (n == 0) {
+            // Le client attend size octets : fermer signale l'envoi incomplet
+            printf("Erreur: uploads/%s raccourci pendant l'envoi (%lu/%lu octets)\n", c->name, (unsigned long)c->total, (unsigned long)c->size);
+            conn_close(c);
+            return;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return;   // prochain front EPOLLOUT
+        if (errno == EINTR) continue;
+        if ((errno == EINVAL || errno == ENOSYS) && c->total == 0) {
+            c->copy = 1;
+            download_copy(r, c);
+            return;
+        }
+        printf("Erreur lors de l'envoi de %s (%lu octets envoyés) : %s\n", c->name, (unsigned long)c->total, strerror(errno));
+        conn_close(c);
+        return;
+    }
+    queue_push(&r->ready, c);
+}
+
+// Upload des octets [offset, offset + length) d'un fichier de total
+// octets, écrits à leur place dans uploads/.partial/<nom>.part
+static void start_upload(Reactor *r, XferConn *c, const WireXferHeader *h) {
+    c->offset = h->offset;
+    c->size = h->length;
+    c->file_size = h->total;
+    c->digest = h->digest;
+    if (h->length > h->total || h->offset > h->total - h->length) {
+        printf("Erreur: upload de %s refusé (octets %lu+%lu sur %lu)\n", c->name, (unsigned long)h->offset,
+               (unsigned long)h->length, (unsigned long)h->total);
+        send_ack(c, XST_BAD_RANGE, 0);
+        conn_close(c);
+        return;
+    }
+    if (too_large(h->total)) {
+        printf("Erreur: upload de %s refusé (%lu octets, maximum %d Mio)\n", c->name, (unsigned long)h->total, XFER_MAX_FILE_MB);
+        send_ack(c, XST_TOO_LARGE, 0);
+        conn_close(c);
+        return;
+    }
+    uint8_t status;
+    c->staging = staging_open(c->name, h->total, &status);
+    if (!c->staging) {
+        printf("Erreur: upload de %s impossible (%s)\n", c->name, status == XST_BAD_RANGE ? "autre taille en cours"
+                                                               : wire_xfer_status(XOP_ACK, status));
+        send_ack(c, status, 0);
+        conn_close(c);
+        return;
+    }
+    // Upload qui commence après les octets provisoires proposés par
+    // XOP_OFFSET : le client leur a trouvé son empreinte, ils sont vérifiés
+    bool finished;
+    if (c->offered_end > c->offered_start && h->offset == c->offered_end &&
+        staging_confirm(c->staging, c->offered_start, c->offered_end, &finished)) {
+        printf("Octets %lu à %lu de %s confirmés par le client\n", (unsigned long)c->offered_start,
+               (unsigned long)c->offered_end, c->name);
+    }
+    c->offered_start = c->offered_end = 0;
+    if (h->length == h->total) {
+        printf("Réception du fichier: uploads/%s (%lu octets)\n", c->name, (unsigned long)h->total);
+    } else {
+        printf("Réception de uploads/%s, octets %lu à %lu sur %lu\n", c->name, (unsigned long)h->offset,
+               (unsigned long)(h->offset + h->length), (unsigned long)h->total);
+    }
+    c->state = XFER_UPLOAD;
+    upload_readable(r, c);
+}
+
+// Téléchargement des octets [offset, offset + length) (bornés par la fin du fichier)
+static void start_download(Reactor *r, XferConn *c, const WireXferHeader *h) {
+    char filepath[XFER_PATH_MAX];
+    snprintf(filepath, sizeof(filepath), "uploads/%s", c->name);
+    c->file = open(filepath, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (c->file < 0 || fstat(c->file, &st) < 0 || !S_ISREG(st.st_mode)) {
+        int missing = c->file < 0 && errno == ENOENT;
+        printf("Erreur: Impossible d'ouvrir le fichier %s\n", filepath);
+        send_header(c, &(WireXferHeader){ .op = XOP_FILE, .status = missing ? XST_NOT_FOUND : XST_OPEN_ERROR }, false);
+        conn_close(c);
+        return;
+    }
+    c->file_size = st.st_size;
+    if (h->offset > c->file_size || lseek(c->file, h->offset, SEEK_SET) < 0) {
+        printf("Erreur: %s n'a que %lu octets (début demandé : %lu)\n", c->name, (unsigned long)c->file_size, (unsigned long)h->offset);
+        send_header(c, &(WireXferHeader){ .op = XOP_FILE, .status = XST_BAD_RANGE, .total = c->file_size }, false);
+        conn_close(c);
+        return;
+    }
+    c->offset = h->offset;
+    c->size = c->file_size - h->offset;
+    if (h->length < c->size) c->size = h->length;
+    if (c->size == c->file_size) {
+        printf("Envoi du fichier %s (taille: %lu octets)\n", c->name, (unsigned long)c->file_size);
+    } else {
+        printf("Envoi du fichier %s (octets %lu à %lu sur %lu)\n", c->name, (unsigned long)c->offset,
+               (unsigned long)(c->offset + c->size), (unsigned long)c->file_size);
+    }
+    WireXferHeader reply = { .op = XOP_FILE, .status = XST_OK, .offset = c->offset, .length = c->size, .total = c->file_size };
+    if (!send_header(c, &reply, c->size > 0)) {
+        conn_close(c);
+        return;
+    }
+    c->state = XFER_DOWNLOAD;
+    // Le contenu attend que l'en-tête soit entièrement parti
+    if (!c->out_len) download_writable(r, c);
+}
+
+// Nom accepté : non vide, sans '/', ni caché (le fichier reste dans
+// uploads/, à l'écart de uploads/.partial)
+static bool valid_name(const char *name) {
+    return name[0] != '\0' && name[0] != '.' && !strchr(name, '/');
+}
+
+// Phase de commande : en-tête fixe puis nom, lus exactement (le contenu
+// d'un upload reste dans la socket pour splice)
+static void command_readable(Reactor *r, XferConn *c) {
+    WireXferHeader h;
+    int got = read_head(c, WIRE_XFER_HEADER);
+    if (got > 0 && !wire_xfer_unpack(c->head, &h)) {
+        printf("Erreur: en-tête de transfert invalide\n");
+        send_ack(c, XST_BAD_REQUEST, 0);
+        conn_close(c);
+        return;
+    }
+    if (got > 0) got = read_head(c, WIRE_XFER_HEADER + h.name_len);
+    if (got == 0) return;
+    if (got < 0) {
+        conn_close(c);
+        return;
+    }
+    memcpy(c->name, c->head + WIRE_XFER_HEADER, h.name_len);
+    c->name[h.name_len] = '\0';
+
+    if ((h.op != XOP_UPLOAD && h.op != XOP_DOWNLOAD && h.op != XOP_RESUME) || !valid_name(c->name)) {
+        printf("Erreur: commande de transfert refusée (opcode %u, nom \"%s\")\n", h.op, c->name);
+        if (h.op == XOP_DOWNLOAD) send_header(c, &(WireXferHeader){ .op = XOP_FILE, .status = XST_BAD_REQUEST }, false);
+        else send_ack(c, XST_BAD_REQUEST, 0);
+        conn_close(c);
+        return;
+    }
+    if (h.op == XOP_RESUME) {
+        // Fin des octets déjà reçus à partir de h.offset, et octets
+        // provisoires qui les suivent avec leur empreinte (relue ici), que le
+        // client confirme en envoyant son XOP_UPLOAD sur la même connexion
+        // à partir de leur fin
+        uint64_t end = h.offset, pending_end = h.offset, kept = 0, digest = 0;
+        uint8_t status = too_large(h.total) ? XST_TOO_LARGE
+                                            : staging_progress(c->name, h.total, h.offset, &end, &pending_end, &kept);
+        if (pending_end > end) {
+            char path[XFER_PATH_MAX];
+            partial_path(path, sizeof(path), c->name, ".part");
+            int fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0 || !staging_digest(r, fd, end, pending_end - end, &digest)) pending_end = end;
+            if (fd >= 0) close(fd);
+        }
+        c->offered_start = end;
+        c->offered_end = pending_end;
+        WireXferHeader reply = { .op = XOP_OFFSET, .status = status, .offset = end, .length = kept, .total = pending_end,
+                                 .digest = digest };
+        if (!send_header(c, &reply, false) ||
+            status != XST_OK) {
+            if (status != XST_OK) printf("Erreur: reprise de %s refusée (%s)\n", c->name, wire_xfer_status(XOP_OFFSET, status));
+            conn_close(c);
+            return;
+        }
+        c->head_len = 0;
+        queue_push(&r->ready, c);
+        return;
+    }
+    printf("Commande reçue : %s %s\n", h.op == XOP_UPLOAD ? UPLOAD_CMD : DOWNLOAD_CMD, c->name);
+    if (h.op == XOP_UPLOAD) start_upload(r, c, &h);
+    else start_download(r, c, &h);
+}
+
+static void conn_ready(Reactor *r, XferConn *c) {
+    // En-têtes restés dans la connexion d'abord ; le contenu d'un
+    // téléchargement ne part qu'après le sien
+    int flushed = header_flush(c);
+    if (flushed < 0) {
+        conn_close(c);
+        return;
+    }
+    if (!flushed && c->state == XFER_DOWNLOAD) return;
+    switch (c->state) {
+    case XFER_COMMAND:  command_readable(r, c); break;
+    case XFER_UPLOAD:   upload_readable(r, c); break;
+    case XFER_DOWNLOAD: download_writable(r, c); break;
+    case XFER_TRAILER:  trailer_readable(r, c); break;
+    }
+}
+
+// Accepte toutes les connexions en attente (socket d'écoute non bloquante)
+static void accept_all(Reactor *r) {
+    for (;;) {
+        int fd = accept4(r->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+        XferConn *c = calloc(1, sizeof(XferConn));
+        if (!c) {
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->file = -1;
+        c->state = XFER_COMMAND;
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = c };
+        if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("epoll_ctl");
+            conn_close(c);
+        }
+    }
+}
+
+static void *reactor_main(void *arg) {
+    Reactor *r = arg;
+    struct epoll_event events[XFER_EVENTS];
+    for (;;) {
+        // Attente : nulle s'il reste des connexions prêtes
+        int timeout = r->ready.head ? 0 : -1;
+        int n = epoll_wait(r->epfd, events, XFER_EVENTS, timeout);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            XferConn *c = events[i].data.ptr;
+            if (!c) {
+                accept_all(r);
+                continue;
+            }
+            // Une connexion en file sera reprise par la file (pas deux fois par tour)
+            if (c->queued) continue;
+            if (events[i].events & EPOLLERR) {
+                conn_close(c);
+                continue;
+            }
+            conn_ready(r, c);
+        }
+
+        // Connexions dont le budget était épuisé avant ce tour
+        XferQueue ready = r->ready;
+        r->ready.head = r->ready.tail = NULL;
+        for (XferConn *c = ready.head, *next; c; c = next) {
+            next = c->next;
+            c->queued = 0;
+            conn_ready(r, c);
+        }
+    }
+    return NULL;
+}
+
+void xfer_serve(int listen_fd, int threads) {
+    if (threads <= 0) threads = 1;
+    // Le processus est tué à l'arrêt : chaque ligne de trace part aussitôt
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    mkdir("uploads", 0777);
+    mkdir("uploads/" XFER_PARTIAL_DIR, 0777);
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+
+    Reactor *reactors = calloc(threads, sizeof(Reactor));
+    if (!reactors) {
+        perror("calloc réacteurs");
+        return;
+    }
+    for (int i = 0; i < threads; i++) {
+        Reactor *r = &reactors[i];
+        r->id = i;
+        r->listen_fd = listen_fd;
+        r->epfd = epoll_create1(EPOLL_CLOEXEC);
+        r->pipe[0] = r->pipe[1] = -1;
+        if (pipe2(r->pipe, O_CLOEXEC) == 0) {
+            // Un appel splice déplace au plus la capacité du tube
+            fcntl(r->pipe[1], F_SETPIPE_SZ, XFER_ZEROCOPY_CHUNK);
+        }
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = NULL };
+        if (r->epfd < 0 || epoll_ctl(r->epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+            perror("epoll transferts");
+            return;
+        }
+    }
+    printf("Transferts de fichiers : %d réacteur(s) epoll sur le port %d\n", threads, TCP_PORT);
+    fflush(stdout);
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&reactors[i].tid, NULL, reactor_main, &reactors[i]) != 0) {
+            perror("pthread_create réacteur");
+        }
+    }
+    reactor_main(&reactors[0]);
+}
@@ -0,0 +1,52 @@
+#ifndef XFER_H
+#define XFER_H
+
+/**
+ * Serveur des transferts de fichiers (TCP), exécuté par le processus fils
+ * du serveur : un ou plusieurs réacteurs epoll en mode déclenché sur front
+ * (EPOLLET), chacun dans son thread. Toutes les sockets sont non
+ * bloquantes ; chaque connexion suit un automate (protocole : wire.h) :
+ *
+ *   commande  → upload       réception des octets annoncés, accusé XOP_ACK
+ *             → download     XOP_FILE puis envoi au rythme de la socket,
+ *                            puis attente de l'accusé du client
+ *             → reprise      XOP_OFFSET
+ *   puis retour à la commande (une connexion peut enchaîner les plages).
+ *
+ * Reprise et flux parallèles : un upload s'écrit dans
+ * uploads/.partial/<nom>.part, préalloué à la taille totale, chaque plage
+ * à sa place (pwrite, ou splice à position explicite) ; plusieurs
+ * connexions peuvent en écrire des plages différentes en même temps. Les
+ * plages reçues sont notées dans <nom>.meta (taille totale puis une plage
+ * par ligne) et le fichier ne prend sa place dans uploads/ (rename)
+ * qu'une fois toutes reçues. Un upload coupé reprend au dernier point
+ * noté ; un téléchargement peut demander n'importe quelle plage d'octets.
+ *
+ * Un transfert lent n'immobilise donc plus que sa propre connexion. La
+ * socket d'écoute est partagée par les réacteurs (EPOLLEXCLUSIVE : un
+ * seul est réveillé par connexion entrante).
+ *
+ * Sans copie : les téléchargements partent par sendfile (cache de pages →
+ * socket), les uploads passent par splice (socket → tube du réacteur →
+ * fichier). Si le noyau refuse l'un ou l'autre, la connexion retombe sur
+ * la copie par blocs de XFER_CHUNK.
+ *
+ * Équité : une connexion fait au plus XFER_BUDGET appels par tour, puis
+ * repasse dans la file des connexions prêtes de son réacteur (en EPOLLET,
+ * aucun nouvel événement ne viendrait la réveiller).
+ */
+
+#define XFER_CHUNK (64 * 1024)            /* bloc de la copie par tampon (repli) */
+#define XFER_ZEROCOPY_CHUNK (1024 * 1024) /* octets au plus par appel sendfile ou splice */
+#define XFER_BUDGET 16                    /* appels par connexion et par tour de boucle */
+#define XFER_CHECKPOINT (64 * 1024 * 1024) /* point de reprise noté tous les N octets reçus */
+#define XFER_PARTIAL_DIR ".partial"        /* uploads en cours, sous uploads/ */
+
+/*
+ * Sert les transferts sur la socket d'écoute listen_fd avec threads
+ * réacteurs (le thread appelant est le premier). Ne retourne pas : le
+ * processus fils est arrêté par un signal
+ */
+void xfer_serve(int listen_fd, int threads);
+
+#endif
@@ -0,0 +1,346 @@
+#define _GNU_SOURCE
+#include "xferclient.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include "globalVariables.h"
+
+#define XFER_RECV_BUFFER (1024 * 1024)   // Tampon de réception d'un flux de download
+#define XFER_MAX_STREAMS 64
+
+static in_addr_t server_ip = 0;   // 0 : 127.0.0.1
+
+void xfer_set_server(const char *ip) {
+    struct in_addr addr;
+    if (inet_pton(AF_INET, ip, &addr) == 1) server_ip = addr.s_addr;
+}
+
+int xfer_connect(void) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        printf("Erreur: Création socket TCP\n");
+        return -1;
+    }
+
+    // Configuration de l'adresse du serveur
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(TCP_PORT);
+    server_addr.sin_addr.s_addr = server_ip ? server_ip : htonl(INADDR_LOOPBACK);
+
+    if (connect(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        printf("Erreur: Connexion au serveur\n");
+        close(sock);
+        return -1;
+    }
+    // Accusé d'une plage puis demande de la suivante : deux petits envois de
+    // suite, que Nagle retiendrait jusqu'à l'ACK différé du serveur
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return sock;
+}
+
+int xfer_send_header(int sock, WireXferHeader *h, const char *name, int more) {
+    uint8_t frame[WIRE_XFER_HEADER + WIRE_XFER_NAME_MAX];
+    size_t name_len = strlen(name);
+    h->name_len = name_len;
+    wire_xfer_pack(frame, h);
+    memcpy(frame + WIRE_XFER_HEADER, name, name_len);
+    size_t len = WIRE_XFER_HEADER + name_len;
+    return send(sock, frame, len, MSG_NOSIGNAL | (more ? MSG_MORE : 0)) == (ssize_t)len;
+}
+
+int xfer_recv_full(int sock, void *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = recv(sock, (char *)buf + got, len - got, 0);
+        if (n <= 0) return 0;
+        got += n;
+    }
+    return 1;
+}
+
+int xfer_recv_header(int sock, WireXferHeader *h) {
+    uint8_t head[WIRE_XFER_HEADER];
+    return xfer_recv_full(sock, head, sizeof(head)) && wire_xfer_unpack(head, h);
+}
+
+const char *xfer_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+int xfer_remote_size(const char *name, uint64_t *size) {
+    int sock = xfer_connect();
+    if (sock < 0) return -1;
+    // Plage vide : le serveur répond par la taille, sans contenu
+    WireXferHeader h = { .op = XOP_DOWNLOAD }, reply;
+    if (!xfer_send_header(sock, &h, name, 0) || !xfer_recv_header(sock, &reply) || reply.op != XOP_FILE) {
+        close(sock);
+        return -1;
+    }
+    if (reply.status == XST_OK) {
+        WireXferHeader ack = { .op = XOP_ACK, .status = XST_OK };
+        xfer_send_header(sock, &ack, "", 0);
+    }
+    close(sock);
+    *size = reply.total;
+    return reply.status;
+}
+
+/* ---- Transferts parallèles ---- */
+
+typedef struct {
+    const char *path;            // Fichier local (upload : source, download : downloads/<nom>.chunks)
+    const char *name;
+    uint64_t size, part_size;
+    pthread_mutex_t lock;
+    uint64_t next;               // Début du prochain morceau à distribuer
+    uint64_t done;               // Octets envoyés et acquittés, ou reçus et écrits
+    uint64_t kept;               // Upload : octets reçus par le serveur (plus grand accusé ou point de reprise)
+    int failed;
+    int file;
+} XferJob;
+
+// Prochain morceau [*start, *start + *len), 0 s'il n'en reste plus ou si un flux a échoué
+static int job_take(XferJob *job, uint64_t *start, uint64_t *len) {
+    pthread_mutex_lock(&job->lock);
+    int ok = !job->failed && job->next < job->size;
+    if (ok) {
+        *start = job->next;
+        *len = job->size - job->next < job->part_size ? job->size - job->next : job->part_size;
+        job->next += *len;
+    }
+    pthread_mutex_unlock(&job->lock);
+    return ok;
+}
+
+static void job_fail(XferJob *job) {
+    pthread_mutex_lock(&job->lock);
+    job->failed = 1;
+    pthread_mutex_unlock(&job->lock);
+}
+
+static int sendfile_full(int sock, int file, uint64_t start, uint64_t len) {
+    off_t off = start;
+    while (len) {
+        ssize_t n = sendfile(sock, file, &off, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        len -= n;
+    }
+    return 1;
+}
+
+// Empreinte des octets [start, start + len) du fichier (wire_xfer_digest),
+// lus dans buf (XFER_RECV_BUFFER octets). 0 si la lecture échoue
+static int file_digest(int file, char *buf, uint64_t start, uint64_t len, uint64_t *digest) {
+    uint64_t h = WIRE_XFER_DIGEST_INIT;
+    while (len) {
+        ssize_t n = pread(file, buf, len < XFER_RECV_BUFFER ? len : XFER_RECV_BUFFER, start);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        h = wire_xfer_digest(h, buf, n);
+        start += n;
+        len -= n;
+    }
+    *digest = h;
+    return 1;
+}
+
+static void job_kept(XferJob *job, uint64_t kept) {
+    pthread_mutex_lock(&job->lock);
+    if (kept > job->kept) job->kept = kept;
+    pthread_mutex_unlock(&job->lock);
+}
+
+// Flux d'upload : morceaux de la file commune, sur une seule connexion.
+// Chaque morceau part avec son empreinte, que le serveur vérifie sur les
+// octets écrits avant de le conserver
+static void *upload_stream(void *arg) {
+    XferJob *job = arg;
+    char *buf = malloc(XFER_RECV_BUFFER);
+    int sock = buf ? xfer_connect() : -1;
+    if (sock < 0) {
+        free(buf);
+        job_fail(job);
+        return NULL;
+    }
+    uint64_t start, len;
+    while (job_take(job, &start, &len)) {
+        // Ce qu'un envoi précédent a déjà déposé dans ce morceau n'est pas renvoyé
+        WireXferHeader ask = { .op = XOP_RESUME, .offset = start, .total = job->size }, reply;
+        if (!xfer_send_header(sock, &ask, job->name, 0) || !xfer_recv_header(sock, &reply) || reply.op != XOP_OFFSET) {
+            printf("Erreur: Pas de réponse du serveur\n");
+            job_fail(job);
+            break;
+        }
+        if (reply.status != XST_OK) {
+            printf("Erreur: Le serveur refuse %s (%s)\n", job->name, wire_xfer_status(reply.op, reply.status));
+            job_fail(job);
+            break;
+        }
+        // Total conservé par le serveur : seul accusé d'un morceau qu'il a déjà en entier
+        job_kept(job, reply.length);
+        if (reply.offset >= start + len) {
+            pthread_mutex_lock(&job->lock);
+            job->done += len;
+            pthread_mutex_unlock(&job->lock);
+            continue;
+        }
+        uint64_t from = reply.offset > start ? reply.offset : start;
+        // Octets déposés par un envoi interrompu mais pas encore vérifiés :
+        // repris s'ils ont l'empreinte du fichier local, ce que le serveur
+        // apprend par un XOP_UPLOAD qui commence après eux (éventuellement
+        // vide, s'ils couvrent la fin du morceau)
+        uint64_t digest;
+        if (reply.offset == from && reply.total > from && reply.total <= job->size &&
+            file_digest(job->file, buf, from, reply.total - from, &digest) && digest == reply.digest) {
+            from = reply.total;
+        }
+        uint64_t end = start + len > from ? start + len : from;
+        WireXferHeader h = { .op = XOP_UPLOAD, .offset = from, .length = end - from, .total = job->size }, ack = { 0 };
+        if (!file_digest(job->file, buf, from, h.length, &h.digest)) {
+            printf("Erreur: Lecture des octets %lu à %lu de %s\n", (unsigned long)from, (unsigned long)end, job->path);
+            job_fail(job);
+            break;
+        }
+        if (!xfer_send_header(sock, &h, job->name, 1) || !sendfile_full(sock, job->file, from, h.length) ||
+            !xfer_recv_header(sock, &ack) || ack.op != XOP_ACK || ack.status != XST_OK || ack.length != h.length ||
+            ack.digest != h.digest) {
+            printf("Erreur: Envoi des octets %lu à %lu de %s%s%s\n", (unsigned long)from, (unsigned long)end, job->name,
+                   ack.op == XOP_ACK ? " : " : "", ack.op == XOP_ACK ? wire_xfer_status(ack.op, ack.status) : "");
+            job_fail(job);
+            break;
+        }
+        pthread_mutex_lock(&job->lock);
+        job->done += len;
+        pthread_mutex_unlock(&job->lock);
+        job_kept(job, ack.total);
+    }
+    close(sock);
+    free(buf);
+    return NULL;
+}
+
+// Flux de download : chaque plage est vérifiée (statut, bornes, longueur
+// reçue, écriture) avant d'être comptée
+static void *download_stream(void *arg) {
+    XferJob *job = arg;
+    char *buf = malloc(XFER_RECV_BUFFER);
+    int sock = buf ? xfer_connect() : -1;
+    if (sock < 0) {
+        free(buf);
+        job_fail(job);
+        return NULL;
+    }
+    uint64_t start, len;
+    while (job_take(job, &start, &len)) {
+        WireXferHeader h = { .op = XOP_DOWNLOAD, .offset = start, .length = len }, reply;
+        if (!xfer_send_header(sock, &h, job->name, 0) || !xfer_recv_header(sock, &reply) || reply.op != XOP_FILE ||
+            reply.status != XST_OK || reply.offset != start || reply.length != len || reply.total != job->size) {
+            printf("Erreur: Le serveur ne peut pas envoyer les octets %lu à %lu de %s\n", (unsigned long)start,
+                   (unsigned long)(start + len), job->name);
+            job_fail(job);
+            break;
+        }
+        uint64_t got = 0;
+        int write_ok = 1;
+        while (got < len) {
+            size_t want = len - got < XFER_RECV_BUFFER ? len - got : XFER_RECV_BUFFER;
+            ssize_t n = recv(sock, buf, want, 0);
+            if (n <= 0) break;
+            for (ssize_t off = 0; write_ok && off < n;) {
+                ssize_t k = pwrite(job->file, buf + off, n - off, start + got + off);
+                if (k <= 0) write_ok = 0;
+                else off += k;
+            }
+            got += n;
+        }
+        WireXferHeader ack = { .op = XOP_ACK, .status = write_ok ? XST_OK : XST_WRITE_ERROR, .offset = start, .length = got };
+        if (got < len || !write_ok || !xfer_send_header(sock, &ack, "", 0)) {
+            printf("Erreur: Octets %lu à %lu de %s %s\n", (unsigned long)start, (unsigned long)(start + len), job->name,
+                   write_ok ? "interrompus" : "non écrits");
+            job_fail(job);
+            break;
+        }
+        pthread_mutex_lock(&job->lock);
+        job->done += len;
+        pthread_mutex_unlock(&job->lock);
+    }
+    close(sock);
+    free(buf);
+    return NULL;
+}
+
+// Lance streams flux sur job et attend qu'ils aient tous fini
+static void run_streams(XferJob *job, int streams, void *(*stream)(void *)) {
+    uint64_t parts = (job->size + job->part_size - 1) / job->part_size;
+    if (streams > XFER_MAX_STREAMS) streams = XFER_MAX_STREAMS;
+    if ((uint64_t)streams > parts) streams = parts;
+    if (streams < 1) streams = 1;
+    pthread_t tids[XFER_MAX_STREAMS];
+    int started = 0;
+    for (int i = 0; i < streams; i++) {
+        if (pthread_create(&tids[started], NULL, stream, job) == 0) started++;
+    }
+    if (started == 0) stream(job);
+    for (int i = 0; i < started; i++) pthread_join(tids[i], NULL);
+}
+
+int xfer_upload_parallel(const char *path, const char *name, uint64_t size, int streams, uint64_t part_size) {
+    XferJob job = { .path = path, .name = name, .size = size, .part_size = part_size ? part_size : size };
+    job.file = open(path, O_RDONLY);
+    if (job.file < 0) {
+        printf("Erreur: Impossible d'ouvrir le fichier %s\n", path);
+        return -1;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    run_streams(&job, streams, upload_stream);
+    pthread_mutex_destroy(&job.lock);
+    close(job.file);
+    // Le dernier morceau reçu par le serveur fait passer son total à la taille du fichier
+    if (job.failed || job.done != size || job.kept != size) {
+        if (!job.failed) printf("Erreur: Le serveur n'a conservé que %lu/%lu octets de %s\n", (unsigned long)job.kept,
+                                (unsigned long)size, name);
+        return -1;
+    }
+    return 0;
+}
+
+int xfer_download_parallel(const char *name, uint64_t size, int streams, uint64_t part_size) {
+    char local_path[WIRE_XFER_NAME_MAX + 16], chunks_path[WIRE_XFER_NAME_MAX + 24];
+    snprintf(local_path, sizeof(local_path), "downloads/%s", name);
+    snprintf(chunks_path, sizeof(chunks_path), "downloads/%s.chunks", name);
+    XferJob job = { .path = chunks_path, .name = name, .size = size, .part_size = part_size ? part_size : size };
+
+    // Fichier préalloué : les morceaux s'écrivent à leur place dans n'importe quel ordre
+    mkdir("downloads", 0777);
+    job.file = open(chunks_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (job.file < 0 || (size && fallocate(job.file, 0, 0, size) < 0 && ftruncate(job.file, size) < 0)) {
+        printf("Erreur: Impossible de créer le fichier %s\n", chunks_path);
+        if (job.file >= 0) close(job.file);
+        return -1;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    run_streams(&job, streams, download_stream);
+    pthread_mutex_destroy(&job.lock);
+    int ok = close(job.file) == 0 && !job.failed && job.done == size;
+    if (!ok || rename(chunks_path, local_path) < 0) {
+        if (ok) printf("Erreur: Renommage de %s\n", chunks_path);
+        unlink(chunks_path);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef XFERCLIENT_H
+#define XFERCLIENT_H
+
+#include <stdint.h>
+#include "wire.h"
+
+/**
+ * Côté client des transferts de fichiers (protocole : wire.h, serveur :
+ * xfer.h), partagé par le client et les benchmarks.
+ *
+ * Transferts parallèles : un gros fichier est découpé en morceaux de
+ * part_size octets, répartis entre streams connexions TCP (un thread
+ * chacune) qui se servent dans une file commune : une connexion lente
+ * prend simplement moins de morceaux. Chaque connexion enchaîne ses
+ * morceaux sans se reconnecter.
+ *   - upload : chaque morceau est un XOP_UPLOAD de sa plage, que le serveur
+ *     écrit à sa place ; un XOP_RESUME sur le début du morceau évite de
+ *     renvoyer ce qu'un envoi interrompu a déjà déposé (les octets non
+ *     encore vérifiés par le serveur ne sont repris que si leur empreinte
+ *     est celle du fichier local). Le serveur ne publie le fichier
+ *     qu'une fois toutes les plages reçues.
+ *   - download : chaque morceau est une plage XOP_DOWNLOAD, écrite par
+ *     pwrite dans downloads/<nom>.chunks (préalloué). Le fichier n'est
+ *     renommé en downloads/<nom> que si chaque morceau est arrivé en
+ *     entier avec le bon statut ; sinon il est supprimé.
+ */
+
+/* Adresse IPv4 du serveur de transferts (127.0.0.1 par défaut) */
+void xfer_set_server(const char *ip);
+
+/* Connexion TCP au serveur de transferts, -1 en cas d'échec */
+int xfer_connect(void);
+
+/* En-tête suivi du nom. more : du contenu suit, l'en-tête attend d'être complété */
+int xfer_send_header(int sock, WireXferHeader *h, const char *name, int more);
+
+/* Lit exactement len octets, 0 si la connexion se ferme avant */
+int xfer_recv_full(int sock, void *buf, size_t len);
+
+int xfer_recv_header(int sock, WireXferHeader *h);
+
+/* Nom sous lequel le fichier est connu du serveur (sans les dossiers locaux) */
+const char *xfer_name(const char *path);
+
+/* Taille du fichier name sur le serveur dans *size ; statut XST_* de la réponse, -1 sans réponse */
+int xfer_remote_size(const char *name, uint64_t *size);
+
+/* Envoie path (size octets) sous le nom name sur streams connexions. 0 si
+ * le serveur a tout reçu, -1 sinon */
+int xfer_upload_parallel(const char *path, const char *name, uint64_t size, int streams, uint64_t part_size);
+
+/* Télécharge name (size octets, xfer_remote_size) dans downloads/<name> sur
+ * streams connexions. 0 si tous les morceaux sont arrivés, -1 sinon */
+int xfer_download_parallel(const char *name, uint64_t size, int streams, uint64_t part_size);
+
+#endif